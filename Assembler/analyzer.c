@@ -0,0 +1,586 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Static analyzer of the cycle costs, loops and stack depth of the RAM image
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "analyzer.h"
+#include "data_structures.h"
+#include "isa.h"
+#include "memory_map.h"
+
+// costs are doubles, which count cycles exactly beyond the range of long
+#define UNBOUNDED -1.0 // a cost or a depth without a static bound
+#define NO_PATH -2.0 // no path reaches the end of a search
+
+/* Where a path search may end. */
+enum End {
+	ANY_END, // at any instruction
+	BACK_END, // at an instruction that jumps back to the loop header
+	EXIT_END // at an instruction that leaves the loop, returns or halts
+};
+
+/* A decoded instruction of the RAM image, at the address of its index. */
+struct Node {
+	const struct Keyword *k; // NULL if the opcode is invalid
+	unsigned char instr1;
+	unsigned char instr2;
+	int next[2]; // successors, or -1; a CALL continues after the call
+	int sub; // subroutine called by a CALL, or -1
+};
+
+/* A subroutine: the code at address 0, or at a CALL target. */
+struct Subroutine {
+	int entry; // address
+	char state; // 0 before its analysis, 1 during it, 2 after it
+	double min; // cycles of the shortest path to a return or halt
+	double max; // cycles of the longest path, with each loop passed once
+	double worst; // cycles with the loops repeated
+	double stack; // words pushed at most, including return addresses
+	int writes; // registers that it or its callees may write, as bits
+};
+
+/* A natural loop: a header and the instructions that lead back to it. */
+struct Loop {
+	int sub; // subroutine
+	int header; // address of its first instruction
+	int count; // iterations, or 0 if they aren't known
+	double min; // cycles of the shortest iteration
+	double max; // cycles of the longest iteration
+	double total; // cycles of all iterations at most
+};
+
+/* The control flow of the RAM image from address 0. */
+struct Analysis {
+	const struct Assembler *as;
+	struct Node node[256];
+	char decoded[256];
+	struct Subroutine sub[256];
+	int subs;
+	struct Loop loop[256];
+	int loops;
+	char body[256][256]; // instructions of each loop
+	char sp; // the stack pointer is written explicitly
+};
+
+/* A path search over the instructions of a region, in which the
+instructions of each collapsed loop are represented by its header. */
+struct Search {
+	const struct Analysis *a;
+	const char *in; // instructions of the region
+	const int *rep; // instruction that represents each one
+	char (*back)[2]; // edges to leave out, or NULL
+	const double *w; // cycles of each instruction
+	int header; // loop header whose edges end an iteration, or -1
+	char longest; // the longest path, instead of the shortest
+	char end; // enum End
+	double memo[256];
+	char state[256]; // 0 unvisited, 1 on the path, 2 memoized
+};
+
+/* Adds two costs; an unbounded one stays unbounded. */
+double addcost(double a, double b)
+{
+	return a == UNBOUNDED || b == UNBOUNDED ? UNBOUNDED : a + b;
+}
+
+/* Returns the longer or the shorter of two costs, preferring a path to
+NO_PATH. */
+double pickcost(double a, double b, char longest)
+{
+	if (a == NO_PATH) return b;
+	if (b == NO_PATH) return a;
+	if (a == UNBOUNDED || b == UNBOUNDED) {
+		return longest ? UNBOUNDED : (a == UNBOUNDED ? b : a);
+	}
+	return longest ? (a > b ? a : b) : (a < b ? a : b);
+}
+
+/* Returns the index of the subroutine at entry, adding it if it's new. */
+int subroutine(struct Analysis *a, int entry)
+{
+	for (int s = 0; s < a->subs; s++) if (a->sub[s].entry == entry) return s;
+	memset(&a->sub[a->subs], 0, sizeof(a->sub[a->subs]));
+	a->sub[a->subs].entry = entry;
+	return a->subs++;
+}
+
+/* Decodes the instruction at addr. The DIP input at 0xFF can't be known. */
+void decode_node(struct Analysis *a, int addr)
+{
+	const struct OutputHeader *Out = &a->as->Out;
+	struct Node *n = &a->node[addr];
+	n->instr1 = Out->mem[addr];
+	n->instr2 = Out->mem[(addr + 1) & 0xFF];
+	n->k = addr < 0xFF ? decode(n->instr1) : NULL;
+	n->next[0] = n->next[1] = n->sub = -1;
+	a->decoded[addr] = 1;
+	if (!n->k) return;
+	int after = (addr + n->k->size) & 0xFF;
+	switch (n->k->opcode) {
+	case HLT_OP:
+	case RETURN_OP:
+		return;
+	case JMP_OP:
+		n->next[0] = n->instr2;
+		return;
+	case CALL_OP:
+		n->next[0] = after;
+		n->sub = subroutine(a, n->instr2);
+		return;
+	}
+	n->next[0] = after;
+	if (n->k->format == TYPE3) n->next[1] = n->instr2; // J<flag>
+}
+
+/* Returns the register that the instruction writes, or -1. The stack
+pointer is written implicitly by PUSH, POP, CALL and RETURN. */
+int written(const struct Node *n)
+{
+	if (!n->k) return -1;
+	switch (n->k->opcode) {
+	case LSHIFT_OP:
+	case RSHIFT_OP:
+	case POP_OP:
+		return n->instr1 & 7;
+	case STORE_OP:
+	case CMP_OP:
+	case BIT_OP:
+		return -1;
+	}
+	if (n->k->format != TYPE4_5) return -1;
+	return n->instr1 & 0x08 ? (n->instr2 >> 4) & 7 : n->instr1 & 7;
+}
+
+/* Returns the only instruction of the region that leads to x, or -1 if
+there are more, or none, or x is the entry, which is also called. */
+int predecessor(const struct Analysis *a, const char *in, int entry, int x)
+{
+	int p = -1;
+	if (x == entry) return -1;
+	for (int y = 0; y < 256; y++) {
+		if (!in[y]) continue;
+		for (int k = 0; k < 2; k++) {
+			if (a->node[y].next[k] != x) continue;
+			if (p >= 0) return -1;
+			p = y;
+		}
+	}
+	return p;
+}
+
+/* Returns the cost of the longest or the shortest path from instruction x
+to an end of the search, or NO_PATH. A cycle that isn't a collapsed loop
+makes the longest path unbounded. */
+double search(struct Search *s, int x)
+{
+	const struct Analysis *a = s->a;
+	double best = s->end == ANY_END ? 0 : NO_PATH;
+	if (s->state[x] == 2) return s->memo[x];
+	if (s->state[x] == 1) return s->longest ? UNBOUNDED : NO_PATH;
+	s->state[x] = 1;
+	for (int y = 0; y < 256; y++) {
+		if (!s->in[y] || s->rep[y] != x) continue;
+		const struct Node *n = &a->node[y];
+		if (n->next[0] < 0 && n->next[1] < 0 && s->end == EXIT_END) {
+			best = pickcost(best, 0, s->longest); // returns or halts
+		}
+		for (int k = 0; k < 2; k++) {
+			int m = n->next[k];
+			if (m < 0 || (s->back && s->back[y][k])) continue;
+			if (!s->in[m]) {
+				if (s->end == EXIT_END) best = pickcost(best, 0, s->longest);
+			} else if (s->rep[m] == s->header) {
+				if (s->end == BACK_END) best = pickcost(best, 0, s->longest);
+			} else if (s->rep[m] != x) {
+				best = pickcost(best, search(s, s->rep[m]), s->longest);
+			}
+		}
+	}
+	s->state[x] = 2;
+	s->memo[x] = best == NO_PATH ? NO_PATH : addcost(s->w[x], best);
+	return s->memo[x];
+}
+
+/* Returns the cost of a path search from instruction x. */
+double path(const struct Analysis *a, const char *in, const int *rep,
+	char (*back)[2], const double *w, int header, char longest, char end, int x)
+{
+	struct Search s;
+	s.a = a;
+	s.in = in;
+	s.rep = rep;
+	s.back = back;
+	s.w = w;
+	s.header = header;
+	s.longest = longest;
+	s.end = end;
+	memset(s.state, 0, sizeof(s.state));
+	return search(&s, x);
+}
+
+/* Returns the iterations of the loop with header h, or 0 if they aren't
+known. The loop must be closed by a JNZ back, or by a JZ out and a JMP back,
+right after a SUB of 1 (or an ADD of 255) from R0-R5, which no other
+instruction of the loop or its calls writes, and which a MOV of a number
+sets on the only path into the loop. */
+int count_loop(const struct Analysis *a, const char *in, const char *body,
+	int entry, int h)
+{
+	int source = -1, sources = 0;
+	for (int x = 0; x < 256; x++) {
+		for (int k = 0; body[x] && k < 2; k++) {
+			if (a->node[x].next[k] == h) {
+				source = x;
+				sources++;
+			}
+		}
+	}
+	if (sources != 1) return 0;
+	int test = source; // the jump that tests the counter
+	if (a->node[source].k->opcode == JMP_OP) {
+		test = predecessor(a, in, entry, source);
+		if (test < 0 || !a->node[test].k || a->node[test].k->opcode != JZ_OP
+			|| body[a->node[test].instr2]) return 0;
+	} else if (a->node[source].k->opcode != JNZ_OP || a->node[source].instr2 != h) {
+		return 0;
+	}
+	int step = predecessor(a, in, entry, test);
+	if (step < 0) return 0;
+	const struct Node *d = &a->node[step];
+	int r = d->instr1 & 7;
+	if (!d->k || d->k->format != TYPE4_5 || d->instr1 & 0x08 || r > 5
+		|| !((d->k->opcode == SUB_OP && d->instr2 == 1)
+		|| (d->k->opcode == ADD_OP && d->instr2 == 0xFF))) return 0;
+	for (int x = 0; x < 256; x++) {
+		const struct Node *n = &a->node[x];
+		if (!body[x] || x == step) continue;
+		if (written(n) == r) return 0;
+		if (n->sub >= 0 && a->sub[n->sub].writes & 1 << r) return 0;
+	}
+	// the counter is set on the only path into the loop
+	int p = -1, entries = 0;
+	for (int x = 0; x < 256; x++) {
+		for (int k = 0; in[x] && !body[x] && k < 2; k++) {
+			if (a->node[x].next[k] == h) {
+				p = x;
+				entries++;
+			}
+		}
+	}
+	for (int steps = 0; entries == 1 && p >= 0 && steps < 256; steps++) {
+		const struct Node *n = &a->node[p];
+		if (n->k && n->k->opcode == MOV_OP && !(n->instr1 & 0x08)
+			&& (n->instr1 & 7) == r) return n->instr2 ? n->instr2 : 256;
+		if (written(n) == r) return 0;
+		if (n->sub >= 0 && a->sub[n->sub].writes & 1 << r) return 0;
+		p = predecessor(a, in, entry, p);
+	}
+	return 0;
+}
+
+/* Returns the words that the subroutine pushes at most, including the
+return addresses and the stacks of its calls, or UNBOUNDED. */
+double stack_depth(struct Analysis *a, const char *in, int entry)
+{
+	int depth[256]; // words pushed before each instruction, at most
+	int work[256];
+	char queued[256] = {0}, seen[256] = {0};
+	int n = 0;
+	double peak = 0;
+	depth[entry] = 0;
+	seen[entry] = queued[entry] = 1;
+	work[n++] = entry;
+	while (n) {
+		int x = work[--n];
+		const struct Node *o = &a->node[x];
+		int d = depth[x];
+		queued[x] = 0;
+		if (written(o) == 7) {
+			a->sp = 1;
+			return UNBOUNDED;
+		}
+		if (o->k && o->k->opcode == PUSH_OP) d++;
+		if (o->k && o->k->opcode == POP_OP) d--;
+		if (o->sub >= 0) {
+			const struct Subroutine *c = &a->sub[o->sub];
+			if (c->state == 1 || c->stack == UNBOUNDED) return UNBOUNDED;
+			peak = pickcost(peak, d + 1 + c->stack, 1);
+		}
+		if (d > 255) return UNBOUNDED; // a loop that pushes
+		peak = pickcost(peak, d, 1);
+		for (int k = 0; k < 2; k++) {
+			int m = o->next[k];
+			if (m < 0 || !in[m] || (seen[m] && depth[m] >= d)) continue;
+			depth[m] = d;
+			seen[m] = 1;
+			if (!queued[m]) {
+				queued[m] = 1;
+				work[n++] = m;
+			}
+		}
+	}
+	return peak;
+}
+
+/* Analyzes subroutine s after the subroutines that it calls. A recursive
+call costs an unbounded number of cycles and stack words. */
+void analyze_sub(struct Analysis *a, int s)
+{
+	char in[256] = {0}; // instructions of the subroutine
+	char back[256][2]; // edges back to an instruction on the search path
+	int stack[256], edge[256], top = 0; // depth-first search path
+	int rep[256]; // instruction that represents each one
+	double wmin[256], wmax[256], worst[256]; // cycles of each instruction
+	int order[256], loops = 0; // loops of the subroutine, inner ones first
+	struct Subroutine *sub = &a->sub[s];
+	int entry = sub->entry;
+	if (sub->state) return;
+	sub->state = 1;
+	memset(back, 0, sizeof(back));
+	in[entry] = 1;
+	stack[top] = entry;
+	edge[top++] = 0;
+	while (top) {
+		int x = stack[top - 1];
+		if (edge[top - 1] == 2) {
+			in[x] = 2; // done
+			top--;
+			continue;
+		}
+		int k = edge[top - 1]++;
+		int y = a->node[x].next[k];
+		if (y < 0) continue;
+		if (in[y] == 1) {
+			back[x][k] = 1;
+		} else if (!in[y]) {
+			in[y] = 1;
+			stack[top] = y;
+			edge[top++] = 0;
+		}
+	}
+
+	for (int x = 0; x < 256; x++) {
+		const struct Node *n = &a->node[x];
+		if (!in[x]) continue;
+		rep[x] = x;
+		wmin[x] = wmax[x] = worst[x] = 1;
+		if (written(n) >= 0) sub->writes |= 1 << written(n);
+		if (n->sub < 0) continue;
+		analyze_sub(a, n->sub);
+		const struct Subroutine *c = &a->sub[n->sub];
+		if (c->state == 1) {
+			// recursive
+			wmax[x] = worst[x] = UNBOUNDED;
+			sub->writes = 0xFF;
+			continue;
+		}
+		wmin[x] += c->min == NO_PATH ? 0 : c->min;
+		wmax[x] = c->max == NO_PATH ? UNBOUNDED : addcost(1, c->max);
+		worst[x] = c->worst == NO_PATH ? UNBOUNDED : addcost(1, c->worst);
+		sub->writes |= c->writes;
+	}
+	sub->min = path(a, in, rep, back, wmin, -1, 0, EXIT_END, entry);
+	sub->max = path(a, in, rep, back, wmax, -1, 1, EXIT_END, entry);
+
+	// the loops, by their headers, from the inner ones out
+	for (int x = 0; x < 256 && a->loops + loops < 256; x++) {
+		for (int k = 0; in[x] && k < 2; k++) {
+			int h = a->node[x].next[k];
+			int l = a->loops + loops;
+			char found = 0;
+			if (!back[x][k]) continue;
+			for (int i = a->loops; i < l; i++) found |= a->loop[i].header == h;
+			if (found || l >= 256) continue;
+			char *body = a->body[l];
+			int work[256], n = 0, size = 1;
+			memset(body, 0, 256);
+			body[h] = 1;
+			for (int y = 0; y < 256; y++) {
+				for (int j = 0; in[y] && j < 2; j++) {
+					if (back[y][j] && a->node[y].next[j] == h && !body[y]) {
+						body[y] = 1;
+						work[n++] = y;
+					}
+				}
+			}
+			while (n) {
+				int y = work[--n];
+				size++;
+				for (int p = 0; p < 256; p++) {
+					for (int j = 0; in[p] && j < 2; j++) {
+						if (a->node[p].next[j] == y && !body[p]) {
+							body[p] = 1;
+							work[n++] = p;
+						}
+					}
+				}
+			}
+			a->loop[l].sub = s;
+			a->loop[l].header = h;
+			a->loop[l].count = size; // sorted by it below
+			order[loops++] = l;
+		}
+	}
+	for (int i = 1; i < loops; i++) {
+		for (int j = i; j > 0 && a->loop[order[j]].count
+			< a->loop[order[j - 1]].count; j--) {
+			int t = order[j];
+			order[j] = order[j - 1];
+			order[j - 1] = t;
+		}
+	}
+	for (int i = 0; i < loops; i++) {
+		struct Loop *l = &a->loop[order[i]];
+		const char *body = a->body[order[i]];
+		int h = l->header;
+		l->count = count_loop(a, in, body, entry, h);
+		l->min = path(a, body, rep, NULL, wmin, h, 0, BACK_END, h);
+		l->max = path(a, body, rep, NULL, worst, h, 1, BACK_END, h);
+		double any = path(a, body, rep, NULL, worst, h, 1, ANY_END, h);
+		double out = path(a, body, rep, NULL, wmin, h, 0, EXIT_END, h);
+		l->total = l->count && any != UNBOUNDED ? l->count * any : UNBOUNDED;
+		// the loop now stands for all its instructions
+		for (int x = 0; x < 256; x++) if (body[x]) rep[x] = h;
+		worst[h] = l->total;
+		wmin[h] = out == NO_PATH ? l->min : out;
+	}
+	a->loops += loops;
+	sub->worst = path(a, in, rep, NULL, worst, -1, 1, EXIT_END, rep[entry]);
+	sub->stack = stack_depth(a, in, entry);
+	sub->state = 2;
+}
+
+/* Returns the name of the code at addr: its label, or "-". */
+const char* codename(const struct Analysis *a, int addr)
+{
+	const char *name = codelabel(a->as, addr);
+	return name ? name : "-";
+}
+
+/* Writes a cost, or a range of costs, at dest. */
+void formatcost(char *dest, double min, double max)
+{
+	if (max == NO_PATH) {
+		strcpy(dest, "no end");
+	} else if (max == UNBOUNDED) {
+		sprintf(dest, "%.0f-", min);
+	} else if (min == max) {
+		sprintf(dest, "%.0f", max);
+	} else {
+		sprintf(dest, "%.0f-%.0f", min, max);
+	}
+}
+
+/* Appends the stack report: its depth and whether it reaches the program
+words or buffers, which it would overwrite from the highest one down. */
+int format_stack(const struct Analysis *a, struct Text *t)
+{
+	const struct OutputHeader *Out = &a->as->Out;
+	double words = a->sub[0].stack;
+	int top = program_top(a->as);
+	if (words == UNBOUNDED) {
+		return append(t, "Stack: unbounded, %s.\n", a->sp
+			? "as the stack pointer is written explicitly"
+			: "by recursion or a loop that pushes");
+	}
+	if (!words) return append(t, "Stack: unused.\n");
+	int lowest = 0xFF - (int)words;
+	if (words == 1) {
+		if (!append(t, "Stack: 1 word at most, at %d, ", 0xFE)) return 0;
+	} else if (!append(t, "Stack: %d words at most, at %d-%d, ", (int)words,
+		lowest < 0 ? 0 : lowest, 0xFE)) {
+		return 0;
+	}
+	if (lowest > top) {
+		return append(t, "%d words clear of the program.\n", lowest - top - 1);
+	}
+	return append(t, "overwriting the %s at %d.\n",
+		Out->word[top].type == UNUSED_WORD ? ".RESERVE buffer"
+		: Out->word[top].type == DATA_WORD ? ".DATA" : "code", top);
+}
+
+/* Appends the run time of the program at its .SPEED level, whose clocks
+are divided down from 2 MHz by ClockGen in Interface.vhd. */
+int format_time(const struct Analysis *a, struct Text *t)
+{
+	static const int divider[MAX_SPEED + 1] = {0, 23, 21, 20, 19, 17, 9};
+	const struct Subroutine *program = &a->sub[0];
+	int speed = a->as->Out.speed;
+	if (program->worst == NO_PATH) {
+		return append(t, "Run time: the program doesn't halt.\n");
+	}
+	if (program->worst == UNBOUNDED) {
+		return append(t, "Run time: unbounded, at least %.0f cycles.\n",
+			program->min);
+	}
+	if (!append(t, "Run time: %.0f cycles at most", program->worst)) return 0;
+	if (!speed) return append(t, ", stepped by hand at .SPEED 0.\n");
+	double hz = 2e6 / (1L << divider[speed]);
+	return append(t, ", %.3g s at .SPEED %d (%.3g Hz).\n",
+		program->worst / hz, speed, hz);
+}
+
+int format_analysis(const struct Assembler *as, struct Text *t)
+{
+	struct Analysis *a = malloc(sizeof(*a));
+	int work[256], n = 0;
+	char cost[2][32];
+	int ok = 1;
+	if (!a) return 0;
+	a->as = as;
+	a->subs = a->loops = 0;
+	a->sp = 0;
+	memset(a->decoded, 0, sizeof(a->decoded));
+	subroutine(a, 0);
+	work[n++] = 0;
+	a->decoded[0] = 1;
+	while (n) {
+		int x = work[--n];
+		decode_node(a, x);
+		int next[3] = {a->node[x].next[0], a->node[x].next[1], -1};
+		if (a->node[x].sub >= 0) next[2] = a->sub[a->node[x].sub].entry;
+		for (int k = 0; k < 3; k++) {
+			if (next[k] < 0 || a->decoded[next[k]]) continue;
+			a->decoded[next[k]] = 1;
+			work[n++] = next[k];
+		}
+	}
+	for (int s = 0; s < a->subs; s++) analyze_sub(a, s);
+
+	ok = append(t, "\nSubroutine        Address  Line  Paths      Worst case  "
+		"Stack\n");
+	for (int s = 0; ok && s < a->subs; s++) {
+		const struct Subroutine *sub = &a->sub[s];
+		char stack[16] = "unbounded";
+		formatcost(cost[0], sub->min, sub->max);
+		formatcost(cost[1], sub->worst, sub->worst);
+		if (sub->worst == UNBOUNDED) strcpy(cost[1], "unbounded");
+		if (sub->stack != UNBOUNDED) sprintf(stack, "%.0f", sub->stack);
+		ok = append(t, "%-17s %7d  %4d  %-10s %-11s %s\n",
+			s ? codename(a, sub->entry) : "(start)", sub->entry,
+			as->Out.word[sub->entry].line, cost[0], cost[1], stack);
+	}
+	if (ok && a->loops) {
+		ok = append(t, "\nLoop              Address  Line  Iteration  Count  "
+			"Cycles\n");
+	}
+	for (int i = 0; ok && i < a->loops; i++) {
+		const struct Loop *l = &a->loop[i];
+		char count[8] = "?";
+		formatcost(cost[0], l->min, l->max);
+		if (l->total == UNBOUNDED) {
+			strcpy(cost[1], "unbounded");
+		} else {
+			sprintf(cost[1], "%.0f", l->total);
+		}
+		if (l->count) sprintf(count, "%d", l->count);
+		ok = append(t, "%-17s %7d  %4d  %-10s %-6s %s\n",
+			codename(a, l->header), l->header, as->Out.word[l->header].line,
+			cost[0], count, cost[1]);
+	}
+	ok = ok && append(t, "\n") && format_stack(a, t) && format_time(a, t);
+	free(a);
+	return ok;
+}
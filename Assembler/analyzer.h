@@ -0,0 +1,24 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Static analyzer headers
+
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include "data_structures.h"
+
+/* Appends the static analysis of the RAM image to t. Every E80 instruction
+takes one cycle, so costs are counted in instructions along the control flow
+from address 0 and from each CALL target, without running the program:
+- for each subroutine, the cycles of its paths from entry to return or halt
+  with each loop passed once, its worst case with the loops repeated, and the
+  stack words it uses, including the return addresses of its calls;
+- for each loop, the cycles of an iteration and its count, if the loop is
+  closed by a JNZ, or a JZ out and a JMP back, right after a SUB of 1 from a
+  register that the loop doesn't write otherwise, and that is set by a MOV of
+  a number before it;
+- whether the stack, which grows down from 0xFF, can reach the code or the
+  .DATA, and the worst-case run time at the .SPEED level.
+Returns 0 if memory can't be allocated. */
+int format_analysis(const struct Assembler *as, struct Text *t);
+
+#endif
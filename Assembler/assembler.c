@@ -0,0 +1,776 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Assembler library; runs the assembly passes on an assembler context
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "assembler.h"
+#include "error_handler.h"
+#include "data_structures.h"
+#include "parse_functions.h"
+#include "template.h"
+#include "optimizer.h"
+#include "stats.h"
+
+struct Assembler* new_assembler(void)
+{
+	return calloc(1, sizeof(struct Assembler));
+}
+
+void reset_assembler(struct Assembler *as)
+{
+	// keep the line, token, text and symbol buffers, emptied
+	struct InputHeader In = as->In;
+	memset(&as->In, 0, sizeof(as->In));
+	as->In.lines = In.lines;
+	as->In.lines_size = In.lines_size;
+	as->In.tokens = In.tokens;
+	as->In.size = In.size;
+	as->In.text.s = In.text.s;
+	as->In.text.size = In.text.size;
+	as->In.symbols.symbol = In.symbols.symbol;
+	as->In.symbols.size = In.symbols.size;
+	as->In.symbols.slot = In.symbols.slot;
+	as->In.symbols.slots = In.symbols.slots;
+	if (In.symbols.slot) {
+		memset(In.symbols.slot, 0, In.symbols.slots * sizeof(*In.symbols.slot));
+	}
+	reset_output(as);
+}
+
+void reset_output(struct Assembler *as)
+{
+	// keep the label and title buffers, emptied
+	struct OutputHeader Out = as->Out;
+	memset(&as->Out, 0, sizeof(as->Out));
+	as->Out.label = Out.label;
+	as->Out.labels_size = Out.labels_size;
+	as->Out.title.s = Out.title.s;
+	as->Out.title.size = Out.title.size;
+	if (Out.title.s) Out.title.s[0] = '\0';
+	as->Out.speed = DEFAULT_SPEED;
+	as->Out.monitor = DEFAULT_MONITOR;
+	as->Out.simdip = DEFAULT_SIMDIP;
+	as->diagnostic.code = NO_ERROR;
+	as->diagnostic.line = 0;
+	as->diagnostic.errors = 0;
+	as->diagnostic.message.length = 0;
+	if (as->diagnostic.message.s) as->diagnostic.message.s[0] = '\0';
+	as->output.length = 0;
+	if (as->output.s) as->output.s[0] = '\0';
+}
+
+void free_assembler(struct Assembler *as)
+{
+	if (!as) return;
+	reset_assembler(as);
+	free(as->In.lines);
+	free(as->In.tokens);
+	free(as->In.text.s);
+	free(as->In.symbols.symbol);
+	free(as->In.symbols.slot);
+	free(as->Out.label);
+	free(as->Out.title.s);
+	free(as->diagnostic.message.s);
+	free(as->output.s);
+	free(as);
+}
+
+/* Appends the n characters at s to the rendered output. */
+void put(struct Assembler *as, const char *s, size_t n)
+{
+	if (!appendn(&as->output, s, n)) error(as, MEMORY_ALLOCATION_ERROR);
+}
+
+/* Splits In.source from s until 'end', its end or end-of-transmit (Ctrl-D)
+into trimmed line views, and lexes them. Lines may have any length. */
+void read_lines(struct Assembler *as, const char *s, const char *end)
+{
+	while (*s && s != end) {
+		size_t n = strcspn(s, "\n\4"); // up to newline or Ctrl-D
+		size_t length = n;
+		const char *line = trim(s, &length); // whitespace and comments
+		enqueue(as, line, length, (int)(line - s));
+		s += n;
+		if (*s == 4) break; // end of transmit found
+		if (*s) s++; // skip the newline
+	}
+}
+
+/* Splits source into lines, and lexes them. */
+void read_source(struct Assembler *as, const char *source)
+{
+	as->In.source = source;
+	read_lines(as, source, NULL);
+}
+
+/* Replaces the lines [first, first + removed) of the previous source with
+the lines of the edited source that start at its byte 'start', and lexes
+only them. The following lines, which moved by delta bytes, keep their
+tokens. */
+void relex(struct Assembler *as, const char *source, int first, int removed,
+	size_t start, ptrdiff_t delta)
+{
+	struct InputHeader *In = &as->In;
+	if (removed < 0 || removed > In->lines_count - first) {
+		removed = In->lines_count - first; // up to the last line
+	}
+	int tail = first + removed; // first line after the edit
+	int lines = In->lines_count - tail; // number of lines after the edit
+	int token = lines ? In->lines[tail].first : In->count;
+	int tokens = In->count - token; // number of their tokens
+	// set the following lines and their tokens aside
+	struct Line *line = malloc((lines + 1) * sizeof(*line));
+	struct Token *tok = malloc((tokens + 1) * sizeof(*tok));
+	if (!line || !tok) {
+		free(line);
+		free(tok);
+		error(as, MEMORY_ALLOCATION_ERROR);
+	}
+	memcpy(line, In->lines + tail, lines * sizeof(*line));
+	memcpy(tok, In->tokens + token, tokens * sizeof(*tok));
+	const char *end = lines ? source + line[0].offset - line[0].column + delta
+		: NULL; // start of the following lines in the edited source
+	In->lines_count = first;
+	In->count = removed ? In->lines[first].first : token;
+	In->source = source;
+	read_lines(as, source + start, end);
+	// append the following lines, renumbered after the edited ones
+	int moved = In->lines_count - tail; // change in the number of lines
+	int shift = In->count - token; // change in the number of tokens
+	for (int i = 0; i < lines; i++) {
+		line[i].offset += delta;
+		line[i].first += shift;
+		*addline(as) = line[i];
+	}
+	for (int i = 0; i < tokens; i++) {
+		tok[i].line += moved;
+		*addtoken(as) = tok[i];
+	}
+	free(line);
+	free(tok);
+}
+
+/* Records the label and the relocation of the last value() in the word at
+Out.addr, so that it can be relocated when the label moves. */
+void reference(struct Assembler *as)
+{
+	WORD.label = as->In.label;
+	WORD.relocation = as->In.relocation;
+	WORD.section = as->In.section;
+}
+
+/* Moves Out.addr to the address of an .ORG, or up to the next multiple of
+the alignment of an .ALIGN, and marks the words that it skips over as free
+for the .DATA arrays. A label right before it names the new address.
+Returns 0 if the current token is neither directive.
+<directive> ::= ".ORG" <s+> <value> | ".ALIGN" <s+> <value> */
+int origin(struct Assembler *as)
+{
+	struct OutputHeader *Out = &as->Out;
+	int n, org = eq(TOKEN, ".ORG");
+	if (!org && !eq(TOKEN, ".ALIGN")) return 0;
+	if (as->object) error(as, ORIGIN_OBJECT);
+	nexttoken(as);
+	if (!evaluate(as, NULL, org ? 0 : 1, org ? RAM_SIZE : 128, &n)
+		|| as->In.relocation != ABSOLUTE_VALUE) error(as, ORIGIN);
+	int to = org ? n : (Out->addr + n - 1) / n * n;
+	if (to < Out->addr) error(as, ORIGIN_BACKWARD);
+	if (to > RAM_SIZE) error(as, RAM_LIMIT);
+	memset(Out->skipped + Out->addr, 1, to - Out->addr);
+	for (int i = Out->labels - 1; i >= 0 && Out->label[i].kind == CODE_LABEL
+		&& Out->label[i].val == Out->addr; i--) {
+		Out->label[i].val = (unsigned char)to;
+	}
+	Out->addr = (unsigned char)to;
+	return 1;
+}
+
+/* Collect labels (symbols).
+Label/value pairs are added to the "Out" structure, and duplicate labels are
+caught as they are added. Error checking is minimal in this stage. */
+void collect_symbols(struct Assembler *as)
+{
+	const struct Token *name; // label token
+	int n; // scratchpad value
+	as->Out.addr = 0; // current memory address in the "Out" structure
+	if (setjmp(as->resync)) {
+		nextline(as); // resume at the line after an error
+	} else {
+		firstline(as); // go to the first token of the queued code
+	}
+	while (as->In.current) { // read until the last line
+		if (eq(TOKEN, ".LABEL")) {
+			// <directive> ::= ".LABEL" <s+> <label> <s+> <value>
+			nexttoken(as);
+			if (!label(as, TOKEN)) error(as, LABEL); // <label>
+			addlabel(as, TOK, 0); // the value is evaluated in the next stage
+			as->Out.label[as->Out.labels - 1].state = UNRESOLVED;
+		} else if (eq(TOKEN, ".DATA")) {
+			// <directive> ::= ".DATA" <s+> <label> <s+> <array>
+			nexttoken(as);
+			if (!label(as, TOKEN)) error(as, LABEL); // <label>
+			addlabel(as, TOK, 0); // data labels are calculated after the code
+			as->Out.label[as->Out.labels - 1].kind = DATA_LABEL;
+			// count the words of the elements, which are a string or an
+			// expression each, separated by commas outside of parentheses
+			n = 0;
+			for (int element = 1, depth = 0; nexttoken(as); ) {
+				if (element) {
+					n += TOK->kind == STRING_TOKEN ? (int)strlen(TOKEN) - 2 : 1;
+				}
+				element = !depth && eq(TOKEN, ",");
+				depth += eq(TOKEN, "(") - eq(TOKEN, ")");
+			}
+			as->Out.label[as->Out.labels - 1].size = n;
+		} else if (eq(TOKEN, ".TABLE")) {
+			// <directive> ::= ".TABLE" <s+> <label> <s+> <range> <,> <value>
+			nexttoken(as);
+			if (!label(as, TOKEN)) error(as, LABEL); // <label>
+			addlabel(as, TOK, 0); // sized by its range before the layout
+			as->Out.label[as->Out.labels - 1].kind = DATA_LABEL;
+			as->Out.label[as->Out.labels - 1].size = -1;
+		} else if (eq(TOKEN, ".EXTERN")) {
+			// <directive> ::= ".EXTERN" <s+> <label>
+			nexttoken(as);
+			if (!label(as, TOKEN)) error(as, LABEL); // <label>
+			addlabel(as, TOK, 0); // resolved by the linker
+			as->Out.label[as->Out.labels - 1].kind = EXTERN_LABEL;
+			if (!as->object) error(as, EXTERN);
+		} else if (eq(TOKEN, ".RESERVE")) {
+			// <directive> ::= ".RESERVE" <s+> <label> <s+> <value>
+			nexttoken(as);
+			if (!label(as, TOKEN)) error(as, LABEL); // <label>
+			addlabel(as, TOK, 0); // sized and laid out after the .DATA
+			as->Out.label[as->Out.labels - 1].kind = RESERVED_LABEL;
+			as->Out.label[as->Out.labels - 1].size = -1;
+		} else if (origin(as)) {
+			// the code that follows starts at the new address
+		} else if ((n = instr_size(as))) {
+			// combines Out.addr++ and ram limit check for each word
+			while (n--) nextaddr(as);
+		} else if (label(as, TOKEN)) {
+			// consequtive labels are not allowed
+			if (as->Out.labels > 0
+				&& as->Out.label[as->Out.labels-1].kind == CODE_LABEL
+				&& as->Out.label[as->Out.labels-1].val == as->Out.addr) {
+				error(as, INSTRUCTION);
+			}
+			name = TOK;
+			// catch missing colons now, otherwise most instruction typos
+			// will be regarded as labels, causing syntactically correct
+			// but misleading errors at use sites during the second pass
+			if (!eq(nexttoken(as), ":")) error(as, INSTRUCTION_COLON);
+			addlabel(as, name, as->Out.addr);
+			as->Out.label[as->Out.labels - 1].kind = CODE_LABEL;
+			// check the next token instead of the next line to process
+			// <label:> <instruction> cases
+			nexttoken(as);
+			continue;
+		}
+		nextline(as);
+	}
+}
+
+/* Returns the number of commas from the current token to the end of the
+line, outside of parentheses. */
+int commas(const struct Assembler *as)
+{
+	int n = 0, depth = 0;
+	for (const struct Token *t = TOK; t->kind != END_TOKEN; t++) {
+		if (t->kind != PUNCTUATION_TOKEN) continue;
+		n += !depth && t->value == ',';
+		depth += (t->value == '(') - (t->value == ')');
+	}
+	return n;
+}
+
+/* Parses the range of a .TABLE after its label, and moves to the comma
+before its expression:
+<range> ::= <count> | <first> <,> <last> | <first> <,> <last> <,> <step>
+The index i counts from 0 to count - 1, or from first to last by the step,
+which defaults to 1 or -1. Sets the first index and the step, and returns
+the number of elements. */
+int table_range(struct Assembler *as, int *first, int *step)
+{
+	int arg[3];
+	int args = commas(as); // the last one precedes the expression
+	if (args < 1 || args > 3) error(as, TABLE);
+	for (int i = 0; i < args; i++) {
+		nexttoken(as);
+		if (!evaluate(as, NULL, INT_MIN, INT_MAX, &arg[i])) error(as, VALUE);
+		if (!eq(nexttoken(as), ",")) error(as, COMMA);
+	}
+	if (args == 1) {
+		*first = 0;
+		*step = 1;
+		if (arg[0] < 1 || arg[0] > RAM_SIZE) error(as, TABLE);
+		return arg[0];
+	}
+	*first = arg[0];
+	*step = args == 3 ? arg[2] : arg[1] < arg[0] ? -1 : 1;
+	long long count = *step ? ((long long)arg[1] - arg[0]) / *step + 1 : 0;
+	if (count < 1 || count > RAM_SIZE) error(as, TABLE);
+	return (int)count;
+}
+
+/* Returns the address of the first run of n free words below *end, and
+takes them, or else *end, which is moved past n words. */
+int fit(char *gap, int n, int *end)
+{
+	for (int a = 0, run = 0; a < *end && a < RAM_SIZE; a++) {
+		run = gap[a] ? run + 1 : 0;
+		if (run == n) {
+			memset(gap + a + 1 - n, 0, n);
+			return a + 1 - n;
+		}
+	}
+	*end += n;
+	return *end - n;
+}
+
+/* Sizes the .TABLE arrays by their ranges and the .RESERVE buffers, and
+lays them out with the .DATA arrays, so that expressions can refer to their
+addresses and sizes before they are parsed. The arrays fill the gaps that
+.ORG and .ALIGN left in the code, first fit in source order, or else go
+after the code, and the buffers, which take no words of the image, follow
+them the same way. */
+void layout_data(struct Assembler *as)
+{
+	struct OutputHeader *Out = &as->Out;
+	int i, n, first, step;
+	static const unsigned char kinds[2] = {DATA_LABEL, RESERVED_LABEL};
+	char gap[RAM_SIZE]; // words skipped by .ORG and .ALIGN that are free
+	if (setjmp(as->resync)) {
+		nextline(as); // resume at the line after an error
+	} else {
+		firstline(as);
+	}
+	while (as->In.current) {
+		if (eq(TOKEN, ".TABLE")) {
+			nexttoken(as);
+			// the label is missing if its line failed symbol collection
+			i = findlabel(as);
+			if (i >= 0) Out->label[i].size = table_range(as, &first, &step);
+		} else if (eq(TOKEN, ".RESERVE")) {
+			nexttoken(as);
+			i = findlabel(as);
+			nexttoken(as);
+			if (!evaluate(as, NULL, 1, RAM_SIZE, &n)
+				|| as->In.relocation != ABSOLUTE_VALUE) error(as, RESERVE);
+			if (i >= 0) Out->label[i].size = n;
+		}
+		nextline(as);
+	}
+	memcpy(gap, Out->skipped, sizeof(gap));
+	n = Out->addr; // the first address after the code
+	for (int k = 0; k < 2; k++) {
+		for (i = 0; i < Out->labels; i++) {
+			struct LabelElement *l = &Out->label[i];
+			if (l->kind != kinds[k]) continue;
+			l->val = (unsigned char)(l->size > 0 ? fit(gap, l->size, &n) : n);
+		}
+	}
+}
+
+/* Parse directives.
+E80 is designed according to the Neumann model where machine code and data
+are stored in the same area. However, .DATA arrays are checked against
+overwriting program code. */
+void parse_directives(struct Assembler *as)
+{
+	struct OutputHeader *Out = &as->Out;
+	const struct Token *first; // first token of an expression
+	const char *source; // the current source line
+	int i, n; // label index, scratchpad value
+	int count, start, step, index; // range and index of a .TABLE
+	if (setjmp(as->resync)) {
+		nextline(as); // resume at the line after an error
+	} else {
+		firstline(as);
+	}
+	while (as->In.current) {
+		if (eq(TOKEN, ".TITLE")) {
+			// <directive> ::= ".TITLE" <s+> <quoted_string>
+			if (Out->title.length) error(as, DUPLICATE_TITLE); // previously set
+			nexttoken(as);
+			if (TOKEN[0] != '"') error(as, UNQUOTED_TITLE);
+			if (!append(&Out->title, "%.*s", (int)strlen(TOKEN) - 2, TOKEN + 1)) {
+				error(as, MEMORY_ALLOCATION_ERROR); // unquoted copy
+			}
+		} else if (eq(TOKEN, ".MONITOR")) {
+			// <directive> ::= ".MONITOR" <s+> <value>
+			nexttoken(as);
+			Out->monitor = value(as);
+			Out->monitor_label = as->In.label;
+			Out->monitor_relocation = as->In.relocation;
+			Out->monitor_section = as->In.section;
+		} else if (eq(TOKEN, ".SPEED")) {
+			// <directive> ::= ".SPEED" <s+> <level>
+			nexttoken(as);
+			Out->speed = literal(as);
+			if (Out->speed < MIN_SPEED || Out->speed > MAX_SPEED) {
+				error(as, SPEED);
+			}
+		} else if (eq(TOKEN, ".SIMDIP")) {
+			// <directive> ::= ".SIMDIP" <s+> <value>
+			nexttoken(as);
+			Out->simdip = (uint8_t) value(as);
+		} else if (eq(TOKEN, ".LABEL")) {
+			// <directive> ::= ".LABEL" <s+> <label> <s+> <value>
+			nexttoken(as);
+			i = findlabel(as);
+			// the label is missing if its line failed symbol collection
+			if (i < 0) error(as, LABEL);
+			nexttoken(as);
+			Out->label[i].state = RESOLVING; // it can't refer to itself
+			n = value(as);
+			if (n < 0) {
+				// a malformed number, or a label without a value
+				error(as, !*TOKEN || number(TOKEN) != NUMBER_ERROR
+					? NUMBER : VALUE);
+			}
+			if (as->In.relocation != ABSOLUTE_VALUE) error(as, CONSTANT);
+			Out->label[i].val = (unsigned char)n;
+			Out->label[i].state = RESOLVED;
+		} else if (eq(TOKEN, ".TABLE")) {
+			// <directive> ::= ".TABLE" <s+> <label> <s+> <range> <,> <value>
+			nexttoken(as);
+			i = findlabel(as);
+			// the label is missing if its line failed symbol collection
+			if (i < 0) error(as, LABEL);
+			Out->addr = Out->label[i].val; // as laid out
+			count = table_range(as, &start, &step);
+			nexttoken(as);
+			first = TOK;
+			source = as->In.source + as->In.current->offset
+				- as->In.current->column;
+			// evaluate the expression for each index
+			for (int k = 0; k < count; k++) {
+				index = start + k * step;
+				seektoken(as, (int)(first - as->In.tokens));
+				if (!evaluate(as, &index, -128, 255, &n)) error(as, VALUE);
+				RAM = (uint8_t) n;
+				tagword(as, DATA_WORD);
+				reference(as);
+				// add the index and the expression as a comment
+				snprintf(COMMENT, MAX_COMMENT_LENGTH, "i=%d: %.*s", index,
+					TOK->column + TOK->length - first->column,
+					source + first->column);
+				nextaddr(as);
+			}
+		} else if (eq(TOKEN, ".EXTERN")) {
+			nexttoken(as); // label was added during symbol collection
+		} else if (eq(TOKEN, ".RESERVE")) {
+			// <directive> ::= ".RESERVE" <s+> <label> <s+> <value>
+			nexttoken(as);
+			i = findlabel(as);
+			// the label is missing if its line failed symbol collection
+			if (i < 0) error(as, LABEL);
+			nexttoken(as);
+			if (!evaluate(as, NULL, 1, RAM_SIZE, &n)) error(as, RESERVE);
+			// the buffer takes no words, but it must fit in RAM
+			if (Out->label[i].val + n > RAM_SIZE) error(as, RAM_LIMIT);
+		} else if (eq(TOKEN, ".DATA")) {
+			// <directive> ::= ".DATA" <s+> <label> <s+> <array>
+			nexttoken(as);
+			// the label is missing if its line failed symbol collection
+			if (findlabel(as) < 0) error(as, LABEL);
+			Out->addr = Out->label[findlabel(as)].val; // as laid out
+			source = as->In.source + as->In.current->offset
+				- as->In.current->column;
+			do {
+				nexttoken(as);
+				if (!array_element(as)) error(as, ARRAY_ELEMENT);
+				// <array_element> ::= <value> | <quoted_string>
+				if (TOK->kind != STRING_TOKEN) {
+					// <value>, write on the RAM
+					first = TOK;
+					n = value(as);
+					if (n < 0) error(as, ARRAY_ELEMENT);
+					RAM = (uint8_t) n;
+					tagword(as, DATA_WORD);
+					reference(as);
+					// add the original expression as a comment
+					snprintf(COMMENT, MAX_COMMENT_LENGTH, "%.*s",
+						TOK->column + TOK->length - first->column,
+						source + first->column);
+					nextaddr(as);
+				} else {
+					// <quoted_string> ::= "\"" <char+> "\""
+					// skip quotes and write each character's ASCII
+					// value on the RAM
+					for (unsigned int i = 1; i < strlen(TOKEN) -1; i++) {
+						RAM = (uint8_t) TOKEN[i];
+						tagword(as, DATA_WORD);
+						// add each character as a comment
+						sprintf(COMMENT, "'%c' (%d)", TOKEN[i], TOKEN[i]);
+						nextaddr(as);
+					}
+				}
+				// <array> ::= <array_element> | <array_element> <,> <array>
+			} while (eq(nexttoken(as), ","));
+			if (!eq(TOKEN, "")) error(as, COMMA);
+		} else if (eq(TOKEN, ".ORG") || eq(TOKEN, ".ALIGN")) {
+			break; // they place the code, which starts here
+		} else if (TOKEN[0] == '.') {
+			error(as, DIRECTIVE);
+		} else if (!eq(TOKEN, "")) {
+			// a non empty token which is not a directive ⇒ end of directives
+			break;
+		}
+		if (nexttoken(as)) error(as, EXTRANEOUS);
+		nextline(as);
+	}
+}
+
+/* Parse instructions according to the BNF syntax rules.
+The parser functions (instr_argumentless, instr_n, etc) handle syntax
+checking, translation and write the opcode to the "Out" structure's	array.
+The remaining bits are filled by the code below. The RAM and WORD macros
+specify the binary word and its metadata at Out.addr. The last word of each
+instruction refers to its mnemonic token, from which the comment of the
+instruction is disassembled when it's rendered. The words of two-word
+instructions are tagged as INSTRUCTION_WORD and OPERAND_WORD, which allows
+to create well-formatted VHDL code where each instruction is writen in one
+line.
+Parsing continues from the first line after the directives. */
+void parse_instructions(struct Assembler *as)
+{
+	int mnemonic; // index of the instruction's token, plus 1
+	int reg, reg2; // register address
+	int n; // scratchpad value
+	as->Out.addr = 0;
+	if (setjmp(as->resync)) nextline(as); // resume at the line after an error
+	while (as->In.current) {
+		mnemonic = (int)(TOK - as->In.tokens) + 1;
+		if ((instr_noarg(as))) {
+			// <[instruction]> ::= <instr_noarg>
+			tagword(as, INSTRUCTION_WORD);
+			WORD.mnemonic = mnemonic;
+			nextaddr(as);
+		} else if (origin(as)) {
+			// <[instruction]> ::= <directive>, of .ORG or .ALIGN
+		} else if (instr_reg(as)) {
+			// <[instruction]> ::= <instr_reg> <s+> <reg>
+			nexttoken(as);
+			reg = regnum(as);
+			if (reg < 0) error(as, REGISTER);
+			RAM |= reg; // <reg> in Instr1[2:0]
+			tagword(as, INSTRUCTION_WORD);
+			WORD.mnemonic = mnemonic;
+			nextaddr(as);
+		} else if (instr_n(as)) {
+			// <[instruction]>  ::= <instr_n> <s+> <value>
+			nexttoken(as);
+			n = value(as);
+			if (n < 0) error(as, VALUE);
+			tagword(as, INSTRUCTION_WORD);
+			nextaddr(as);
+			RAM = (uint8_t) n; // <value>
+			tagword(as, OPERAND_WORD);
+			reference(as);
+			WORD.mnemonic = mnemonic;
+			nextaddr(as);
+		} else if (instr_reg_op2(as)) {
+			// <instruction> ::= <instr_reg_op2> <s+> <reg> <,> <op2>
+			char bracket_op2 = load_store(as); // op2 must be bracketed
+			nexttoken(as);
+			reg = regnum(as);
+			if (reg < 0) error(as, REGISTER);
+			if (!eq(nexttoken(as), ",")) error(as, COMMA);
+			nexttoken(as);
+			if (bracket_op2) {
+				if (!eq(TOKEN,"[")) error(as, LEFTBRACKET);
+				nexttoken(as);
+			}
+			n = value(as);
+			reg2 = regnum(as);
+			if (n >= 0) {
+				// op2 = <value>
+				RAM |= reg; // <reg> in Instr1[3:0]
+				tagword(as, INSTRUCTION_WORD);
+				nextaddr(as);
+				RAM = (uint8_t) n; // <number> in Instr2
+				tagword(as, OPERAND_WORD);
+				reference(as);
+			} else if (reg2 >= 0) {
+				// op2 = <reg>
+				RAM |= 0x08; // Instr1[3:0] = "1000"
+				tagword(as, INSTRUCTION_WORD);
+				nextaddr(as);
+				// <reg> in Instr2[7:4], <reg> (op2) in Instr2[3:0]
+				RAM = (uint8_t)(reg << 4 | reg2);
+				tagword(as, OPERAND_WORD);
+			} else {
+				error(as, OP2);
+			}
+			if (bracket_op2 && !eq(nexttoken(as),"]")) error(as, RIGHTBRACKET);
+			WORD.mnemonic = mnemonic;
+			nextaddr(as);
+		} else if (findlabel(as) != -1) {
+			// label syntax was checked during symbol collection
+			nexttoken(as);
+			nexttoken(as);
+			continue;
+		} else if (!eq(TOKEN, "")) {
+			error(as, INSTRUCTION_LABEL);
+		}
+		if (nexttoken(as)) error(as, EXTRANEOUS);
+		nextline(as);
+	}
+}
+
+/* Appends space characters to line until column, and at least one. */
+int pad(char *line, int len, int column)
+{
+	do line[len++] = ' '; while (len < column);
+	return len;
+}
+
+/* Render the machine code of the RAM image.
+Each instruction reserves one line, followed by a comment specifying the
+instruction in hex and the disassembled mnemonic. The binary image is
+formatted to VHDL bit strings and hex digits only here, and each line is
+built in place and appended to the output at once. */
+void emit_code(struct Assembler *as)
+{
+	struct OutputHeader *Out = &as->Out;
+	char line[128]; // a line of VHDL assignments and their comment
+	char comment[MAX_COMMENT_LENGTH]; // disassembled comment
+	int len = 0; // line length
+	char hex[5] = {0}; // hex conversion string (max 4 digits)
+	for (Out->addr = 0; Out->addr < RAM_SIZE; Out->addr++) {
+		if (WORD.type == UNUSED_WORD) continue; // OTHERS in VHDL
+		/* Write the instruction address in the end of the current
+		line; this allows for two-word instructions to have
+		both parts in the same line, such as:
+		addr => "instr1", addr+1 => "instr2" -- comment
+		or, for single-word instructions:
+		addr => "instr1",                    -- comment. */
+		len += decimal(line + len, Out->addr);
+		if (WORD.type != OPERAND_WORD) {
+			// space after the address in the 1st part of the line
+			// this allows for 1-3 address digits
+			len = pad(line, len, 4);
+			// write the hexadecimal conversion of the binary instruction
+			// or "data" if the word is from .DATA
+			if (WORD.type == DATA_WORD) {
+				strcpy(hex, "data");
+			} else {
+				hexadecimal(hex, RAM); // instr1 to hex part of comment
+			}
+		} else {
+			// space after the address in the 2nd part of the line
+			len = pad(line, len, 23);
+			hexadecimal(hex + 2, RAM); // instr2 to hex part of comment
+		}
+		// write the VHDL assignment of the word after the address
+		memcpy(line + len, "=> \"", 4);
+		binary(line + len + 4, RAM);
+		memcpy(line + len + 12, "\", ", 3);
+		len += 15;
+		if (Out->word[Out->addr + 1].type != OPERAND_WORD) {
+			// comments are written after single-word instructions
+			// or after the 2nd part of two-word instructions,
+			// streamlined for both instruction types
+			len = pad(line, len, 39);
+			memcpy(line + len, "-- ", 3);
+			len += 3;
+			int column = len + 6; // the hex part is padded to 6 characters
+			for (int i = 0; hex[i]; i++) line[len++] = hex[i];
+			while (len < column) line[len++] = ' ';
+			const char *text = listing_comment(as, Out->addr, comment);
+			size_t n = strlen(text);
+			memcpy(line + len, text, n);
+			len += (int)n;
+			line[len++] = '\n';
+			put(as, line, len);
+			len = 0; // prepare for new line
+			hex[0] = 0; // prepare for new hex conversion
+		}
+	}
+}
+
+/* Render the VHDL code through the compiled template. */
+void emit(struct Assembler *as, const struct Template *template)
+{
+	struct OutputHeader *Out = &as->Out;
+	char value[9]; // formatted directive value
+	for (int i = 0; i < template->count; i++) {
+		const struct Segment *segment = &template->segment[i];
+		switch (segment->kind) {
+		case LITERAL_SEGMENT:
+			put(as, template->text.s + segment->offset, segment->length);
+			break;
+		case TITLE_SEGMENT:
+			if (Out->title.length) {
+				put(as, Out->title.s, Out->title.length);
+			} else {
+				put(as, DEFAULT_TITLE, strlen(DEFAULT_TITLE));
+			}
+			break;
+		case SIMDIP_SEGMENT:
+			binary(value, Out->simdip);
+			put(as, value, 8);
+			break;
+		case SPEED_SEGMENT:
+			put(as, value, decimal(value, Out->speed));
+			break;
+		case MONITOR_SEGMENT:
+			put(as, value, decimal(value, Out->monitor));
+			break;
+		case MACHINE_CODE_SEGMENT:
+			emit_code(as);
+			break;
+		}
+	}
+}
+
+/* Runs the assembly passes over the token stream, and renders it if there
+were no errors. Returns the code of the first error, or NO_ERROR. */
+enum ErrorCode passes(struct Assembler *as, const struct Template *template)
+{
+	TIMED(as, SYMBOLS_PHASE, collect_symbols(as));
+	TIMED(as, SYMBOLS_PHASE, layout_data(as));
+	TIMED(as, DIRECTIVES_PHASE, parse_directives(as));
+	TIMED(as, INSTRUCTIONS_PHASE, parse_instructions(as));
+	if (as->diagnostic.errors) return summarize(as);
+	if (as->optimize && !as->object) TIMED(as, OPTIMIZE_PHASE, optimize(as));
+	if (template) TIMED(as, EMIT_PHASE, emit(as, template));
+	return NO_ERROR;
+}
+
+enum ErrorCode assemble(
+	struct Assembler *as, const char *source, const struct Template *template)
+{
+	reset_assembler(as);
+	// error() jumps back here, after recording the diagnostic
+	if (setjmp(as->abort)) return summarize(as);
+	TIMED(as, READ_PHASE, read_source(as, source));
+	return passes(as, template);
+}
+
+enum ErrorCode update(struct Assembler *as, const char *source, int first,
+	int removed, size_t start, ptrdiff_t delta, const struct Template *template)
+{
+	struct InputHeader *In = &as->In;
+	size_t length = strlen(source);
+	// texts of replaced tokens are left behind in In.text, so start over
+	// once they outweigh the source
+	if (!In->source || first < 0 || first > In->lines_count || start > length
+		|| memchr(source, 4, length) || In->text.length > 4 * length + 4096) {
+		return assemble(as, source, template);
+	}
+	reset_output(as);
+	for (int i = 0; i < In->symbols.count; i++) In->symbols.symbol[i].label = -1;
+	if (setjmp(as->abort)) {
+		// a failed relex leaves the lines incomplete
+		if (as->diagnostic.code == MEMORY_ALLOCATION_ERROR) In->source = NULL;
+		return summarize(as);
+	}
+	TIMED(as, READ_PHASE, relex(as, source, first, removed, start, delta));
+	return passes(as, template);
+}
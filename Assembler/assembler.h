@@ -0,0 +1,47 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Assembler library headers
+
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include "data_structures.h"
+#include "template.h"
+
+/* Allocates an empty assembler context. Returns NULL if memory can't be
+allocated. */
+struct Assembler* new_assembler(void);
+
+/* Frees the lines and labels of a previous assembly and resets the context for
+a new one, keeping its allocated buffers. */
+void reset_assembler(struct Assembler *as);
+
+/* Resets the output of the context, keeping its lines and tokens. */
+void reset_output(struct Assembler *as);
+
+/* Assembles the null-terminated source, and renders it through the compiled
+template to as->output, unless the template is NULL. The context is reset
+first, so it can be reused for any number of assemblies. Errors don't stop
+the assembly at the first one; all independent errors are recorded in
+as->diagnostic, up to MAX_ERRORS, along with their reports. Returns NO_ERROR
+on success, or the code of the first error in line order.
+The translated RAM image and the labels are left in as->Out, after the
+optimizer if as->optimize is set (see optimize()). */
+enum ErrorCode assemble(
+	struct Assembler *as, const char *source, const struct Template *template);
+
+/* Reassembles the edited source of the previous assembly, lexing only its
+edited lines: the lines [first, first + removed) of the previous source were
+replaced by the lines that start at byte 'start' of the edited one, and the
+following lines moved by delta bytes. Falls back to assemble() if there's no
+previous assembly. Returns like assemble(). */
+enum ErrorCode update(struct Assembler *as, const char *source, int first,
+	int removed, size_t start, ptrdiff_t delta, const struct Template *template);
+
+/* Renders the RAM image and the directive values of as->Out through the
+compiled template to as->output. */
+void emit(struct Assembler *as, const struct Template *template);
+
+/* Releases all memory held by the context, including the context itself. */
+void free_assembler(struct Assembler *as);
+
+#endif
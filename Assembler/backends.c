@@ -0,0 +1,156 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Output backends; writes the RAM image to memory initialization files
+
+#include <stdio.h>
+#include <setjmp.h>
+
+#include "backends.h"
+#include "c_backend.h"
+#include "assembler.h"
+#include "error_handler.h"
+#include "parse_functions.h"
+#include "stats.h"
+
+#define RECORD_SIZE 16 // words per line of the Intel HEX, .mem and .coe files
+
+const char* title(const struct Assembler *as)
+{
+	return as->Out.title.length ? as->Out.title.s : DEFAULT_TITLE;
+}
+
+/* Raw binary, one byte per word. */
+int render_bin(const struct Assembler *as, struct Text *t)
+{
+	for (int addr = 0; addr < 256; addr++) {
+		if (!append(t, "%c", as->Out.mem[addr])) return 0;
+	}
+	return 1;
+}
+
+/* Intel HEX data records of RECORD_SIZE words, and the end-of-file record. */
+int render_ihex(const struct Assembler *as, struct Text *t)
+{
+	for (int addr = 0; addr < 256; addr += RECORD_SIZE) {
+		// the checksum is the 2's complement of the sum of the record bytes
+		int sum = RECORD_SIZE + (addr >> 8) + (addr & 0xFF); // type 00
+		if (!append(t, ":%02X%04X00", RECORD_SIZE, addr)) return 0;
+		for (int i = 0; i < RECORD_SIZE; i++) {
+			sum += as->Out.mem[addr + i];
+			if (!append(t, "%02X", as->Out.mem[addr + i])) return 0;
+		}
+		if (!append(t, "%02X\n", -sum & 0xFF)) return 0;
+	}
+	return append(t, ":00000001FF\n");
+}
+
+/* Verilog $readmemh, one word per line; also read by RAM.vhd of FileRAM. */
+int render_readmemh(const struct Assembler *as, struct Text *t)
+{
+	for (int addr = 0; addr < 256; addr++) {
+		if (!append(t, "%02X\n", as->Out.mem[addr])) return 0;
+	}
+	return 1;
+}
+
+/* Quartus Memory Initialization File, with the disassembly comments. */
+int render_mif(const struct Assembler *as, struct Text *t)
+{
+	const struct OutputHeader *Out = &as->Out;
+	char bits[9]; // binary word
+	char text[MAX_COMMENT_LENGTH]; // disassembled comment
+	if (!append(t, "-- %s\nWIDTH=8;\nDEPTH=256;\n"
+		"ADDRESS_RADIX=UNS;\nDATA_RADIX=BIN;\nCONTENT BEGIN\n", title(as))) {
+		return 0;
+	}
+	for (int addr = 0; addr < 256; addr++) {
+		binary(bits, Out->mem[addr]);
+		if (!append(t, "\t%-3d : %s;", addr, bits)) return 0;
+		const char *comment = addr < RAM_SIZE
+			? listing_comment(as, addr, text) : "";
+		if (*comment && !append(t, " -- %s", comment)) return 0;
+		if (!append(t, "\n")) return 0;
+	}
+	return append(t, "END;\n");
+}
+
+/* Gowin memory initialization file, one word per line. */
+int render_mi(const struct Assembler *as, struct Text *t)
+{
+	if (!append(t, "#File_format=Hex\n#Address_depth=256\n#Data_width=8\n")) {
+		return 0;
+	}
+	return render_readmemh(as, t);
+}
+
+/* Xilinx updatemem/data2mem .mem file, with RECORD_SIZE words per line. */
+int render_mem(const struct Assembler *as, struct Text *t)
+{
+	if (!append(t, "// %s\n@0000\n", title(as))) return 0;
+	for (int addr = 0; addr < 256; addr++) {
+		int last = addr % RECORD_SIZE == RECORD_SIZE - 1;
+		if (!append(t, last ? "%02X\n" : "%02X ", as->Out.mem[addr])) return 0;
+	}
+	return 1;
+}
+
+/* Xilinx coefficients file, with RECORD_SIZE words per line. */
+int render_coe(const struct Assembler *as, struct Text *t)
+{
+	if (!append(t, "; %s\nmemory_initialization_radix=16;\n"
+		"memory_initialization_vector=\n", title(as))) {
+		return 0;
+	}
+	for (int addr = 0; addr < 256; addr++) {
+		const char *separator = addr == 255 ? ";\n"
+			: addr % RECORD_SIZE == RECORD_SIZE - 1 ? ",\n" : ", ";
+		if (!append(t, "%02X%s", as->Out.mem[addr], separator)) return 0;
+	}
+	return 1;
+}
+
+const struct Backend backends[BACKENDS] = {
+	{"vhdl",     OUTPUT_EXTENSION, 0, NULL},
+	{"bin",      ".bin",           1, render_bin},
+	{"ihex",     ".hex",           0, render_ihex},
+	{"readmemh", ".memh",          0, render_readmemh},
+	{"mif",      ".mif",           0, render_mif},
+	{"mi",       ".mi",            0, render_mi},
+	{"mem",      ".mem",           0, render_mem},
+	{"coe",      ".coe",           0, render_coe},
+	{"c",        ".c",             0, render_c},
+};
+
+const struct Backend* backend(const char *s)
+{
+	for (int i = 0; i < BACKENDS; i++) {
+		if (eq(s, backends[i].name)) return &backends[i];
+	}
+	return NULL;
+}
+
+enum ErrorCode render_image(struct Assembler *as,
+	const struct Template *template, const struct Backend *b)
+{
+	int rendered = 1;
+	if (!b->render) {
+		// put() jumps back here if the output can't be allocated
+		if (setjmp(as->abort)) return summarize(as);
+		TIMED(as, EMIT_PHASE, emit(as, template));
+		return NO_ERROR;
+	}
+	TIMED(as, EMIT_PHASE, rendered = b->render(as, &as->output));
+	if (!rendered) {
+		diagnose(as, MEMORY_ALLOCATION_ERROR);
+		return MEMORY_ALLOCATION_ERROR;
+	}
+	return NO_ERROR;
+}
+
+enum ErrorCode translate(struct Assembler *as, const char *source,
+	const struct Template *template, const struct Backend *b)
+{
+	if (!b->render) return assemble(as, source, template);
+	enum ErrorCode result = assemble(as, source, NULL); // no VHDL to render
+	if (result != NO_ERROR) return result;
+	return render_image(as, NULL, b);
+}
@@ -0,0 +1,47 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Output backends headers
+
+#ifndef BACKENDS_H
+#define BACKENDS_H
+
+#include "data_structures.h"
+#include "template.h"
+
+#define BACKENDS 9 // output formats in the backends table
+
+/* Output format of an assembly. Besides the VHDL package of the template,
+the RAM image can be written to the memory initialization files of FPGA
+and simulation tools, so that a program can be swapped without touching
+the VHDL sources. Unused words are written as zeroes in memory files. */
+struct Backend {
+	const char *name; // --format argument
+	const char *extension; // output file extension, for batch assemblies
+	char binary; // the output is no text
+	/* Writes the RAM image of an assembly to t in this format. Returns 0 if
+	memory can't be allocated. NULL for the VHDL package, which is rendered
+	through the template. */
+	int (*render)(const struct Assembler *as, struct Text *t);
+};
+
+/* Returns the .TITLE of the assembly, or the default one. */
+const char* title(const struct Assembler *as);
+
+/* The backends table; the first entry is the default VHDL package. */
+extern const struct Backend backends[BACKENDS];
+
+/* Returns the backend named s, case-insensitively, or NULL. */
+const struct Backend* backend(const char *s);
+
+/* Renders the RAM image of as->Out, as left by an assembly or a link, to
+as->output in the format of backend b, through the template for the VHDL
+package. Returns NO_ERROR, or MEMORY_ALLOCATION_ERROR. */
+enum ErrorCode render_image(struct Assembler *as,
+	const struct Template *template, const struct Backend *b);
+
+/* Assembles the null-terminated source like assemble() does, and leaves its
+output in the format of backend b in as->output, whose length is also valid
+for binary formats. The template is used only by the VHDL package. */
+enum ErrorCode translate(struct Assembler *as, const char *source,
+	const struct Template *template, const struct Backend *b);
+
+#endif
@@ -0,0 +1,383 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Batch assembly on a work-stealing thread pool
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // threads, directories and sysconf in ISO C
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define PATH_SEPARATOR "\\"
+#else
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#define PATH_SEPARATOR "/"
+#endif
+
+#include "batch.h"
+#include "assembler.h"
+#include "backends.h"
+#include "error_handler.h"
+#include "data_structures.h"
+#include "parse_functions.h"
+
+/* Minimal thread and mutex wrappers over the Windows API and POSIX threads. */
+#ifdef _WIN32
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+#define mutex_init(m) InitializeCriticalSection(m)
+#define mutex_lock(m) EnterCriticalSection(m)
+#define mutex_unlock(m) LeaveCriticalSection(m)
+#define mutex_destroy(m) DeleteCriticalSection(m)
+#else
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+#define mutex_init(m) pthread_mutex_init(m, NULL)
+#define mutex_lock(m) pthread_mutex_lock(m)
+#define mutex_unlock(m) pthread_mutex_unlock(m)
+#define mutex_destroy(m) pthread_mutex_destroy(m)
+#endif
+
+/* Paths and assembly result of a source file, kept for the summary. */
+struct BatchFile {
+	char *source; // source path
+	char *output; // output path
+	enum ErrorCode code;
+	char *message; // diagnostic report if the assembly failed
+};
+
+/* Range of file indexes queued on a worker. The owner takes files from the
+front, while idle workers steal them from the back. */
+struct Deque {
+	Mutex lock;
+	int front;
+	int back; // one past the last file
+};
+
+/* State shared by all workers. */
+struct Pool {
+	struct BatchFile *files;
+	int count; // number of files
+	const struct Template *template; // read-only
+	const struct Backend *backend; // output format
+	char optimize; // -O switch
+	const struct Rules *rules; // superoptimizer rules (--rules), or NULL
+	struct Deque *deques; // one per worker
+	int workers;
+};
+
+/* Thread argument. */
+struct Worker {
+	struct Pool *pool;
+	int id; // index of the worker's own deque
+	Thread thread;
+};
+
+/* Returns a malloc'd copy of the concatenation of s1 and s2, or NULL. */
+char* concat(const char *s1, const char *s2)
+{
+	char *s = malloc(strlen(s1) + strlen(s2) + 1);
+	if (s) {
+		strcpy(s, s1);
+		strcat(s, s2);
+	}
+	return s;
+}
+
+/* Returns 1 if the path ends with SOURCE_EXTENSION, case-insensitively. */
+char is_source(const char *path)
+{
+	size_t len = strlen(path);
+	size_t ext = strlen(SOURCE_EXTENSION);
+	return len > ext && eq(path + len - ext, SOURCE_EXTENSION);
+}
+
+/* Appends a source path to the file list, deriving its output path by
+replacing the extension. Returns 0 if memory can't be allocated. */
+int addfile(struct Pool *pool, const char *source)
+{
+	struct BatchFile *files = realloc(
+		pool->files, (pool->count + 1) * sizeof(*files));
+	if (!files) return 0;
+	pool->files = files;
+	struct BatchFile *file = &files[pool->count];
+	memset(file, 0, sizeof(*file));
+	file->code = MEMORY_ALLOCATION_ERROR; // until it's assembled
+	file->source = concat(source, "");
+	if (!file->source) return 0;
+	pool->count++;
+	// cut the extension after the last dot of the file name
+	char *base = concat(source, "");
+	if (!base) return 0;
+	char *dot = strrchr(base, '.');
+	if (dot && !strpbrk(dot, "/\\")) *dot = '\0';
+	file->output = concat(base, pool->backend->extension);
+	free(base);
+	return file->output != NULL;
+}
+
+/* Compares the source paths of BatchFiles a and b. */
+int comparefiles(const void* a, const void* b)
+{
+	return strcmp(
+		((struct BatchFile*)a)->source, ((struct BatchFile*)b)->source);
+}
+
+/* Adds the source files of directory 'dir' in alphabetical order.
+Returns 0 if 'dir' is not a directory or memory can't be allocated. */
+int listdir(struct Pool *pool, const char *dir)
+{
+	char *path;
+	int ok = 1;
+#ifdef _WIN32
+	DWORD attributes = GetFileAttributesA(dir);
+	if (attributes == INVALID_FILE_ATTRIBUTES) return 0;
+	if (!(attributes & FILE_ATTRIBUTE_DIRECTORY)) return 0;
+	WIN32_FIND_DATAA entry;
+	char *pattern = concat(dir, PATH_SEPARATOR "*");
+	if (!pattern) return 0;
+	HANDLE find = FindFirstFileA(pattern, &entry);
+	free(pattern);
+	if (find == INVALID_HANDLE_VALUE) return 1; // empty directory
+	do {
+		if (!is_source(entry.cFileName)) continue;
+		char *prefix = concat(dir, PATH_SEPARATOR);
+		path = prefix ? concat(prefix, entry.cFileName) : NULL;
+		free(prefix);
+		ok = path && addfile(pool, path);
+		free(path);
+	} while (ok && FindNextFileA(find, &entry));
+	FindClose(find);
+#else
+	DIR *d = opendir(dir);
+	if (!d) return 0;
+	struct dirent *entry;
+	while (ok && (entry = readdir(d))) {
+		if (!is_source(entry->d_name)) continue;
+		char *prefix = concat(dir, PATH_SEPARATOR);
+		path = prefix ? concat(prefix, entry->d_name) : NULL;
+		free(prefix);
+		ok = path && addfile(pool, path);
+		free(path);
+	}
+	closedir(d);
+#endif
+	// directory order is arbitrary; sort for a reproducible summary
+	if (ok) qsort(pool->files, pool->count, sizeof(*pool->files), comparefiles);
+	return ok;
+}
+
+/* Adds the source files listed one per line in the text file 'list'.
+Returns 0 if the list can't be read or memory can't be allocated. */
+int listfile(struct Pool *pool, const char *list)
+{
+	FILE *f = fopen(list, "r");
+	if (!f) return 0;
+	char *text = readall(f);
+	fclose(f);
+	if (!text) return 0;
+	const char *src = text;
+	char path[FILENAME_MAX];
+	int ok = 1;
+	while (ok && sgets(path, FILENAME_MAX, &src)) {
+		// trim trailing whitespace and newline
+		size_t len = strlen(path);
+		while (len && isspace((unsigned char)path[len-1])) path[--len] = '\0';
+		if (len) ok = addfile(pool, path);
+	}
+	free(text);
+	return ok;
+}
+
+/* Returns the number of online processor cores. */
+int cores(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+#endif
+}
+
+/* Returns the index of the next file for worker 'id', taken from the front
+of its own deque, or stolen from the back of another worker's deque.
+Returns -1 when all deques are empty. */
+int take(struct Pool *pool, int id)
+{
+	int job = -1;
+	for (int i = 0; i < pool->workers && job < 0; i++) {
+		// start from the worker's own deque, then visit the neighbors
+		struct Deque *d = &pool->deques[(id + i) % pool->workers];
+		mutex_lock(&d->lock);
+		if (d->front < d->back) job = i ? --d->back : d->front++;
+		mutex_unlock(&d->lock);
+	}
+	return job;
+}
+
+/* Copies the diagnostic of the assembler context to the file result. */
+void record(struct BatchFile *file, struct Assembler *as)
+{
+	file->code = as->diagnostic.code;
+	free(file->message);
+	file->message = NULL;
+	if (file->code != NO_ERROR) {
+		file->message = concat(as->diagnostic.message.s, "");
+	}
+}
+
+/* Assembles a single file with the worker's context, and writes its output. */
+void assemble_file(struct Assembler *as, const struct Pool *pool,
+	struct BatchFile *file)
+{
+	char *source = NULL;
+	FILE *f = fopen(file->source, "r");
+	if (f) {
+		source = readall(f);
+		fclose(f);
+	}
+	if (!source) {
+		reset_assembler(as);
+		diagnose(as, OPEN_SOURCE);
+	} else if (translate(as, source, pool->template, pool->backend)
+		== NO_ERROR) {
+		f = fopen(file->output, pool->backend->binary ? "wb" : "w");
+		size_t length = as->output.length;
+		int written = f && fwrite(as->output.s, 1, length, f) == length;
+		if (f && fclose(f) == EOF) written = 0;
+		if (!written) diagnose(as, WRITE_OUTPUT);
+	}
+	free(source);
+	record(file, as);
+}
+
+/* Worker loop; a single assembler context is reused for all its files. */
+void work(struct Worker *worker)
+{
+	struct Pool *pool = worker->pool;
+	struct Assembler *as = new_assembler();
+	if (!as) return; // its files will be stolen by the other workers
+	as->optimize = pool->optimize;
+	as->rules = pool->rules;
+	int job;
+	while ((job = take(pool, worker->id)) >= 0) {
+		assemble_file(as, pool, &pool->files[job]);
+	}
+	free_assembler(as);
+}
+
+#ifdef _WIN32
+DWORD WINAPI run_worker(LPVOID arg)
+{
+	work(arg);
+	return 0;
+}
+#else
+void* run_worker(void *arg)
+{
+	work(arg);
+	return NULL;
+}
+#endif
+
+/* Starts the workers, with the files evenly distributed to their deques, and
+waits for all of them to finish. Returns 0 if no worker could be started. */
+int run_pool(struct Pool *pool)
+{
+	int started = 0;
+	struct Worker *workers = calloc(pool->workers, sizeof(*workers));
+	pool->deques = calloc(pool->workers, sizeof(*pool->deques));
+	if (!workers || !pool->deques) {
+		free(workers);
+		return 0;
+	}
+	for (int i = 0; i < pool->workers; i++) {
+		mutex_init(&pool->deques[i].lock);
+		pool->deques[i].front = pool->count * i / pool->workers;
+		pool->deques[i].back = pool->count * (i + 1) / pool->workers;
+	}
+	for (int i = 0; i < pool->workers; i++) {
+		workers[i].pool = pool;
+		workers[i].id = i;
+#ifdef _WIN32
+		workers[i].thread = CreateThread(
+			NULL, 0, run_worker, &workers[i], 0, NULL);
+		if (!workers[i].thread) break;
+#else
+		if (pthread_create(
+			&workers[i].thread, NULL, run_worker, &workers[i])) break;
+#endif
+		started++;
+	}
+	// threads that failed to start leave their files to be stolen
+	for (int i = 0; i < started; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(workers[i].thread, INFINITE);
+		CloseHandle(workers[i].thread);
+#else
+		pthread_join(workers[i].thread, NULL);
+#endif
+	}
+	for (int i = 0; i < pool->workers; i++) mutex_destroy(&pool->deques[i].lock);
+	free(pool->deques);
+	free(workers);
+	return started > 0;
+}
+
+int batch(const char *path, const struct Template *template,
+	const struct Backend *b, char optimize, const struct Rules *rules)
+{
+	struct Pool pool = {0};
+	int result = NO_ERROR;
+	int failed = 0;
+	pool.template = template;
+	pool.backend = b;
+	pool.optimize = optimize;
+	pool.rules = rules;
+	if (!listdir(&pool, path) && !listfile(&pool, path)) {
+		fprintf(stderr, "Error! Can't read the directory or list '%s'.\n", path);
+		result = OPEN_SOURCE;
+	} else if (pool.count == 0) {
+		fprintf(stderr, "No %s files found in '%s'.\n", SOURCE_EXTENSION, path);
+		result = OPEN_SOURCE;
+	} else {
+		pool.workers = cores() < pool.count ? cores() : pool.count;
+		if (!run_pool(&pool)) {
+			fprintf(stderr, "Error! Can't start the assembly threads.\n");
+			result = MEMORY_ALLOCATION_ERROR;
+		}
+	}
+	// summary in file order, regardless of the order of completion
+	for (int i = 0; result == NO_ERROR && i < pool.count; i++) {
+		struct BatchFile *file = &pool.files[i];
+		if (file->code == NO_ERROR) {
+			fprintf(stderr, "OK     %s => %s\n", file->source, file->output);
+		} else {
+			fprintf(stderr, "ERROR  %s", file->source);
+			fputs(file->message ? file->message : "\n", stderr);
+			failed++;
+		}
+	}
+	if (result == NO_ERROR) {
+		fprintf(stderr, "\n%d files: %d assembled, %d with errors.\n",
+			pool.count, pool.count - failed, failed);
+	}
+	for (int i = 0; i < pool.count; i++) {
+		// the first failed file in order determines the exit code
+		if (result == NO_ERROR) result = pool.files[i].code;
+		free(pool.files[i].source);
+		free(pool.files[i].output);
+		free(pool.files[i].message);
+	}
+	free(pool.files);
+	return result;
+}
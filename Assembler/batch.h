@@ -0,0 +1,21 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Batch assembly headers
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "backends.h"
+
+/* Assembles every .e80asm file of the directory 'path', or every file listed
+one per line in the text file 'path', on all processor cores. Each output is
+written next to its source in the format of backend b, with the extension
+replaced by the backend's one, and optimized if 'optimize' is set (see
+optimize()), with the superoptimizer rules if they're not NULL. The compiled
+template and the rules are shared read-only by all workers. A summary with
+the diagnostics of each file is printed to stderr in file order. Returns
+NO_ERROR if all files were assembled, or the error code of the first failed
+file otherwise. */
+int batch(const char *path, const struct Template *template,
+	const struct Backend *b, char optimize, const struct Rules *rules);
+
+#endif
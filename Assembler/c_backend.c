@@ -0,0 +1,643 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// C backend; translates the RAM image to a C program that executes its
+// basic blocks natively, and anything else through an embedded interpreter
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_backend.h"
+#include "backends.h"
+#include "data_structures.h"
+#include "isa.h"
+
+/* The parts of the runtime of the translated program, which are laid out
+around its tables and its run() function. The interpreter mirrors step()
+and alu() of simulator.c, and main() prints what e80asm --run and --sweep
+print. */
+static const char *const c_prologue[] = {
+	"#include <stdio.h>",
+	"#include <stdlib.h>",
+	"#include <string.h>",
+	"#include <ctype.h>",
+	"",
+	"#define HALT 0x01",
+	"#define DIP_ADDRESS 0xFF",
+	"#define DEFAULT_CYCLES 10000000UL",
+	"",
+	"/* State of the E80 computer, as in Computer.vhd. */",
+	"struct E80 {",
+	"\tunsigned char ram[256];",
+	"\tunsigned char r[8]; /* R0-R5, flags (R6), stack pointer (R7) */",
+	"\tunsigned char pc;",
+	"\tunsigned char dip;",
+	"\tunsigned char dirty; /* the program wrote over its compiled code */",
+	"\tunsigned long cycles;",
+	"};",
+	"",
+	"/* The flags of ALU.vhd after the result s of a full-flags (ADD, SUB, CMP"
+		",",
+	"LSHIFT, RSHIFT) or a ZS-flags operation. */",
+	"#define FULL(c, s, v) (r[6] = (unsigned char)((c) << 7 | ((s) == 0) << 6 "
+		"\\",
+	"\t| ((s) & 0x80) >> 2 | (v) << 4 | (r[6] & 0x0F)))",
+	"#define ZS(s) (r[6] = (unsigned char)((r[6] & 0x9F) | ((s) == 0) << 6 \\",
+	"\t| ((s) & 0x80) >> 2))",
+	"#define READ(x) ((x) == DIP_ADDRESS ? m->dip : m->ram[x])",
+	"",
+	"/* Leaves the compiled code once it writes over itself, or halts, with th"
+		"e",
+	"cycles of the rest of its block taken back. */",
+	"#define WRITTEN(x, next, rest) if (compiled[x] && m->ram[x] != image[x]) "
+		"{ \\",
+	"\tm->dirty = 1; pc = next; cycles -= rest; goto slow; }",
+	"#define HALTED(next, rest) if (r[6] & HALT) { \\",
+	"\tpc = next; cycles -= rest; goto done; }",
+	NULL
+};
+
+static const char *const c_interpreter[] = {
+	"/* Arithmetic Logic Unit, as in ALU.vhd. */",
+	"static void alu(int op, int a, int b, int flags_in, int *out, int *flags_"
+		"out)",
+	"{",
+	"\t// ALUop decoder",
+	"\tint isADD    = op == 0x2;",
+	"\tint isSUB    = (op & 0x7) == 0x3; // includes CMP",
+	"\tint isAND    = (op & 0x7) == 0x4; // includes BIT",
+	"\tint isOR     = op == 0x5;",
+	"\tint isXOR    = op == 0x6;",
+	"\tint isROR    = op == 0x7;",
+	"\tint isLSHIFT = op == 0xA;",
+	"\tint isCMP    = op == 0xB;",
+	"\tint isBIT    = op == 0xC;",
+	"\tint isRSHIFT = op == 0xD;",
+	"\tint isDCR    = op == 0xE; // PUSH, CALL",
+	"\tint isINR    = op == 0xF; // POP, RETURN",
+	"\tint FullFlags = isADD || isSUB || isRSHIFT || isLSHIFT;",
+	"\tint DiscardFlags = isINR || isDCR;",
+	"\tint DiscardResult = isCMP || isBIT;",
+	"\t// ripple-carry adder / subtractor (FA8.vhd)",
+	"\tif (isDCR || isINR) b = 1;",
+	"\tint sub = isSUB || isDCR;",
+	"\tint x = sub ? b ^ 0xFF : b;",
+	"\tint sum = a + x + sub;",
+	"\tint sum_c = (sum >> 8) & 1;",
+	"\tint c7 = (((a & 0x7F) + (x & 0x7F) + sub) >> 7) & 1; // carry into bit "
+		"7",
+	"\tint sum_v = sum_c ^ c7;",
+	"\tsum &= 0xFF;",
+	"\t// barrel shifter, rotating by the 3 LSBs of B",
+	"\tint n = b & 7;",
+	"\tint rotated = ((a >> n) | (a << (8 - n))) & 0xFF;",
+	"\tint result =",
+	"\t\tisROR    ? rotated :",
+	"\t\tisAND    ? a & b :",
+	"\t\tisOR     ? a | b :",
+	"\t\tisXOR    ? a ^ b :",
+	"\t\tisRSHIFT ? a >> 1 :",
+	"\t\tisLSHIFT ? (a << 1) & 0xFF :",
+	"\t\tsum;",
+	"\tint C = isRSHIFT ? a & 1 : isLSHIFT ? a >> 7 : sum_c;",
+	"\tint Z = result == 0;",
+	"\tint S = result >> 7;",
+	"\tint V = isRSHIFT || isLSHIFT ? (a >> 7) ^ S : sum_v;",
+	"\tif (DiscardFlags) {",
+	"\t\t*flags_out = flags_in;",
+	"\t} else if (FullFlags) {",
+	"\t\t*flags_out = C << 7 | Z << 6 | S << 5 | V << 4 | (flags_in & 0x0F);",
+	"\t} else {",
+	"\t\t*flags_out = (flags_in & 0x9F) | Z << 6 | S << 5;",
+	"\t}",
+	"\t*out = DiscardResult ? a : result;",
+	"}",
+	"",
+	"/* Executes a single clock cycle, as the CPU.vhd hardware does. */",
+	"static void step(struct E80 *c)",
+	"{",
+	"\tint Instr1 = c->ram[c->pc];",
+	"\tint Instr2 = c->ram[(c->pc + 1) & 0xFF];",
+	"\tint op2isReg = (Instr1 >> 3) & 1;",
+	"\tint Instr1Reg = Instr1 & 7;",
+	"\tint Instr2Reg1 = (Instr2 >> 4) & 7;",
+	"\tint Instr2Reg2 = Instr2 & 7;",
+	"\t// instruction decoder",
+	"\tint isHLT    = Instr1 == 0x00;",
+	"\tint isNOP    = Instr1 == 0x01;",
+	"\tint isJMP    = Instr1 == 0x02;",
+	"\tint isJC     = Instr1 == 0x04;",
+	"\tint isJNC    = Instr1 == 0x05;",
+	"\tint isJZ     = Instr1 == 0x06;",
+	"\tint isJNZ    = Instr1 == 0x07;",
+	"\tint isJS     = Instr1 == 0x08;",
+	"\tint isJNS    = Instr1 == 0x09;",
+	"\tint isJV     = Instr1 == 0x0A;",
+	"\tint isJNV    = Instr1 == 0x0B;",
+	"\tint isCALL   = Instr1 == 0xE8;",
+	"\tint isRETURN = Instr1 == 0xF8;",
+	"\tint isSTORE  = (Instr1 & 0xF0) == 0x80;",
+	"\tint isLOAD   = (Instr1 & 0xF0) == 0x90;",
+	"\tint isMOV    = (Instr1 & 0xF0) == 0x10;",
+	"\tint isSHIFT  = (Instr1 & 0xF8) == 0xA0 || (Instr1 & 0xF8) == 0xD0;",
+	"\tint isPUSH   = (Instr1 & 0xF8) == 0xE0;",
+	"\tint isPOP    = (Instr1 & 0xF8) == 0xF0;",
+	"\tint noALU    = (Instr1 & 0x60) == 0x00; // bypass ALU and flags",
+	"\tint isStack  = isPUSH || isCALL || isPOP || isRETURN;",
+	"\t// registers",
+	"\tint Flags = c->r[6];",
+	"\tint A_reg = isStack ? 7 : op2isReg ? Instr2Reg1 : Instr1Reg;",
+	"\tint B_reg = isPUSH ? Instr1Reg : Instr2Reg2;",
+	"\tint W_reg = isPOP ? Instr1Reg : 6;",
+	"\tint A_val = c->r[A_reg];",
+	"\tint B_val = c->r[B_reg];",
+	"\tint op2 = op2isReg ? B_val : Instr2;",
+	"\tint ALUout, FlagsOut;",
+	"\talu(Instr1 >> 4, A_val, op2, Flags, &ALUout, &FlagsOut);",
+	"\t// memory access, with the DIP input mapped at 0xFF",
+	"\tint MemAddr =",
+	"\t\tisPOP || isRETURN ? A_val :",
+	"\t\tisPUSH || isCALL  ? ALUout :",
+	"\t\top2;",
+	"\tint Data = MemAddr == DIP_ADDRESS ? c->dip : c->ram[MemAddr];",
+	"\t// program flow control",
+	"\tint Size = isHLT || isNOP || isRETURN || isSHIFT || isPUSH || isPOP ? 1"
+		" : 2;",
+	"\tint Adjacent = (c->pc + Size) & 0xFF;",
+	"\tint Jumping =",
+	"\t\tisJMP || isCALL || isRETURN ||",
+	"\t\t(isJC && (Flags & 0x80)) || (isJNC && !(Flags & 0x80)) ||",
+	"\t\t(isJZ && (Flags & 0x40)) || (isJNZ && !(Flags & 0x40)) ||",
+	"\t\t(isJS && (Flags & 0x20)) || (isJNS && !(Flags & 0x20)) ||",
+	"\t\t(isJV && (Flags & 0x10)) || (isJNV && !(Flags & 0x10));",
+	"\tint A_next =",
+	"\t\tisLOAD ? Data :",
+	"\t\tisMOV  ? op2 :",
+	"\t\tnoALU  ? A_val :",
+	"\t\tALUout;",
+	"\tint W_next =",
+	"\t\tisPOP ? Data :",
+	"\t\tisHLT ? Flags | HALT :",
+	"\t\tnoALU ? Flags :",
+	"\t\tFlagsOut;",
+	"\tint PCnext =",
+	"\t\tisHLT || (Flags & HALT) ? c->pc :",
+	"\t\t!Jumping ? Adjacent :",
+	"\t\tisRETURN ? Data :",
+	"\t\tInstr2;",
+	"\t// rising clock edge; A_next has priority over W_next when A_reg = W_re"
+		"g",
+	"\tif (isSTORE || isPUSH || isCALL) {",
+	"\t\tc->ram[MemAddr] = (unsigned char)(",
+	"\t\t\tisPUSH ? B_val :",
+	"\t\t\tisCALL ? Adjacent :",
+	"\t\t\tA_val);",
+	"\t\tif (compiled[MemAddr] && c->ram[MemAddr] != image[MemAddr]) {",
+	"\t\t\tc->dirty = 1;",
+	"\t\t}",
+	"\t}",
+	"\tif (W_reg != A_reg) c->r[W_reg] = (unsigned char) W_next;",
+	"\tc->r[A_reg] = (unsigned char) A_next;",
+	"\tc->pc = (unsigned char) PCnext;",
+	"\tc->cycles++;",
+	"}",
+	"",
+	"#ifdef E80_VERIFY",
+	"/* Steps the interpreter in 'shadow' up to the cycles of the compiled cod"
+		"e,",
+	"and exits if their states differ. */",
+	"static void verify(struct E80 *shadow, const struct E80 *m,",
+	"\tconst unsigned char *r, unsigned pc, unsigned long cycles)",
+	"{",
+	"\twhile (shadow->cycles < cycles && !(shadow->r[6] & HALT)) step(shadow);",
+	"\tif (shadow->cycles != cycles || shadow->pc != pc",
+	"\t\t|| memcmp(shadow->r, r, 8) || memcmp(shadow->ram, m->ram, 256)) {",
+	"\t\tfprintf(stderr, \"E80_VERIFY: the compiled code differs from the \"",
+	"\t\t\t\"interpreter at PC %u after %lu cycles.\\n\", pc, cycles);",
+	"\t\texit(3);",
+	"\t}",
+	"}",
+	"#define VERIFY(at) verify(&shadow, m, r, at, cycles)",
+	"#else",
+	"#define VERIFY(at)",
+	"#endif",
+	NULL
+};
+
+static const char *const c_main[] = {
+	"",
+	"/* Resets the computer and loads the RAM image. */",
+	"static void reset(struct E80 *m, int dip)",
+	"{",
+	"\tmemset(m, 0, sizeof(*m));",
+	"\tmemcpy(m->ram, image, sizeof(image));",
+	"\tm->r[7] = 0xFF;",
+	"\tm->dip = (unsigned char)dip;",
+	"}",
+	"",
+	"/* Prints a register or RAM word row, in binary, hex and decimal. */",
+	"static void row(const char *name, int word)",
+	"{",
+	"\tchar bits[9];",
+	"\tint i;",
+	"\tfor (i = 0; i < 8; i++) bits[i] = (char)('0' + (word >> (7 - i) & 1));",
+	"\tbits[8] = '\\0';",
+	"\tprintf(\"%-8s%s  %02X  %3d\", name, bits, word, word);",
+	"}",
+	"",
+	"/* Prints the final state as e80asm --run does. */",
+	"static void dump(const struct E80 *m)",
+	"{",
+	"\tchar name[16];",
+	"\tint i, i1 = m->ram[m->pc], i2 = m->ram[(m->pc + 1) & 0xFF];",
+	"\tif (m->r[6] & HALT) printf(\"Halted after %lu cycles.\\n\", m->cycles);",
+	"\telse printf(\"Stopped after %lu cycles without halting.\\n\", m->cycles"
+		");",
+	"\trow(\"PC\", m->pc);",
+	"\tprintf(\"  \");",
+	"\tif (i1 >= 0x10 && i1 < 0xE0 && (i1 & 0x08)) {",
+	"\t\tprintf(mnemonic[i1], (i2 >> 4) & 7, i2 & 7);",
+	"\t} else printf(mnemonic[i1], i2);",
+	"\tprintf(\"\\n\");",
+	"\tfor (i = 0; i < 6; i++) {",
+	"\t\tsprintf(name, \"R%d\", i);",
+	"\t\trow(name, m->r[i]);",
+	"\t\tprintf(\"\\n\");",
+	"\t}",
+	"\trow(\"FLAGS\", m->r[6]);",
+	"\tprintf(\"  CZSV---H\\n\");",
+	"\trow(\"SP\", m->r[7]);",
+	"\tprintf(\"\\nMONITOR block at %d:\\n\", MONITOR);",
+	"\tfor (i = 0; i < 8; i++) {",
+	"\t\tint addr = (MONITOR + i) & 0xFF, word = m->ram[addr];",
+	"\t\tsprintf(name, \"%d\", addr);",
+	"\t\trow(name, word);",
+	"\t\tprintf(isprint(word) ? \"  '%c'\\n\" : \"\\n\", word);",
+	"\t}",
+	"}",
+	"",
+	"/* Prints the final state for each of the 256 DIP inputs, as e80asm --swe"
+		"ep",
+	"does. */",
+	"static int sweep(unsigned long limit)",
+	"{",
+	"\tstruct E80 *m = malloc(256 * sizeof(*m));",
+	"\tint dip, i, halted = 0;",
+	"\tif (!m) return 1;",
+	"\tfor (dip = 0; dip < 256; dip++) {",
+	"\t\treset(&m[dip], dip);",
+	"\t\trun(&m[dip], limit);",
+	"\t\thalted += m[dip].r[6] & HALT;",
+	"\t}",
+	"\tprintf(\"Swept 256 DIP inputs: %d halted, %d stopped without halting.\\"
+		"n\\n\"",
+	"\t\t\"DIP          CYCLES  PC  R0 R1 R2 R3 R4 R5  FLAGS     SP  \"",
+	"\t\t\"MONITOR block at %d\\n\", halted, 256 - halted, MONITOR);",
+	"\tfor (dip = 0; dip < 256; dip++) {",
+	"\t\tconst struct E80 *c = &m[dip];",
+	"\t\tfor (i = 7; i >= 0; i--) putchar('0' + (dip >> i & 1));",
+	"\t\tprintf(\"  %10lu  %02X  %02X %02X %02X %02X %02X %02X  \", c->cycles,",
+	"\t\t\tc->pc, c->r[0], c->r[1], c->r[2], c->r[3], c->r[4], c->r[5]);",
+	"\t\tfor (i = 7; i >= 0; i--) putchar('0' + (c->r[6] >> i & 1));",
+	"\t\tprintf(\"  %02X \", c->r[7]);",
+	"\t\tfor (i = 0; i < 8; i++) printf(\" %02X\", c->ram[(MONITOR + i) & 0xFF"
+		"]);",
+	"\t\tprintf(\"  \");",
+	"\t\tfor (i = 0; i < 8; i++) {",
+	"\t\t\tint word = c->ram[(MONITOR + i) & 0xFF];",
+	"\t\t\tputchar(isprint(word) ? word : '.');",
+	"\t\t}",
+	"\t\tprintf(\"\\n\");",
+	"\t}",
+	"\tfree(m);",
+	"\treturn 0;",
+	"}",
+	"",
+	"int main(int argc, char *argv[])",
+	"{",
+	"\tstruct E80 m;",
+	"\tunsigned long limit = DEFAULT_CYCLES;",
+	"\tint i, dip = SIMDIP, all = 0;",
+	"\tfor (i = 1; i < argc; i++) {",
+	"\t\tif (!strcmp(argv[i], \"--dip\") && i + 1 < argc) {",
+	"\t\t\tdip = (int)strtoul(argv[++i], NULL, 0) & 0xFF;",
+	"\t\t} else if (!strcmp(argv[i], \"--cycles\") && i + 1 < argc) {",
+	"\t\t\tlimit = strtoul(argv[++i], NULL, 10);",
+	"\t\t} else if (!strcmp(argv[i], \"--sweep\")) {",
+	"\t\t\tall = 1;",
+	"\t\t} else {",
+	"\t\t\tfprintf(stderr, \"%s [--dip n] [--cycles limit] [--sweep]\\n\",",
+	"\t\t\t\targv[0]);",
+	"\t\t\treturn 1;",
+	"\t\t}",
+	"\t}",
+	"\tif (all) return sweep(limit);",
+	"\treset(&m, dip);",
+	"\trun(&m, limit);",
+	"\tdump(&m);",
+	"\treturn 0;",
+	"}",
+	NULL
+};
+
+/* What the translation of a RAM image compiles. */
+struct Translation {
+	const struct OutputHeader *Out;
+	unsigned char size[256]; // words of the compiled instruction, or 0
+	unsigned char leader[256]; // the instruction starts a basic block
+	unsigned char compiled[256]; // the word is read by compiled code
+};
+
+/* Returns the words of an instruction, as step() counts them. */
+int c_size(int instr1)
+{
+	return instr1 == 0x00 || instr1 == 0x01 || instr1 == 0xF8
+		|| (instr1 & 0xF8) == 0xA0 || (instr1 & 0xF8) == 0xD0
+		|| (instr1 & 0xF8) == 0xE0 || (instr1 & 0xF8) == 0xF0 ? 1 : 2;
+}
+
+/* Returns whether an instruction ends a basic block: HLT, JMP, Jcc, CALL
+and RETURN. */
+int c_ends_block(int instr1)
+{
+	return instr1 == 0x00 || instr1 == 0x02 || (instr1 >= 0x04
+		&& instr1 <= 0x0B) || instr1 == 0xE8 || instr1 == 0xF8;
+}
+
+/* Finds the instructions of the RAM image and the leaders of their basic
+blocks: the start, the targets of jumps and calls, the addresses after the
+instructions that end a block, and the instructions that nothing falls
+through to. */
+void c_blocks(struct Translation *x)
+{
+	unsigned char falls[256] = {0};
+	const struct OutputHeader *Out = x->Out;
+	for (int a = 0; a < RAM_SIZE; a++) {
+		int size = c_size(Out->mem[a]);
+		if (Out->word[a].type != INSTRUCTION_WORD || !decode(Out->mem[a])
+			|| a + size > RAM_SIZE) continue;
+		x->size[a] = (unsigned char)size;
+		memset(x->compiled + a, 1, size);
+	}
+	for (int a = 0; a < RAM_SIZE; a++) {
+		int i1 = Out->mem[a];
+		if (!x->size[a]) continue;
+		if (!c_ends_block(i1)) {
+			falls[a + x->size[a]] = 1;
+		} else if (i1 != 0x00 && i1 != 0xF8) {
+			x->leader[Out->mem[a + 1]] = 1;
+			if (i1 != 0x02) x->leader[a + 2] = 1;
+		}
+	}
+	for (int a = 0; a < 256; a++) {
+		x->leader[a] = x->size[a] && (!a || x->leader[a] || !falls[a]);
+	}
+}
+
+/* Appends the jump to address n to t, through the dispatch switch if n
+doesn't start a compiled block. */
+int c_goto(const struct Translation *x, int n, struct Text *t)
+{
+	if (x->leader[n]) return append(t, "goto L%d;\n", n);
+	return append(t, "{ pc = %d; goto dispatch; }\n", n);
+}
+
+/* Appends the C statements of the instruction at address a to t, with
+'rest' instructions of its block after it, which are taken back from the
+cycles if it writes over compiled code or halts. */
+int c_instruction(const struct Translation *x, int a, int rest, struct Text *t)
+{
+	const uint8_t *mem = x->Out->mem;
+	int i1 = mem[a], i2 = mem[a + 1], op = i1 >> 4, next = a + x->size[a];
+	int reg = i1 & 7; // Instr1Reg, the register of one-word instructions
+	int A = i1 & 0x08 ? (i2 >> 4) & 7 : reg; // A_reg of the others
+	char op2[8], disassembly[16];
+	int written = -1; // register written by the instruction, or -1
+	sprintf(op2, i1 & 0x08 ? "r[%d]" : "%d", i1 & 0x08 ? i2 & 7 : i2);
+	disassemble(disassembly, i1, i2);
+	if (!append(t, "\t/* %d: %s */\n\t", a, disassembly)) return 0;
+	if (i1 == 0x00) {
+		return append(t, "r[6] |= HALT;\n\tpc = %d;\n\tgoto done;\n", a);
+	} else if (i1 == 0x01) {
+		return append(t, "/* NOP */\n");
+	} else if (i1 == 0x02) {
+		return c_goto(x, i2, t);
+	} else if (i1 <= 0x0B) {
+		// the flag of Instr1[2:1] (C, Z, S, V), set or, for odd ones, clear
+		if (!append(t, "if (%s(r[6] & 0x%02X)) ", i1 & 1 ? "!" : "",
+			0x80 >> ((i1 - 4) >> 1)) || !c_goto(x, i2, t)) return 0;
+	} else if (i1 == 0xE8) {
+		if (!append(t, "a = (r[7] - 1) & 0xFF;\n\tm->ram[a] = %d;\n\t"
+			"r[7] = a;\n\tWRITTEN(a, %d, %d);\n\t", next & 0xFF, i2, rest)) {
+			return 0;
+		}
+		return c_goto(x, i2, t);
+	} else if (i1 == 0xF8) {
+		return append(t, "a = r[7];\n\tpc = READ(a);\n\tr[7] = (a + 1) & 0xFF;"
+			"\n\tgoto dispatch;\n");
+	} else if ((i1 & 0xF8) == 0xE0) {
+		return append(t, "a = (r[7] - 1) & 0xFF;\n\tm->ram[a] = r[%d];\n\t"
+			"r[7] = a;\n\tWRITTEN(a, %d, %d);\n", reg, next, rest);
+	} else if ((i1 & 0xF8) == 0xF0) {
+		// A_next, the incremented SP, has priority over the popped word
+		if (!append(t, "a = r[7];\n\t")) return 0;
+		if (reg != 7 && !append(t, "r[%d] = READ(a);\n\t", reg)) return 0;
+		if (!append(t, "r[7] = (a + 1) & 0xFF;\n")) return 0;
+		written = reg;
+	} else if (op == 0x1) {
+		if (!append(t, "r[%d] = %s;\n", A, op2)) return 0;
+		written = A;
+	} else if (op == 0x8) {
+		if (i1 & 0x08 || x->compiled[i2]) {
+			return append(t, "a = %s;\n\tm->ram[a] = r[%d];\n\t"
+				"WRITTEN(a, %d, %d);\n", op2, A, next, rest);
+		}
+		return append(t, "m->ram[%d] = r[%d];\n", i2, A);
+	} else if (op == 0x9) {
+		int ok = i1 & 0x08 ? append(t, "a = %s;\n\tr[%d] = READ(a);\n", op2, A)
+			: i2 == 0xFF ? append(t, "r[%d] = m->dip;\n", A)
+			: append(t, "r[%d] = m->ram[%d];\n", A, i2);
+		if (!ok) return 0;
+		written = A;
+	} else if (op == 0xA || op == 0xD) {
+		if (!append(t, op == 0xA ? "a = r[%d];\n\ts = (a << 1) & 0xFF;\n\t"
+			"FULL(a >> 7, s, (a ^ s) >> 7);\n\tr[%d] = s;\n"
+			: "a = r[%d];\n\ts = a >> 1;\n\tFULL(a & 1, s, a >> 7);\n\t"
+			"r[%d] = s;\n", reg, reg)) return 0;
+		written = reg;
+	} else if ((op == 0xB || op == 0xC) && A == 6) {
+		// the flags are written back with the discarded result
+		return append(t, "/* no change */\n");
+	} else if (op == 0x2 || op == 0x3 || op == 0xB) {
+		if (!append(t, "a = r[%d];\n\tb = %s%s;\n\ts = a + b%s;\n\t"
+			"FULL(s >> 8, s & 0xFF, ((a ^ s) & (b ^ s) & 0x80) >> 7);\n",
+			A, op2, op == 0x2 ? "" : " ^ 0xFF", op == 0x2 ? "" : " + 1")) {
+			return 0;
+		}
+		if (op != 0xB && !append(t, "\tr[%d] = s & 0xFF;\n", A)) return 0;
+		written = op == 0xB ? -1 : A;
+	} else if (op == 0x7) {
+		int ok = !(i1 & 0x08)
+			? append(t, "a = r[%d];\n\ts = (a >> %d | a << %d) & 0xFF;\n",
+				A, i2 & 7, 8 - (i2 & 7))
+			: append(t, "a = r[%d];\n\tb = %s & 7;\n\t"
+				"s = (a >> b | a << (8 - b)) & 0xFF;\n", A, op2);
+		if (!ok || !append(t, "\tZS(s);\n\tr[%d] = s;\n", A)) return 0;
+		written = A;
+	} else {
+		const char *logic = op == 0x5 ? "|" : op == 0x6 ? "^" : "&";
+		if (!append(t, "s = r[%d] %s %s;\n\tZS(s);\n", A, logic, op2)) {
+			return 0;
+		}
+		if (op != 0xC && !append(t, "\tr[%d] = s;\n", A)) return 0;
+		written = op == 0xC ? -1 : A;
+	}
+	// a write to the flags register may set the Halt flag
+	if (written == 6) return append(t, "\tHALTED(%d, %d);\n", next, rest);
+	return 1;
+}
+
+/* Appends the basic blocks of the RAM image to t, in address order. Each
+one checks the cycle limit and counts its cycles once, and goes on to the
+block after it, or to the dispatch switch. */
+int c_body(const struct Translation *x, struct Text *t)
+{
+	const uint8_t *mem = x->Out->mem;
+	for (int a = 0; a < RAM_SIZE; a++) {
+		if (!x->leader[a]) continue;
+		int n = 1, end = a;
+		while (!c_ends_block(mem[end]) && x->size[end + x->size[end]]
+			&& !x->leader[end + x->size[end]]) {
+			end += x->size[end];
+			n++;
+		}
+		if (!append(t, "L%d:\n\tVERIFY(%d);\n\tif (limit - cycles < %d) "
+			"{ pc = %d; goto slow; }\n\tcycles += %d;\n", a, a, n, a, n)) {
+			return 0;
+		}
+		for (int at = a, rest = n - 1; rest >= 0; at += x->size[at], rest--) {
+			if (!c_instruction(x, at, rest, t)) return 0;
+		}
+		int next = end + x->size[end];
+		int i1 = mem[end];
+		if (i1 == 0x00 || i1 == 0x02 || i1 == 0xE8 || i1 == 0xF8) continue;
+		// falls through to the next block, unless it's elsewhere
+		int following = end + 1;
+		while (following < RAM_SIZE && !x->leader[following]) following++;
+		if (following != next) {
+			if (!append(t, "\t") || !c_goto(x, next & 0xFF, t)) return 0;
+		}
+	}
+	return 1;
+}
+
+/* Appends the disassembly format of an Instr1 to t as a string literal:
+the registers of Instr2 are its printf() arguments for type 4 instructions,
+and Instr2 is for the others. */
+int c_mnemonic(int instr1, struct Text *t)
+{
+	const struct Keyword *k = decode(instr1);
+	if (!k) return append(t, "\"?\"");
+	switch (k->format) {
+	case TYPE1:
+		return append(t, "\"%s\"", k->name);
+	case TYPE2:
+		return append(t, "\"%s R%d\"", k->name, instr1 & 7);
+	case TYPE3:
+		return append(t, "\"%s %%d\"", k->name);
+	default:
+		if (instr1 & 0x08) {
+			return append(t, k->bracketed ? "\"%s R%%d, [R%%d]\""
+				: "\"%s R%%d, R%%d\"", k->name);
+		}
+		return append(t, k->bracketed ? "\"%s R%d, [%%d]\"" : "\"%s R%d, %%d\"",
+			k->name, instr1 & 7);
+	}
+}
+
+/* Appends the lines of a part of the runtime to t. */
+int c_lines(const char *const *lines, struct Text *t)
+{
+	for (; *lines; lines++) {
+		if (!append(t, "%s\n", *lines)) return 0;
+	}
+	return 1;
+}
+
+/* Appends the directives, the RAM image, the words that compiled code
+reads and the disassembly formats of the translated program to t. */
+int c_tables(const struct Translation *x, struct Text *t)
+{
+	const struct OutputHeader *Out = x->Out;
+	if (!append(t, "\n#define SIMDIP %d\n#define MONITOR %d\n\n"
+		"/* The RAM image, and the words that the compiled code reads. */\n"
+		"static const unsigned char image[256] = {", Out->simdip,
+		Out->monitor & 0xFF)) return 0;
+	for (int a = 0; a < 256; a++) {
+		if (!append(t, "%s0x%02X,", a % 16 ? " " : "\n\t",
+			a < RAM_SIZE ? Out->mem[a] : 0)) return 0;
+	}
+	if (!append(t, "\n};\nstatic const unsigned char compiled[256] = {")) {
+		return 0;
+	}
+	for (int a = 0; a < 256; a++) {
+		const char *separator = a % 16 ? " " : "\n\t";
+		if (!append(t, "%s%d,", separator, x->compiled[a])) return 0;
+	}
+	if (!append(t, "\n};\n\n/* The disassembly of each Instr1. */\n"
+		"static const char *const mnemonic[256] = {")) return 0;
+	for (int i1 = 0; i1 < 256; i1++) {
+		if (!append(t, i1 % 4 ? " " : "\n\t") || !c_mnemonic(i1, t)
+			|| !append(t, ",")) return 0;
+	}
+	return append(t, "\n};\n\n");
+}
+
+/* Appends run(), which holds the compiled blocks, to t. */
+int c_run(const struct Translation *x, struct Text *t)
+{
+	struct Text body = {0};
+	int ok = c_body(x, &body) && append(t, "\n/* Executes the program until "
+		"it halts, or until 'limit' cycles have been\nexecuted. Its basic "
+		"blocks run as compiled code, and anything else through\nstep(), "
+		"which takes over for good once the program writes over its "
+		"compiled\ncode. */\nstatic void run(struct E80 *m, unsigned long "
+		"limit)\n{\n\tunsigned char r[8];\n\tunsigned pc = m->pc");
+	// the temporaries that the compiled code uses
+	for (const char *s = "abs"; ok && *s; s++) {
+		char assignment[] = {'\t', *s, ' ', '=', '\0'};
+		if (body.s && strstr(body.s, assignment)) ok = append(t, ", %c", *s);
+	}
+	ok = ok && append(t, ";\n\tunsigned long cycles = m->cycles;\n"
+		"#ifdef E80_VERIFY\n\tstruct E80 shadow = *m;\n#endif\n"
+		"\tmemcpy(r, m->r, 8);\ndispatch:\n\tVERIFY(pc);\n"
+		"\tif ((r[6] & HALT) || cycles >= limit) goto done;\n"
+		"\tswitch (pc) {\n");
+	for (int a = 0; ok && a < 256; a++) {
+		if (x->leader[a]) ok = append(t, "\tcase %d: goto L%d;\n", a, a);
+	}
+	ok = ok && append(t, "\tdefault: goto slow;\n\t}\n")
+		&& (!body.s || append(t, "%s", body.s))
+		&& append(t, "slow:\n\tm->pc = (unsigned char)pc;\n"
+		"\tmemcpy(m->r, r, 8);\n\tm->cycles = cycles;\n"
+		"\twhile (!(m->r[6] & HALT) && m->cycles < limit) {\n"
+		"\t\tstep(m);\n\t\tif (!m->dirty) break;\n\t}\n"
+		"\tpc = m->pc;\n\tmemcpy(r, m->r, 8);\n\tcycles = m->cycles;\n"
+		"\tgoto dispatch;\ndone:\n\tVERIFY(pc);\n"
+		"\tm->pc = (unsigned char)pc;\n\tmemcpy(m->r, r, 8);\n"
+		"\tm->cycles = cycles;\n}\n");
+	free(body.s);
+	return ok;
+}
+
+int render_c(const struct Assembler *as, struct Text *t)
+{
+	struct Translation x = {&as->Out, {0}, {0}, {0}};
+	c_blocks(&x);
+	return append(t, "// %s\n// Translated from the RAM image of an E80 "
+		"program by e80asm --emit-c.\n// Build with a C99 compiler, as in: "
+		"cc -O2 -o program program.c\n// Add -DE80_VERIFY to check the "
+		"compiled code against the interpreter\n// at every block.\n\n",
+		title(as))
+		&& c_lines(c_prologue, t) && c_tables(&x, t)
+		&& c_lines(c_interpreter, t) && c_run(&x, t) && c_lines(c_main, t);
+}
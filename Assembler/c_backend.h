@@ -0,0 +1,19 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// C backend headers
+
+#ifndef C_BACKEND_H
+#define C_BACKEND_H
+
+#include "data_structures.h"
+
+/* Appends a C99 program that executes the RAM image of an assembly to t.
+Each basic block of its instructions is translated to straight-line C with
+the flags of ALU.vhd, and jumps and calls become gotos, with a switch on
+the PC for returns and other jumps to computed addresses. Anything else is
+executed by an interpreter embedded in the program, which also takes over
+once the program writes over its compiled code. The program takes --dip,
+--cycles and --sweep, and prints what e80asm --run or --sweep prints.
+Returns 0 if memory can't be allocated. */
+int render_c(const struct Assembler *as, struct Text *t);
+
+#endif
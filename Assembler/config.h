@@ -1,15 +1,22 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-#define MAX_LINE_LENGTH 150
-#define MAX_LABELS 200
+#define MAX_COMMENT_LENGTH 32 // disassembly comment of a RAM word
+#define MAX_ERRORS 20 // errors reported before an assembly stops
+#ifndef STATS
+#define STATS 1 // compiles in the --stats instrumentation; 0 compiles it out
+#endif
 #define RAM_SIZE 254
 #define MIN_SPEED 0
 #define MAX_SPEED 6
 #define DEFAULT_SPEED 2
 #define DEFAULT_MONITOR 0
-#define DEFAULT_SIMDIP "00000000"
+#define DEFAULT_SIMDIP 0
 #define TEMPLATE "Template.vhd"
+#define SOURCE_EXTENSION ".e80asm"
+#define OUTPUT_EXTENSION ".vhd"
+#define OBJECT_EXTENSION ".e80o" // relocatable object (-c)
+#define DEFAULT_CYCLES 10000000 // simulation limit
 #define DEFAULT_TITLE "Generated by the E80 assembler"
 
 #endif
@@ -0,0 +1,180 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Synthetic program generator for benchmarks; not part of E80ASM itself.
+// Each program uses all 39 instruction forms, fills the RAM up to RAM_SIZE
+// words, and has many labels and long .DATA strings with escaped quotes.
+// Print a program, or write a corpus of 5000 into an existing directory:
+//     gcc -std=c99 -o corpusgen corpusgen.c isa.c isa_hash.c
+//     corpusgen
+//     corpusgen 5000 corpus
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "isa.h"
+#include "config.h"
+
+#define CONSTANTS 120 // .LABEL constants per program
+
+/* Returns the next number of the xorshift generator at *state, so that the
+corpus is the same on every platform. */
+uint32_t next(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/* Returns a random number in [0, n). */
+int pick(uint32_t *state, int n)
+{
+	return (int)(next(state) % (uint32_t)n);
+}
+
+/* Writes a random value operand: a number in any format, or a constant. */
+void operand(FILE *f, uint32_t *state)
+{
+	int n = pick(state, 256);
+	switch (pick(state, 5)) {
+	case 0: fprintf(f, "%d", n); break;
+	case 1: fprintf(f, "0x%X", n); break;
+	case 2:
+		fprintf(f, "0b");
+		for (int bit = 7; bit >= 0; bit--) fputc('0' + (n >> bit & 1), f);
+		break;
+	case 3: fprintf(f, "-%d", 1 + n % 128); break;
+	default: fprintf(f, "c%d", pick(state, CONSTANTS)); break;
+	}
+}
+
+/* Writes a random register, using the aliases of R6 and R7 at times. */
+void reg(FILE *f, uint32_t *state)
+{
+	static const char *const names[] = {
+		"R0", "R1", "R2", "R3", "R4", "R5", "R6", "R7", "FLAGS", "SP", "r3"};
+	fprintf(f, "%s", names[pick(state, 11)]);
+}
+
+/* Writes instruction form 'form' of the keyword k, which is 0 or 1 for the
+value and register operands of types 4 and 5. Jumps go to the labels of
+previous lines or to the last line, which are all defined. */
+void instruction(FILE *f, uint32_t *state, const struct Keyword *k, int form,
+	int labels)
+{
+	if (pick(state, 4)) {
+		fprintf(f, "%s", k->name);
+	} else {
+		fprintf(f, "%c%s", k->name[0] | 0x20, k->name + 1); // mixed case
+	}
+	switch (k->format) {
+	case TYPE2:
+		fputc(' ', f);
+		reg(f, state);
+		break;
+	case TYPE3:
+		if (labels && pick(state, 2)) {
+			fprintf(f, " L%d", pick(state, labels));
+		} else if (pick(state, 2)) {
+			fprintf(f, " last");
+		} else {
+			fputc(' ', f);
+			operand(f, state);
+		}
+		break;
+	case TYPE4_5:
+		fputc(' ', f);
+		reg(f, state);
+		fprintf(f, pick(state, 2) ? ", " : ",");
+		if (k->bracketed) fputc('[', f);
+		if (form) {
+			reg(f, state);
+		} else {
+			operand(f, state);
+		}
+		if (k->bracketed) fputc(']', f);
+		break;
+	}
+}
+
+/* Writes program number 'seed' to f. */
+void program(FILE *f, uint32_t seed)
+{
+	uint32_t state = seed * 2654435761u + 1; // never 0
+	const struct Keyword *forms[64]; // instruction forms
+	int variant[64]; // operand form of each
+	int count = 0; // number of forms
+	for (int i = 0; i < ISA_KEYWORDS; i++) {
+		if (isa[i].format == REGISTER_NAME) continue;
+		for (int form = 0; form < (isa[i].format == TYPE4_5 ? 2 : 1); form++) {
+			forms[count] = &isa[i];
+			variant[count++] = form;
+		}
+	}
+	fprintf(f, "; Synthetic program %lu, generated by corpusgen\n",
+		(unsigned long) seed);
+	fprintf(f, ".TITLE \"Synthetic \\\"program\\\" %lu\"\n", (unsigned long) seed);
+	fprintf(f, ".SPEED %d\n.SIMDIP 0x%X\n", pick(&state, MAX_SPEED + 1),
+		pick(&state, 256));
+	for (int i = 0; i < CONSTANTS; i++) {
+		fprintf(f, ".LABEL c%d %d ; constant\n", i, 1 + pick(&state, 255));
+	}
+	// long strings with escaped quotes
+	int data = 0; // data words
+	for (int i = 0; i < 3; i++) {
+		int length = 10 + pick(&state, 12);
+		fprintf(f, ".DATA s%d \"", i);
+		for (int c = 0; c < length; c++) {
+			if (pick(&state, 8)) {
+				fputc('a' + pick(&state, 26), f);
+			} else {
+				fprintf(f, "\\\"");
+			}
+		}
+		fprintf(f, "\", %d, 0x0A\n", pick(&state, 256));
+		data += length + 2;
+	}
+	fprintf(f, ".MONITOR s%d\n\n", pick(&state, 3));
+	// all forms first, then random ones, until the RAM is full
+	int words = RAM_SIZE - data; // words left for the code
+	int labels = 0; // defined code labels
+	for (int line = 0; words > 0; line++) {
+		int i = line < count ? line : pick(&state, count);
+		if (forms[i]->size > words) {
+			// fill the last word with a 1-word instruction
+			for (i = 0; forms[i]->size > words; i++);
+		}
+		words -= forms[i]->size;
+		if (!words) {
+			fprintf(f, "last: ");
+		} else if (line && pick(&state, 3)) {
+			fprintf(f, pick(&state, 2) ? "L%d: " : "L%d:\t", labels++);
+		} else {
+			fprintf(f, "\t");
+		}
+		instruction(f, &state, forms[i], variant[i], labels);
+		fprintf(f, pick(&state, 3) ? "\n" : " ; comment\n");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int files = argc > 1 ? atoi(argv[1]) : 1;
+	if (argc < 3) {
+		program(stdout, 1);
+		return 0;
+	}
+	for (int i = 0; i < files; i++) {
+		char path[4096];
+		snprintf(path, sizeof(path), "%s/p%05d%s", argv[2], i, SOURCE_EXTENSION);
+		FILE *f = fopen(path, "w");
+		if (!f) {
+			fprintf(stderr, "Can't write %s\n", path);
+			return 1;
+		}
+		program(f, (uint32_t)i + 1);
+		fclose(f);
+	}
+	return 0;
+}
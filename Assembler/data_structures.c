@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <ctype.h>
 #include <string.h>
 
@@ -10,134 +11,373 @@
 #include "error_handler.h"
 #include "data_structures.h"
 #include "parse_functions.h"
+#include "isa.h"
+#include "stats.h"
 
-struct InputHeader In = {0};
-struct OutputHeader Out = {0};
+struct Line* addline(struct Assembler *as)
+{
+	struct InputHeader *In = &as->In;
+	if (In->lines_count == In->lines_size) {
+		int size = In->lines_size ? 2 * In->lines_size : 256;
+		struct Line *grown = realloc(In->lines, size * sizeof(*grown));
+		if (!grown) error(as, MEMORY_ALLOCATION_ERROR);
+		In->lines = grown;
+		In->lines_size = size;
+	}
+	return &In->lines[In->lines_count++];
+}
 
-void enqueue(const char* s)
+void enqueue(struct Assembler *as, const char *s, size_t n, int column)
 {
-	struct LineNode* new = malloc(sizeof(*new));
-	if (!new) error(MEMORY_ALLOCATION_ERROR);
-	// copy the string parameter to the reserved memory space
-	strncpy(new->line, s, MAX_LINE_LENGTH);
-	new->line[MAX_LINE_LENGTH - 1] = '\0'; // terminate, just to be sure
-	new->next = NULL;
-	if (!In.front) {
-		In.front = new;
-	} else {
-		In.rear->next = new;
+	struct Line *line = addline(as);
+	line->offset = (size_t)(s - as->In.source);
+	line->length = n;
+	line->column = column;
+	COUNT(as, lines, 1);
+	lexline(as, as->In.lines_count - 1);
+}
+
+/* Makes room for n more characters in In.text. */
+void reservetext(struct Assembler *as, size_t n)
+{
+	struct Text *t = &as->In.text;
+	if (t->length + n <= t->size) return;
+	size_t size = t->size ? t->size : 1024;
+	while (t->length + n > size) size *= 2;
+	char *grown = realloc(t->s, size);
+	if (!grown) error(as, MEMORY_ALLOCATION_ERROR);
+	t->s = grown;
+	t->size = size;
+}
+
+struct Token* addtoken(struct Assembler *as)
+{
+	struct InputHeader *In = &as->In;
+	if (In->count == In->size) {
+		int size = In->size ? 2 * In->size : 256;
+		struct Token *grown = realloc(In->tokens, size * sizeof(*grown));
+		if (!grown) error(as, MEMORY_ALLOCATION_ERROR);
+		In->tokens = grown;
+		In->size = size;
 	}
-	In.rear = new;
+	COUNT(as, tokens, 1);
+	return &In->tokens[In->count++];
 }
 
-char* firstline(void)
+/* Returns the FNV-1a hash of s. */
+uint32_t hashname(const char *s)
 {
-	In.line_number = 0;
-	In.chr = NULL;
-	In.token[0] = '\0';
-	return nextline(); // process the first line (and get the first token)
+	uint32_t h = 2166136261u;
+	for (; *s; s++) h = (h ^ (unsigned char)*s) * 16777619u;
+	return h;
 }
 
-char* nextline(void)
+/* Doubles the hash slots of the symbol table, and reinserts the symbols. */
+void growslots(struct Assembler *as)
 {
-	if (In.line_number == 0) {
-		In.current = In.front;
-	} else if (In.line_number > 0) {
-		In.current = In.current->next;
+	struct SymbolTable *t = &as->In.symbols;
+	int slots = t->slots ? 2 * t->slots : 256;
+	int *slot = calloc(slots, sizeof(*slot));
+	if (!slot) error(as, MEMORY_ALLOCATION_ERROR);
+	for (int id = 0; id < t->count; id++) {
+		uint32_t i = hashname(as->In.text.s + t->symbol[id].name);
+		while (slot[i & (slots - 1)]) i++; // linear probing
+		slot[i & (slots - 1)] = id + 1;
 	}
+	free(t->slot);
+	t->slot = slot;
+	t->slots = slots;
+}
 
-	if (In.current == NULL) {
-		In.line_number = -1; // require restart by firstline() at this point
-		In.chr = NULL;
-	} else {
-		In.line_number++;
-		In.chr = In.current->line;
+int intern(struct Assembler *as, size_t name)
+{
+	struct SymbolTable *t = &as->In.symbols;
+	const char *s = as->In.text.s + name;
+	if (2 * (t->count + 1) > t->slots) growslots(as); // load factor <= 1/2
+	uint32_t i = hashname(s);
+	for (; t->slot[i & (t->slots - 1)]; i++) {
+		int id = t->slot[i & (t->slots - 1)] - 1;
+		if (!strcmp(as->In.text.s + t->symbol[id].name, s)) return id;
+	}
+	if (t->count == t->size) {
+		int size = t->size ? 2 * t->size : 64;
+		struct Symbol *grown = realloc(t->symbol, size * sizeof(*grown));
+		if (!grown) error(as, MEMORY_ALLOCATION_ERROR);
+		t->symbol = grown;
+		t->size = size;
 	}
-	nexttoken();
-	return In.chr;
-}
-
-char* nexttoken(void)
-{
-	// In.chr++ ⇒ advances to next character
-	// *In.chr == '\\' && In.chr[1] == '"' ⇒ escaped quoted \" found
-	// In.token[i++] = *In.chr++ ⇒ copies current character, and then advances
-
-	strcpy(In.previous, In.token); // useful for error message context
-	/* Token character index; declared as unsigned char because of its
-	practical 255 limit. */
-	unsigned char i = 0; // token character index
-	In.token[0] = '\0';
-	// all lines/tokens were processed or line is empty
-	if (In.chr == NULL) return NULL;
-	if (*In.chr == '\0') return NULL;
-	while (isspace(*In.chr)) In.chr++; // skip leading whitespace
-	if (*In.chr == '"') {
-		// copy all quoted text, including the quotes
-		In.token[i++] = *In.chr++; // opening quote
-		while (*In.chr && *In.chr != '"') { // until closing quote or terminal
-			if (*In.chr == '\\' && In.chr[1] == '"') In.chr++; // escaped quote
-			In.token[i++] = *In.chr++;
+	t->symbol[t->count].name = name;
+	t->symbol[t->count].label = -1;
+	t->slot[i & (t->slots - 1)] = t->count + 1;
+	return t->count++;
+}
+
+/* Returns 1 if the last token lexed from line ends an operand, so that a
+following minus is a subtraction instead of the sign of a number. */
+char ends_operand(const struct InputHeader *In, const struct Line *line)
+{
+	if (In->count == line->first) return 0;
+	const struct Token *t = &In->tokens[In->count - 1];
+	return t->kind == NUMBER_TOKEN || t->kind == SYMBOL_TOKEN
+		|| (t->kind == PUNCTUATION_TOKEN && strchr(")$", t->value));
+}
+
+void lexline(struct Assembler *as, int i)
+{
+	struct InputHeader *In = &as->In;
+	struct Line *line = &In->lines[i];
+	const char *begin = In->source + line->offset;
+	const char *end = begin + line->length;
+	const char *chr = begin;
+	// the token texts of a line take at most its characters plus a
+	// terminator per token, so they are written in place without checks
+	reservetext(as, 2 * line->length + 1);
+	line->first = In->count;
+	for (;;) {
+		size_t offset = In->text.length;
+		char *text = In->text.s + offset; // token characters, after unescaping
+		int n = 0; // token character index
+		while (chr < end && isspace((unsigned char)*chr)) chr++; // whitespace
+		const char *start = chr;
+		unsigned char kind;
+		int value = 0;
+		if (chr == end) {
+			kind = END_TOKEN;
+		} else if (*chr == '"') {
+			// copy all quoted text, including the quotes
+			text[n++] = *chr++; // opening quote
+			while (chr < end && *chr != '"') { // until closing quote or end
+				if (*chr == '\\' && chr + 1 < end && chr[1] == '"') chr++;
+				text[n++] = *chr++;
+			}
+			if (chr == end) {
+				kind = UNCLOSED_TOKEN; // no closing quote found
+			} else {
+				kind = STRING_TOKEN;
+				text[n++] = *chr++; // closing quote
+			}
+		} else if (strchr(SINGLE_CHAR_DELIMITERS, *chr) && !(*chr == '-'
+			&& chr + 1 < end && isdigit((unsigned char)chr[1])
+			&& !ends_operand(In, line))) {
+			// a single-character delimiter
+			kind = PUNCTUATION_TOKEN;
+			value = *chr;
+			text[n++] = *chr++;
+		} else {
+			// all characters until hitting a delimiter or the end, and a
+			// leading minus of a negative number
+			if (*chr == '-') text[n++] = *chr++;
+			while (chr < end && !strchr(ALL_DELIMITERS, *chr)) {
+				text[n++] = *chr++;
+			}
+			text[n] = '\0';
+			const struct Keyword *k = keyword(text);
+			// numbers start with a digit or a minus
+			value = -1;
+			if (isdigit((unsigned char)text[0]) || text[0] == '-') {
+				COUNT(as, numbers, 1);
+				value = number(text);
+			}
+			if (value >= 0) {
+				kind = NUMBER_TOKEN;
+			} else if (k) {
+				kind = k->format == REGISTER_NAME
+					? REGISTER_TOKEN : MNEMONIC_TOKEN;
+				value = k->format == REGISTER_NAME ? k->opcode : (int)(k - isa);
+			} else if (text[0] == '.') {
+				kind = DIRECTIVE_TOKEN;
+				value = 0;
+			} else {
+				kind = SYMBOL_TOKEN;
+			}
 		}
-		if (*In.chr == '\0') error(UNCLOSED_STRING); // no closing quote found
-		In.token[i++] = *In.chr++; // closing quote
-	} else if (strchr(SINGLE_CHAR_DELIMITERS, *In.chr)) {
-		// copy a single-character delimiter
-		In.token[i++] = *In.chr++;
+		text[n] = '\0';
+		In->text.length += n + 1; // the terminator separates the texts
+		if (kind == SYMBOL_TOKEN) value = intern(as, offset);
+		struct Token *t = addtoken(as);
+		t->kind = kind;
+		t->value = value;
+		t->text = offset;
+		t->line = i + 1;
+		t->column = line->column + (int)(start - begin);
+		t->length = (int)(chr - start);
+		if (kind == END_TOKEN) break;
+	}
+}
+
+const struct Line* firstline(struct Assembler *as)
+{
+	struct InputHeader *In = &as->In;
+	In->line_number = 0;
+	In->token = "";
+	return nextline(as); // process the first line (and get the first token)
+}
+
+const struct Line* nextline(struct Assembler *as)
+{
+	struct InputHeader *In = &as->In;
+	if (In->line_number >= 0 && In->line_number < In->lines_count) {
+		In->current = &In->lines[In->line_number++];
+		In->next = In->current->first;
 	} else {
-		// copy all characters until hitting a delimiter or terminal
-		while (!strchr(ALL_DELIMITERS, *In.chr)) In.token[i++] = *In.chr++;
+		In->current = NULL;
+		In->line_number = -1; // require restart by firstline() at this point
+	}
+	nexttoken(as);
+	return In->current;
+}
+
+const char* nexttoken(struct Assembler *as)
+{
+	/* End of all lines, whose token is an END_TOKEN with empty text. */
+	static const struct Token end = {END_TOKEN, 0, 0, 0, 0, 0};
+	struct InputHeader *In = &as->In;
+	In->previous = In->token; // useful for error message context
+	if (!In->current || In->tokens[In->next].kind == END_TOKEN) {
+		// all lines/tokens were processed or line is empty
+		In->tok = In->current ? &In->tokens[In->next] : &end;
+		In->token = "";
+		return NULL;
 	}
-	In.token[i] = '\0'; // i++ was performed after the last copy
-	return In.token;
+	In->tok = &In->tokens[In->next++];
+	In->token = In->text.s + In->tok->text;
+	if (In->tok->kind == UNCLOSED_TOKEN) error(as, UNCLOSED_STRING);
+	return In->token;
+}
+
+void seektoken(struct Assembler *as, int i)
+{
+	struct InputHeader *In = &as->In;
+	In->previous = i > In->current->first
+		? In->text.s + In->tokens[i - 1].text : "";
+	In->tok = &In->tokens[i];
+	In->token = In->text.s + In->tok->text;
+	In->next = In->tok->kind == END_TOKEN ? i : i + 1;
 }
 
-int addlabel(const char* name, int value)
+int addlabel(struct Assembler *as, const struct Token *name, int value)
 {
-	if (Out.labels >= MAX_LABELS) error(MANY_LABELS);
-	Out.label[Out.labels].name = malloc(strlen(name) +1); // +1 = terminator
-	if (!Out.label[Out.labels].name) error(MEMORY_ALLOCATION_ERROR);
-	strcpy(Out.label[Out.labels].name, name);
-	Out.label[Out.labels].val = (unsigned char)value;
-	Out.labels++;
-	return Out.labels;
+	struct OutputHeader *Out = &as->Out;
+	struct Symbol *s = &as->In.symbols.symbol[name->value];
+	if (s->label >= 0) error(as, DUPLICATE_LABEL); // set in a previous line
+	if (Out->labels == Out->labels_size) {
+		int size = Out->labels_size ? 2 * Out->labels_size : 64;
+		struct LabelElement *grown = realloc(Out->label, size * sizeof(*grown));
+		if (!grown) error(as, MEMORY_ALLOCATION_ERROR);
+		Out->label = grown;
+		Out->labels_size = size;
+	}
+	Out->label[Out->labels].symbol = name->value;
+	Out->label[Out->labels].token = (int)(name - as->In.tokens);
+	Out->label[Out->labels].val = (unsigned char)value;
+	Out->label[Out->labels].kind = CONSTANT_LABEL;
+	Out->label[Out->labels].state = RESOLVED;
+	Out->label[Out->labels].size = 0;
+	s->label = Out->labels;
+	return ++Out->labels;
 }
 
-/* Compares the name field of LabelElement pointers a and b.
-nameA > nameB ≡ 1, nameA < nameB ≡ -1, nameA = nameB ≡ 0. */
-int comparelabels(const void* a, const void* b)
+int findlabel(struct Assembler *as)
 {
-	char* nameA = ((struct LabelElement*)a)->name;
-	char* nameB = ((struct LabelElement*)b)->name;
-	return strcmp(nameA, nameB);
+	if (TOK->kind != SYMBOL_TOKEN) return -1;
+	COUNT(as, lookups, 1);
+	return as->In.symbols.symbol[TOK->value].label;
 }
 
-void sortlabels(void)
+const char* codelabel(const struct Assembler *as, int addr)
 {
-	qsort(
-		Out.label, Out.labels, sizeof(struct LabelElement), comparelabels);
+	for (int i = 0; i < as->Out.labels; i++) {
+		const struct LabelElement *l = &as->Out.label[i];
+		if (l->kind == CODE_LABEL && l->val == addr) {
+			return as->In.text.s + as->In.symbols.symbol[l->symbol].name;
+		}
+	}
+	return NULL;
 }
 
-int findlabel(const char* name)
+void nextaddr(struct Assembler *as)
 {
-	struct LabelElement key = {.name = (char*)name};
-	struct LabelElement* found = (struct LabelElement*) bsearch(
-		&key, Out.label, Out.labels, sizeof(Out.label[0]), comparelabels);
-	
-	if (!found) return -1;
-	// use pointer arithmetic to calculate the index by the distance
-	// of the found element from the base address of the array
-	int i = (int)(found - Out.label);
-	// check for duplicates
-	if (i > 0 && strcmp(Out.label[i-1].name, name) == 0)
-		error(DUPLICATE_LABEL);
-	if (i < Out.labels - 1 && strcmp(Out.label[i+1].name, name) == 0)
-		error(DUPLICATE_LABEL);
-	return i;
+	struct OutputHeader *Out = &as->Out;
+	Out->addr++;
+	if (Out->addr > RAM_SIZE) error(as, RAM_LIMIT);
 }
 
-void nextaddr(void)
+void tagword(struct Assembler *as, enum WordType type)
 {
-	Out.addr++;
-	if (Out.addr > RAM_SIZE) error(RAM_LIMIT);
+	WORD.type = (unsigned char) type;
+	WORD.line = as->In.line_number;
+}
+
+/* Makes room for n more characters and a terminator in t. Returns 0 if
+memory can't be allocated. */
+int growtext(struct Text *t, size_t n)
+{
+	if (t->length + n + 1 <= t->size) return 1;
+	// grow geometrically to keep appends amortized O(1)
+	size_t size = t->size ? t->size : 256;
+	while (size < t->length + n + 1) size *= 2;
+	char *s = realloc(t->s, size);
+	if (!s) return 0;
+	t->s = s;
+	t->size = size;
+	return 1;
+}
+
+int vappend(struct Text *t, const char *format, va_list args)
+{
+	va_list copy;
+	va_copy(copy, args); // args are consumed twice, to measure and to write
+	int len = vsnprintf(NULL, 0, format, copy);
+	va_end(copy);
+	if (len < 0 || !growtext(t, len)) return 0;
+	vsnprintf(t->s + t->length, len + 1, format, args);
+	t->length += len;
+	return 1;
+}
+
+int appendn(struct Text *t, const char *s, size_t n)
+{
+	if (!growtext(t, n)) return 0;
+	memcpy(t->s + t->length, s, n);
+	t->length += n;
+	t->s[t->length] = '\0';
+	return 1;
+}
+
+int append(struct Text *t, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int result = vappend(t, format, args);
+	va_end(args);
+	return result;
+}
+
+char* sgets(char *dest, int size, const char **src)
+{
+	if (!**src) return NULL; // nothing left to read
+	int i = 0;
+	// copy up to size-1 characters, stopping after a newline
+	while (i < size - 1 && **src) {
+		dest[i] = *(*src)++;
+		if (dest[i++] == '\n') break;
+	}
+	dest[i] = '\0';
+	return dest;
+}
+
+char* readall(FILE *f)
+{
+	struct Text t = {0};
+	char str[4096]; // a line, or a part of a longer one
+	if (!append(&t, "")) return NULL; // an empty input is still a string
+	// read line by line, so that Ctrl-D is handled on interactive input
+	while (fgets(str, sizeof(str), f)) {
+		if (!append(&t, "%s", str)) {
+			free(t.s);
+			return NULL;
+		}
+		if (strchr(str, 4)) break; // end of transmit found
+	}
+	return t.s;
 }
@@ -4,83 +4,337 @@
 #ifndef DATA_STRUCTURES_H
 #define DATA_STRUCTURES_H
 
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <setjmp.h>
+
 #include "config.h"
+#include "error_handler.h"
+
+// ["],: and the operators of expressions
+#define SINGLE_CHAR_DELIMITERS "[\"],:+-*/%&|^~()<>$"
+// above + whitespace & terminal
+#define ALL_DELIMITERS "[\"],:+-*/%&|^~()<>$ \t\n\r\f\v\0"
+
+struct Stats;
+struct Rules;
+
+/* Growable string, used for the rendered output, the error report, the
+token texts and the title. */
+struct Text {
+	char *s;
+	size_t length;
+	size_t size; // allocated bytes
+};
+
+/* A line of the assembly input, as a view into the source buffer; the
+source is never copied or modified. */
+struct Line {
+	size_t offset; // start of the trimmed line in In.source
+	size_t length; // characters of the trimmed line, without comments
+	int column; // offset of the trimmed line in the source line
+	int first; // index of the line's first token in the token stream
+};
+
+/* Kind of a lexical token, classified once by the lexer. */
+enum TokenKind {
+	END_TOKEN, // end of a line, with empty text
+	MNEMONIC_TOKEN, // instruction; value = index in the ISA table
+	REGISTER_TOKEN, // register name; value = register address
+	NUMBER_TOKEN, // valid <number>; value = 0-255
+	SYMBOL_TOKEN, // any other word, such as a label; value = symbol id
+	DIRECTIVE_TOKEN, // word starting with a dot
+	STRING_TOKEN, // quoted string; text includes the quotes
+	UNCLOSED_TOKEN, // quoted string without a closing quote
+	PUNCTUATION_TOKEN // single-character delimiter; value = the character
+};
+
+/* Lexical token and its span in the source. */
+struct Token {
+	unsigned char kind; // enum TokenKind
+	int value; // pre-parsed value, according to the kind
+	size_t text; // offset of the null-terminated text in In.text
+	int line; // source line number
+	int column; // offset of the first character in the source line
+	int length; // number of characters spanned in the line
+};
 
-#define SINGLE_CHAR_DELIMITERS "[\"],:" // ["],:
-#define ALL_DELIMITERS "[\"],: \t\n\r\f\v\0" // above + whitespace & terminal
+/* Interned name of SYMBOL_TOKENs, shared by all their occurrences. */
+struct Symbol {
+	size_t name; // offset of the null-terminated name in In.text
+	int label; // index in Out.label, or -1 if it's no label
+};
 
-/* Stores a line from the assembly input */
-struct LineNode {
-	char line[MAX_LINE_LENGTH];
-	struct LineNode *next;
+/* Symbols and an open-addressing hash table of their names; labels are
+found through their symbols in O(1), without comparing names. */
+struct SymbolTable {
+	struct Symbol *symbol;
+	int count; // number of symbols
+	int size; // allocated symbols
+	int *slot; // symbol id plus 1, or 0 if the slot is empty
+	int slots; // number of slots, a power of 2
 };
 
-/* Stores the pointers to the LineNode list, and related variables for
-processing assembly input. */
+/* Stores the line views of the source, the token stream that is lexed
+once from all lines, and related variables for walking the tokens during
+the assembly passes. The lines, tokens and texts are single blocks that are
+reused by the next assembly and freed in one go. */
 struct InputHeader {
-	struct LineNode *front;
-	struct LineNode *rear;
-	struct LineNode *current;
-	char *chr; // tokenization candidate character at current->line
-	char token[MAX_LINE_LENGTH];
-	char previous[MAX_LINE_LENGTH]; // previous token for error context
+	const char *source; // assembly input, which must outlive the assembly
+	struct Line *lines;
+	int lines_count; // number of lines
+	int lines_size; // allocated lines
+	const struct Line *current;
+	struct Token *tokens; // tokens of all lines, each ending with END_TOKEN
+	int count; // number of tokens
+	int size; // allocated tokens
+	struct Text text; // null-terminated texts of the tokens, back to back
+	struct SymbolTable symbols;
+	int next; // index of the next token of the current line
+	const struct Token *tok; // current token
+	const char *token; // text of the current token
+	const char *previous; // previous token for error context
 	int line_number;
+	int label; // label of the last value(), as in WordInfo.label
+	unsigned char relocation; // enum Relocation of the last value()
+	unsigned char section; // enum LabelKind of the address of the last
+	// value(), as in WordInfo.section
+};
+
+/* What a label stands for. */
+enum LabelKind {
+	CONSTANT_LABEL, // a .LABEL number
+	CODE_LABEL, // an instruction address
+	DATA_LABEL, // the address of a .DATA array
+	EXTERN_LABEL, // a .EXTERN address, resolved by the linker
+	RESERVED_LABEL // the address of a .RESERVE buffer
 };
 
-/* Label/value pair, indexed at the LabelElement. */
+/* Evaluation state of a label's value. The values of code and .DATA labels
+are known once the symbols are collected, and .LABEL expressions are
+evaluated in order, or earlier when another expression refers to them. */
+enum LabelState {
+	RESOLVED, // the value is known
+	UNRESOLVED, // a .LABEL expression that isn't evaluated yet
+	RESOLVING, // a .LABEL expression that is being evaluated
+	UNRESOLVABLE // a .LABEL expression that is invalid or circular
+};
+
+/* Label/value pair, in the order of definition. */
 struct LabelElement {
-	char *name;
+	int symbol; // id of the label's name in In.symbols
+	int token; // index of the defining token in In.tokens
 	unsigned char val;
+	unsigned char kind; // enum LabelKind
+	unsigned char state; // enum LabelState
+	int size; // words of a .DATA array or a .RESERVE buffer
+};
+
+/* Role of a RAM word in the translated program. */
+enum WordType {
+	UNUSED_WORD, // never written, handled by OTHERS in VHDL
+	INSTRUCTION_WORD, // the opcode word (Instr1) of an instruction
+	OPERAND_WORD, // the 2nd word (Instr2) of a two-word instruction
+	DATA_WORD // a .DATA array element
+};
+
+/* How a value changes when the program is laid out at other addresses. */
+enum Relocation {
+	ABSOLUTE_VALUE, // computed from numbers and constants only
+	ADDRESS_VALUE, // an address of the program, from its labels or $
+	EXTERN_VALUE // a .EXTERN label plus a number, resolved by the linker
+};
+
+/* Metadata of a RAM word, kept alongside the binary image. */
+struct WordInfo {
+	unsigned char type; // enum WordType
+	int line; // source line number that produced the word
+	int label; // index in Out.label of the label a word holds alone, or of
+	// the .EXTERN label it's relative to, plus 1
+	unsigned char relocation; // enum Relocation of an operand or .DATA word
+	unsigned char section; // enum LabelKind of the section of an
+	// ADDRESS_VALUE: CODE_LABEL, DATA_LABEL or RESERVED_LABEL
+	int mnemonic; // index in In.tokens of the mnemonic of the instruction
+	// that the word ends, plus 1, or 0 for its name in capitals
 };
 
-/* Stores an array of LabelElements; this array is sorted after the symbol
-collection stage at main() to allow fast binary search. This header
-includes the final ram/comment arrays where the translated code is printed. */
+/* Kind of a region of the memory map. */
+enum RegionKind {
+	CODE_REGION, // a basic block of instructions
+	DATA_REGION, // a .DATA array
+	RESERVED_REGION // a .RESERVE buffer, which has no words in the image
+};
+
+/* A part of the RAM image and the address it had in source order, as laid
+out by the optimizer (-O2), or a section of an object placed by the
+linker. */
+struct Region {
+	unsigned char kind; // enum RegionKind
+	int from; // address in source order
+	int to; // address in the RAM image, or -1 if it was removed
+	int size; // words
+	int label; // index in Out.label of the label at its start, or -1
+	int line; // source line of its first word
+};
+
+/* Stores a growable array of LabelElements, which are linked to their
+symbols when they are added. This header includes the final binary RAM
+image with its per-word metadata, which is formatted to text only when the
+template is rendered, and the values of the directives that are written to
+the template. The comments of instructions are disassembled from their
+words by listing_comment(); the comment table holds only the text that the
+words can't give back: the source of .DATA elements and .TABLE indexes,
+and the comments of linked objects, whose source isn't at hand. */
 struct OutputHeader {
-	unsigned char labels;  // number of stored labels
-	struct LabelElement label[MAX_LABELS];
+	struct LabelElement *label;
+	int labels; // number of stored labels
+	int labels_size; // allocated labels
 	unsigned char addr; // current instruction address
-	char ram[255][9];
-	char comment[255][MAX_LINE_LENGTH];
+	char skipped[RAM_SIZE]; // words that .ORG and .ALIGN skip over
+	uint8_t mem[256]; // RAM image; 0xFF is mapped to the DIP input
+	struct WordInfo word[256];
+	char comment[255][MAX_COMMENT_LENGTH]; // empty for derived comments
+	struct Text title; // .TITLE string (optional)
+	int speed; // .SPEED value
+	int monitor; // .MONITOR value
+	int monitor_label; // index in Out.label of the .MONITOR value, plus 1
+	unsigned char monitor_relocation; // enum Relocation of the .MONITOR
+	unsigned char monitor_section; // enum LabelKind of its address
+	uint8_t simdip; // .SIMDIP value
+	int saved_words; // words saved by the optimizer
+	int saved_cycles; // cycles saved per execution of the rewritten code
+	struct Region region[RAM_SIZE]; // blocks and arrays moved by the layout,
+	// or the sections of the linked objects
+	int regions; // number of regions, or 0 if neither the layout nor the
+	// linker ran
+};
+
+/* An error of an assembly, the span of its offending token and its report. */
+struct ErrorRecord {
+	enum ErrorCode code;
+	int line; // source line number, or 0 if the error isn't line specific
+	int column; // offset of the offending token in the line
+	int length; // characters of the offending token, or of the whole line
+	int token; // index of the offending token in In.tokens, or -1
+	size_t report; // offset of the error's report in the diagnostic message
+	size_t report_length;
+};
+
+/* Errors and reports of a failed assembly. The passes resume at the next
+line after an error, so that all independent errors are reported at once, up
+to MAX_ERRORS and one per line. */
+struct Diagnostic {
+	enum ErrorCode code; // first error in line order, or NO_ERROR
+	int line; // line of the first error, or 0 if it isn't line specific
+	struct ErrorRecord error[MAX_ERRORS]; // in line order
+	int errors; // number of errors
+	struct Text message; // formatted error reports
+};
+
+/* Assembler context. Holds the complete state of a single assembly, so that
+any number of them can run back to back or on separate threads. Errors in a
+line jump back to the current pass via 'resync', which resumes at the next
+line, and other errors jump back to assemble() via 'abort', instead of
+terminating the process. */
+struct Assembler {
+	struct InputHeader In;
+	struct OutputHeader Out;
+	struct Diagnostic diagnostic;
+	struct Text output; // rendered template
+	jmp_buf resync;
+	jmp_buf abort;
+	char optimize; // optimization level (-O, -O2) applied before emission
+	char object; // assembles a relocatable object (-c), allowing .EXTERN
+	const struct Rules *rules; // superoptimizer rules for -O (--rules), or NULL
+#if STATS
+	struct Stats *stats; // collected statistics, or NULL
+#endif
 };
 
-extern struct InputHeader In; // global input data structure
-extern struct OutputHeader Out; // global output data structure
-#define TOKEN In.token
-#define PREVIOUS In.previous
-#define RAM Out.ram[Out.addr]
-#define COMMENT Out.comment[Out.addr] // advances to next comment with nextaddr()
+/* The following macros expect a context pointer named 'as' in scope. */
+#define TOKEN (as->In.token)
+#define PREVIOUS (as->In.previous)
+#define TOK (as->In.tok) // current token, whose text is TOKEN
+#define RAM (as->Out.mem[as->Out.addr])
+#define WORD (as->Out.word[as->Out.addr])
+#define COMMENT (as->Out.comment[as->Out.addr]) // advances with nextaddr()
 
-/* Inserts s in the LineNode list, after the last node. */
-void enqueue(const char *s);
+/* Appends an uninitialized line to the lines, and returns it. */
+struct Line* addline(struct Assembler *as);
+
+/* Appends an uninitialized token to the token stream, and returns it. */
+struct Token* addtoken(struct Assembler *as);
+
+/* Appends a view of the n characters at s, which lie in In.source at the
+given column of their source line, to the lines, and lexes it. */
+void enqueue(struct Assembler *as, const char *s, size_t n, int column);
+
+/* Appends the tokens of the line at index i to the token stream, followed by
+an END_TOKEN. Unclosed strings are lexed as UNCLOSED_TOKENs, and raise their
+error when nexttoken() reaches them. */
+void lexline(struct Assembler *as, int i);
+
+/* Returns the id of the symbol named by the text at offset 'name' of In.text,
+adding it if it's new. */
+int intern(struct Assembler *as, size_t name);
 
 /* Resets tokenization variables, moves the current pointer to the
-first line, copies the first token to the TOKEN scratchpad and returns
-a pointer to the first line. */
-char* firstline();
+first line, moves to its first token and returns the first line. */
+const struct Line* firstline(struct Assembler *as);
+
+/* Moves the current pointer to the next line, moves to its first token, and
+returns the current line. After the last line, returns NULL and requires a
+call to firstline() to restart. */
+const struct Line* nextline(struct Assembler *as);
 
-/* Moves the current pointer to the next line, copies the first token to the
-TOKEN scratchpad, and returns a pointer to the current line string. After the
-last node, returns NULL and requires a call to firstline() to restart. */
-char* nextline(void);
+/* Moves to the next token in the current line, pointing TOK at it and TOKEN
+at its text, which it returns. After the last token it returns NULL, with
+TOKEN set to "". No characters are copied. */
+const char* nexttoken(struct Assembler *as);
 
-/* Moves to the next token in the current line, copies its characters to the
-TOKEN scratchpad and returns a pointer to it. After the last token it returns
-NULL. */
-char* nexttoken(void);
+/* Moves to the token at index i of the current line, as nexttoken() would,
+setting PREVIOUS to the token before it. */
+void seektoken(struct Assembler *as, int i);
 
-/* Allocates memory for the label element and points the next index of
-the Out.label array to it. Returns the current number of labels. */
-int addlabel(const char* name, int value);
+/* Appends a label for the symbol of the given name token to the Out.label
+array, and links the symbol to it. Raises DUPLICATE_LABEL if the symbol is
+already a label. Returns the current number of labels. */
+int addlabel(struct Assembler *as, const struct Token *name, int value);
 
-/* Sorts the labels array according their linked LabelElement names. */
-void sortlabels();
+/* Returns the index of the current token's label in Out.label, or -1 if it's
+no label. */
+int findlabel(struct Assembler *as);
 
-/* Searches 'name' on the label array after its sorted, and returns its index,
-performing duplicate labels check. */
-int findlabel(const char* name);
+/* Returns the name of the first code label at addr, or NULL if there is
+none. */
+const char* codelabel(const struct Assembler *as, int addr);
 
 /* Moves to the next RAM address, checking for out-of-bounds error. */
-void nextaddr();
+void nextaddr(struct Assembler *as);
+
+/* Records the type and the current source line of the word at Out.addr. */
+void tagword(struct Assembler *as, enum WordType type);
+
+/* Appends printf-formatted text to t. Returns 0 if memory can't be allocated,
+in which case t is left unchanged. */
+int append(struct Text *t, const char *format, ...);
+
+/* Same as append(), with a va_list instead of variable arguments. */
+int vappend(struct Text *t, const char *format, va_list args);
+
+/* Appends the n characters at s to t, without formatting. Returns 0 if memory
+can't be allocated, in which case t is left unchanged. */
+int appendn(struct Text *t, const char *s, size_t n);
+
+/* Copies the next line of *src to dest, like fgets does for a stream, and
+advances *src after it. Returns NULL when *src is exhausted. */
+char* sgets(char *dest, int size, const char **src);
+
+/* Reads f until EOF or end-of-transmit (Ctrl-D) into a null-terminated
+string that must be freed by the caller. Lines may have any length. Returns
+NULL on allocation failure. */
+char* readall(FILE *f);
 
 #endif
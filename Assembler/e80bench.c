@@ -0,0 +1,411 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Assembler benchmark and golden-output check; not part of E80ASM itself.
+// Reports files/sec, MB/sec and peak RSS of in-process assemblies of all
+// .e80asm files of a directory, and with --exe also of one E80ASM process
+// per file and of a --batch run. --record writes the output of each file
+// (Program.vhd or its error report) next to it as a .golden file, and later
+// runs fail if any output differs from it. A .link file of the directory
+// names sources, one per line, that are assembled as objects and linked,
+// and its golden file is the linked Program.vhd. The golden files of the
+// bundled examples and of the regression fixtures in tests are kept with
+// them, so "e80bench ." and "e80bench tests" check them on any checkout.
+// Run it where Template.vhd is:
+//     gcc -std=c99 -O2 -o e80bench e80bench.c assembler.c data_structures.c
+//         error_handler.c isa.c isa_hash.c linker.c memory_map.c optimizer.c
+//         parse_functions.c rules.c simulator.c stats.c template.c -lm
+//     corpusgen 5000 corpus
+//     e80bench --record corpus
+//     e80bench [--rounds n] [--exe E80ASM] corpus
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // directories and resource usage in ISO C
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define PSAPI_VERSION 2 // GetProcessMemoryInfo of kernel32
+#include <psapi.h>
+#define NULL_DEVICE "NUL"
+#else
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#include "assembler.h"
+#include "linker.h"
+#include "parse_functions.h"
+#include "stats.h"
+
+#define LINK_EXTENSION ".link" // sources to assemble as objects and link
+#define MAX_LINKED 16 // sources of a .link file
+
+/* A source file of the corpus, loaded in memory. */
+struct Source {
+	char *path;
+	char *text;
+	size_t size;
+};
+
+/* The source files of a directory, in name order. */
+struct Corpus {
+	struct Source *file;
+	int count;
+	int size; // allocated files
+	size_t bytes; // total size of the sources
+};
+
+/* Reads the whole file at path, or returns NULL. */
+char* load(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) return NULL;
+	char *text = readall(f);
+	fclose(f);
+	if (text && size) *size = strlen(text);
+	return text;
+}
+
+/* Adds the file 'name' of directory dir to the corpus if it has the given
+extension, with its text if texts is set, or else with only its size. */
+int addsource(struct Corpus *c, const char *dir, const char *name,
+	const char *extension, char texts)
+{
+	size_t n = strlen(name), length = strlen(extension);
+	if (n <= length || !eq(name + n - length, extension)) return 1;
+	if (c->count == c->size) {
+		int size = c->size ? 2 * c->size : 256;
+		struct Source *grown = realloc(c->file, size * sizeof(*grown));
+		if (!grown) return 0;
+		c->file = grown;
+		c->size = size;
+	}
+	struct Source *s = &c->file[c->count];
+	s->path = malloc(strlen(dir) + n + 2);
+	if (!s->path) return 0;
+	sprintf(s->path, "%s/%s", dir, name);
+	s->text = load(s->path, &s->size);
+	if (!s->text) {
+		free(s->path);
+		return 0;
+	}
+	if (!texts) {
+		free(s->text);
+		s->text = NULL;
+	}
+	c->bytes += s->size;
+	c->count++;
+	return 1;
+}
+
+/* Frees the files of the corpus, and empties it. */
+void freecorpus(struct Corpus *c)
+{
+	for (int i = 0; i < c->count; i++) {
+		free(c->file[i].path);
+		free(c->file[i].text);
+	}
+	free(c->file);
+	memset(c, 0, sizeof(*c));
+}
+
+int comparesources(const void *a, const void *b)
+{
+	return strcmp(((const struct Source*)a)->path,
+		((const struct Source*)b)->path);
+}
+
+/* Loads all source files of the directory, as in addsource(). Returns 0
+on failure. */
+int loadcorpus(struct Corpus *c, const char *dir, const char *extension,
+	char texts)
+{
+	int ok = 1;
+#ifdef _WIN32
+	WIN32_FIND_DATAA entry;
+	char *pattern = malloc(strlen(dir) + 3);
+	if (!pattern) return 0;
+	sprintf(pattern, "%s\\*", dir);
+	HANDLE h = FindFirstFileA(pattern, &entry);
+	free(pattern);
+	if (h == INVALID_HANDLE_VALUE) return 0;
+	do {
+		ok = addsource(c, dir, entry.cFileName, extension, texts);
+	} while (ok && FindNextFileA(h, &entry));
+	FindClose(h);
+#else
+	DIR *d = opendir(dir);
+	struct dirent *entry;
+	if (!d) return 0;
+	while (ok && (entry = readdir(d))) {
+		ok = addsource(c, dir, entry->d_name, extension, texts);
+	}
+	closedir(d);
+#endif
+	qsort(c->file, c->count, sizeof(*c->file), comparesources);
+	return ok;
+}
+
+/* Returns the peak resident set of this process, or of its children, in
+KB, or 0 if it's unknown. */
+long peak_rss(char children)
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS m;
+	if (children || !GetProcessMemoryInfo(GetCurrentProcess(), &m, sizeof(m))) {
+		return 0;
+	}
+	return (long)(m.PeakWorkingSetSize / 1024);
+#else
+	struct rusage u;
+	if (getrusage(children ? RUSAGE_CHILDREN : RUSAGE_SELF, &u)) return 0;
+	return u.ru_maxrss; // KB on Linux and BSD
+#endif
+}
+
+/* Prints a line of throughput for files assembled 'rounds' times. */
+void report(const char *name, const struct Corpus *c, int rounds,
+	double seconds, long rss)
+{
+	double files = (double)c->count * rounds;
+	printf("%-12s %10.0f files/s %9.2f MB/s", name, files / seconds,
+		(double)c->bytes * rounds / seconds / 1e6);
+	if (rss) printf(" %8ld KB peak RSS", rss);
+	printf("\n");
+}
+
+/* Runs E80ASM once per file of the corpus, or once with --batch for the
+whole directory if batch is set, and reports the throughput and the peak
+RSS of those processes. Outside Windows it runs in a child process of its
+own, so that the peak RSS of its children is that of this mode alone; as a
+child starts with the memory of the process it's forked from, this runs
+before the texts of the corpus are loaded. */
+void processes(const char *exe, const struct Corpus *c, const char *dir,
+	char batch)
+{
+	char command[8192];
+#ifndef _WIN32
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid > 0) {
+		waitpid(pid, NULL, 0);
+		return;
+	}
+#endif
+	double start = now();
+	int ok = 1;
+	for (int i = 0; ok && i < (batch ? 1 : c->count); i++) {
+		if (batch) {
+			snprintf(command, sizeof(command),
+				"\"%s\" --batch \"%s\" > %s 2>&1", exe, dir, NULL_DEVICE);
+		} else {
+			snprintf(command, sizeof(command), "\"%s\" /Q < \"%s\" > %s 2>&1",
+				exe, c->file[i].path, NULL_DEVICE);
+		}
+		ok = system(command) >= 0;
+	}
+	if (ok) {
+		report(batch ? "batch" : "single-file", c, 1, now() - start,
+			peak_rss(1));
+	}
+#ifndef _WIN32
+	if (!pid) {
+		fflush(stdout);
+		_exit(0);
+	}
+#endif
+}
+
+/* Returns the output of the last assembly: the rendered template, or the
+error report. */
+const struct Text* result(const struct Assembler *as)
+{
+	return as->diagnostic.code == NO_ERROR ? &as->output : &as->diagnostic.message;
+}
+
+/* Path of the golden output of a source or .link file. */
+void goldenpath(char *dest, size_t size, const char *path)
+{
+	size_t n = strrchr(path, '.') - path;
+	snprintf(dest, size, "%.*s.golden", (int)n, path);
+}
+
+/* Renders the RAM image of as->Out through the template, as E80ASM does. */
+void render(struct Assembler *as, const struct Template *t)
+{
+	// put() jumps back here if the output can't be allocated
+	if (!setjmp(as->abort)) emit(as, t);
+}
+
+/* Assembles the sources that a .link file names, one per line and relative
+to its directory, as objects, and links them in that order, as E80ASM -c
+and --link would. The VHDL of the image or the error report is left in the
+context. */
+void link_list(struct Assembler *as, const struct Template *t,
+	const char *dir, const char *list)
+{
+	char *path[MAX_LINKED] = {0}, *object[MAX_LINKED] = {0};
+	int count = 0;
+	enum ErrorCode result = NO_ERROR;
+	while (*list && count < MAX_LINKED && result == NO_ERROR) {
+		int n = (int)strcspn(list, "\r\n");
+		struct Text text = {0};
+		path[count] = malloc(strlen(dir) + n + 2);
+		if (!path[count]) {
+			diagnose(as, result = MEMORY_ALLOCATION_ERROR);
+			break;
+		}
+		sprintf(path[count], "%s/%.*s", dir, n, list);
+		list += n + strspn(list + n, "\r\n");
+		char *source = load(path[count++], NULL);
+		as->object = 1;
+		if (!source) {
+			reset_assembler(as);
+			as->In.token = path[count - 1];
+			diagnose(as, result = OPEN_SOURCE);
+		} else if ((result = assemble(as, source, NULL)) == NO_ERROR
+			&& !format_object(as, &text)) {
+			diagnose(as, result = MEMORY_ALLOCATION_ERROR);
+		}
+		object[count - 1] = text.s;
+		as->object = 0;
+		free(source);
+	}
+	if (result == NO_ERROR) result = link_objects(as, object, path, count);
+	if (result == NO_ERROR) render(as, t);
+	for (int i = 0; i < count; i++) {
+		free(path[i]);
+		free(object[i]);
+	}
+}
+
+/* Writes the output of the last assembly of the file at path as its golden
+output, or compares it with the golden one if record isn't set, counting
+it in *checked. Returns 1 if it failed. */
+int check(const struct Assembler *as, const char *path, char record,
+	int *checked)
+{
+	const struct Text *out = result(as);
+	char golden[4096];
+	goldenpath(golden, sizeof(golden), path);
+	if (record) {
+		FILE *f = fopen(golden, "wb");
+		int failed = !f || fwrite(out->s, 1, out->length, f) != out->length;
+		if (failed) fprintf(stderr, "Can't write %s\n", golden);
+		if (f) fclose(f);
+		return failed;
+	}
+	size_t size;
+	char *expected = load(golden, &size);
+	if (!expected) return 0; // not recorded
+	int failed = size != out->length || memcmp(expected, out->s, size);
+	(*checked)++;
+	free(expected);
+	return failed;
+}
+
+/* Assembles each file once, and links the sources of each .link file,
+and writes their output as golden, or compares it with the golden one.
+Returns the number of failures. */
+int golden(struct Assembler *as, const struct Template *t,
+	const struct Corpus *c, const struct Corpus *links, const char *dir,
+	char record)
+{
+	int failures = 0, checked = 0;
+	for (int i = 0; i < c->count + links->count; i++) {
+		const struct Source *s = i < c->count ? &c->file[i]
+			: &links->file[i - c->count];
+		if (i < c->count) {
+			assemble(as, s->text, t);
+		} else {
+			link_list(as, t, dir, s->text);
+		}
+		if (check(as, s->path, record, &checked) && failures++ < 10) {
+			if (!record) printf("DIFFERS  %s\n", s->path);
+		}
+	}
+	if (!record && checked) {
+		printf("Golden outputs: %d checked, %d differ\n", checked, failures);
+	}
+	return failures;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *dir = NULL; // corpus directory
+	const char *exe = NULL; // E80ASM executable for process benchmarks
+	int rounds = 10; // in-process repetitions
+	char record = 0;
+	for (int i = 1; i < argc; i++) {
+		if (eq(argv[i], "--record")) {
+			record = 1;
+		} else if (eq(argv[i], "--rounds") && i + 1 < argc) {
+			rounds = atoi(argv[++i]);
+		} else if (eq(argv[i], "--exe") && i + 1 < argc) {
+			exe = argv[++i];
+		} else {
+			dir = argv[i];
+		}
+	}
+	if (!dir || rounds < 1) {
+		fprintf(stderr, "e80bench [--record] [--rounds n] [--exe E80ASM] "
+			"directory\n");
+		return 1;
+	}
+
+	struct Corpus c = {0};
+	if (exe && !record) {
+		if (!loadcorpus(&c, dir, SOURCE_EXTENSION, 0) || !c.count) {
+			fprintf(stderr, "Can't load the sources of %s\n", dir);
+			return 1;
+		}
+		printf("%d files, %lu bytes\n", c.count, (unsigned long)c.bytes);
+		processes(exe, &c, dir, 0); // one process per file, as from an editor
+		processes(exe, &c, dir, 1); // all files on all cores
+		freecorpus(&c);
+	}
+
+	char *text = load(TEMPLATE, NULL);
+	struct Template *t = text ? compile_template(text) : NULL;
+	struct Assembler *as = new_assembler();
+	free(text);
+	if (!t || !as || !loadcorpus(&c, dir, SOURCE_EXTENSION, 1) || !c.count) {
+		fprintf(stderr, "Can't load %s and the sources of %s\n", TEMPLATE, dir);
+		return 1;
+	}
+	if (!exe || record) {
+		printf("%d files, %lu bytes\n", c.count, (unsigned long)c.bytes);
+	}
+
+	struct Corpus links = {0};
+	if (!loadcorpus(&links, dir, LINK_EXTENSION, 1)) {
+		fprintf(stderr, "Can't load the %s files of %s\n", LINK_EXTENSION,
+			dir);
+		return 1;
+	}
+	int failures = golden(as, t, &c, &links, dir, record);
+	freecorpus(&links);
+	if (record) return failures != 0;
+
+	// in-process, one context reused for all assemblies
+	int errors = 0;
+	double start = now();
+	for (int r = 0; r < rounds; r++) {
+		for (int i = 0; i < c.count; i++) {
+			errors += assemble(as, c.file[i].text, t) != NO_ERROR;
+		}
+	}
+	report("in-process", &c, rounds, now() - start, peak_rss(0));
+	if (errors) printf("%d assemblies failed\n", errors / rounds);
+
+	freecorpus(&c);
+	free_template(t);
+	free_assembler(as);
+	return failures != 0;
+}
@@ -0,0 +1,570 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Superoptimizer of instruction windows; not part of E80ASM itself.
+// Enumerates the windows of up to 4 register and flag instructions (MOV, ADD,
+// SUB, AND, OR, XOR, ROR, CMP and BIT with a register or a number, LSHIFT and
+// RSHIFT) on two registers and a few numbers, and searches the shortest
+// equivalent of each on all processor cores. Candidates must match on random
+// states, and are then verified on all 8-bit values of both registers and
+// all CZSV flags with the ALU of the simulator, which follows ALU.vhd. The
+// rewrites are written as a rule database (see rules.h), for E80ASM -O to
+// apply with --rules:
+//     gcc -std=c99 -O2 -o e80-superopt e80superopt.c rules.c simulator.c
+//         data_structures.c error_handler.c isa.c isa_hash.c
+//         parse_functions.c -lpthread -lm
+//     e80-superopt [--length n] [--threads n] > superopt.rules
+//     e80asm -O --rules superopt.rules < program.e80asm > program.vhd
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // threads and sysconf in ISO C
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "rules.h"
+#include "simulator.h"
+#include "data_structures.h"
+#include "isa.h"
+
+/* Minimal thread and mutex wrappers over the Windows API and POSIX threads. */
+#ifdef _WIN32
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+#define mutex_init(m) InitializeCriticalSection(m)
+#define mutex_lock(m) EnterCriticalSection(m)
+#define mutex_unlock(m) LeaveCriticalSection(m)
+#define mutex_destroy(m) DeleteCriticalSection(m)
+#else
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+#define mutex_init(m) pthread_mutex_init(m, NULL)
+#define mutex_lock(m) pthread_mutex_lock(m)
+#define mutex_unlock(m) pthread_mutex_unlock(m)
+#define mutex_destroy(m) pthread_mutex_destroy(m)
+#endif
+
+#define MAX_LETTERS 256 // instructions of the alphabet
+#define MAX_REPLACEMENT 2 // instructions of a replacement
+#define TESTS 16 // random states of a fingerprint
+#define SAMPLES 256 // random states checked before all of them
+#define MASKS 4 // sets of flags that a rule may leave different
+#define DEFAULT_LENGTH 3 // instructions of the longest window
+
+/* Numbers of the alphabet: the identities and extremes of the operations. */
+static const unsigned char numbers[] = {0, 1, 0x7F, 0x80, 0xFF};
+
+/* Flags that a rule may leave different, fewest first. */
+static const int masks[MASKS] = {
+	0, CARRY | OVERFLOW, ZERO | SIGN, CARRY | ZERO | SIGN | OVERFLOW};
+
+/* The pattern registers A and B, and the CZSV flags. */
+struct Machine {
+	unsigned char r[PATTERN_REGISTERS];
+	unsigned char flags;
+};
+
+/* A sequence of instructions of the alphabet. */
+struct Window {
+	unsigned char letter[RULE_LENGTH];
+	int length;
+};
+
+/* A fingerprint of a replacement, sorted by hash and then by cost. */
+struct Entry {
+	uint64_t hash;
+	int cost;
+	int window; // index of the replacement
+};
+
+/* A growable array of windows or rules. */
+struct List {
+	void *item;
+	int count;
+	int size;
+};
+
+/* State shared by all workers. */
+struct Search {
+	unsigned char result[16][256][256]; // ALU result by ALUop, A and B
+	unsigned char set[16][256][256]; // the flags that it writes
+	unsigned char keep[16][256][256]; // the flags that it keeps
+	struct Pattern alphabet[MAX_LETTERS];
+	int letters;
+	int swapped[MAX_LETTERS]; // the letter with A and B swapped
+	struct Machine test[TESTS];
+	struct Machine sample[SAMPLES];
+	struct Window *replacement; // all windows of up to MAX_REPLACEMENT
+	int replacements;
+	struct Entry *table[MASKS]; // fingerprints of the replacements
+	struct Window *previous; // irreducible windows one shorter, sorted
+	int previous_count;
+	int taken; // prefixes taken from 'previous' by the workers
+	Mutex lock;
+};
+
+/* Thread argument, with the results of a worker. */
+struct Worker {
+	struct Search *search;
+	struct List windows; // irreducible windows of the length
+	struct List rules;
+	int failed; // memory can't be allocated
+	Thread thread;
+};
+
+/* Returns the next number of the xorshift generator at *state, so that the
+database is the same on every platform. */
+uint32_t xorshift(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/* Returns the number of online processor cores. */
+int processors(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+#endif
+}
+
+/* Appends an item of 'size' bytes to the list. Returns 0 if memory can't be
+allocated. */
+int push(struct List *l, const void *item, size_t size)
+{
+	if (l->count == l->size) {
+		int n = l->size ? 2 * l->size : 1024;
+		void *grown = realloc(l->item, n * size);
+		if (!grown) return 0;
+		l->item = grown;
+		l->size = n;
+	}
+	memcpy((char *)l->item + l->count++ * size, item, size);
+	return 1;
+}
+
+/* Adds an instruction to the alphabet. */
+void letter(struct Search *s, int op, int reg, int reg2, int n)
+{
+	struct Pattern p = {(unsigned char)op, (unsigned char)reg,
+		(signed char)reg2, (unsigned char)n};
+	s->alphabet[s->letters++] = p;
+}
+
+/* Builds the alphabet: the operations with each register and number, and
+the shifts. */
+void build_alphabet(struct Search *s)
+{
+	static const int ops[] = {MOV_OP, ADD_OP, SUB_OP, AND_OP, OR_OP, XOR_OP,
+		ROR_OP, CMP_OP, BIT_OP};
+	for (size_t i = 0; i < sizeof(ops) / sizeof(*ops); i++) {
+		for (int r = 0; r < PATTERN_REGISTERS; r++) {
+			for (int r2 = 0; r2 < PATTERN_REGISTERS; r2++) {
+				letter(s, ops[i], r, r2, 0);
+			}
+			for (size_t n = 0; n < sizeof(numbers); n++) {
+				letter(s, ops[i], r, -1, numbers[n]);
+			}
+		}
+	}
+	for (int r = 0; r < PATTERN_REGISTERS; r++) {
+		letter(s, LSHIFT_OP, r, -1, 0);
+		letter(s, RSHIFT_OP, r, -1, 0);
+	}
+	for (int i = 0; i < s->letters; i++) {
+		struct Pattern p = s->alphabet[i];
+		p.reg = !p.reg;
+		if (p.reg2 >= 0) p.reg2 = (signed char)!p.reg2;
+		for (int j = 0; j < s->letters; j++) {
+			if (!memcmp(&p, &s->alphabet[j], sizeof(p))) s->swapped[i] = j;
+		}
+	}
+}
+
+/* Tabulates the ALU of the simulator for all ALUops. Each flag is either
+written or kept, which flags_in 0 and 0xFF tell apart. */
+void tabulate_alu(struct Search *s)
+{
+	for (int op = 0; op < 16; op++) {
+		for (int a = 0; a < 256; a++) {
+			for (int b = 0; b < 256; b++) {
+				int out, cleared, all;
+				alu(op, a, b, 0, &out, &cleared);
+				alu(op, a, b, 0xFF, &out, &all);
+				s->result[op][a][b] = (unsigned char)out;
+				s->set[op][a][b] = (unsigned char)cleared;
+				s->keep[op][a][b] = (unsigned char)(all & ~cleared);
+			}
+		}
+	}
+}
+
+/* Executes a window on the machine m. */
+void execute(const struct Search *s, const struct Window *w,
+	struct Machine *m)
+{
+	for (int i = 0; i < w->length; i++) {
+		const struct Pattern *p = &s->alphabet[w->letter[i]];
+		int a = m->r[p->reg];
+		int b = p->reg2 < 0 ? p->n : m->r[(int)p->reg2];
+		int op = p->op >> 4;
+		if (p->op == MOV_OP) {
+			m->r[p->reg] = (unsigned char)b;
+			continue;
+		}
+		m->r[p->reg] = s->result[op][a][b];
+		m->flags = (m->flags & s->keep[op][a][b]) | s->set[op][a][b];
+	}
+}
+
+/* Returns the cycles of a window in its high bits, and its words in the
+low ones. */
+int cost(const struct Search *s, const struct Window *w)
+{
+	int words = 0;
+	for (int i = 0; i < w->length; i++) {
+		words += pattern_size(&s->alphabet[w->letter[i]]);
+	}
+	return w->length << 4 | words;
+}
+
+/* Returns the pattern registers that a window names, as bits. */
+int named(const struct Search *s, const struct Window *w)
+{
+	int used = 0;
+	for (int i = 0; i < w->length; i++) {
+		const struct Pattern *p = &s->alphabet[w->letter[i]];
+		used |= 1 << p->reg;
+		if (p->reg2 >= 0) used |= 1 << p->reg2;
+	}
+	return used;
+}
+
+/* Returns 1 if the window leaves the machine m as the window x does, but
+for the flags of 'mask'. */
+int same(const struct Search *s, const struct Window *w,
+	const struct Window *x, struct Machine m, int mask)
+{
+	struct Machine n = m;
+	execute(s, w, &m);
+	execute(s, x, &n);
+	return m.r[0] == n.r[0] && m.r[1] == n.r[1]
+		&& ((m.flags ^ n.flags) & ~mask) == 0;
+}
+
+/* Returns the hash of the states that the window leaves the tests in, but
+for the flags of 'mask'. */
+uint64_t fingerprint(const struct Search *s, const struct Window *w, int mask)
+{
+	uint64_t h = 0xCBF29CE484222325ULL; // FNV-1a
+	for (int t = 0; t < TESTS; t++) {
+		struct Machine m = s->test[t];
+		execute(s, w, &m);
+		unsigned char state[3] = {m.r[0], m.r[1], m.flags & ~mask};
+		for (int i = 0; i < 3; i++) {
+			h = (h ^ state[i]) * 0x100000001B3ULL;
+		}
+	}
+	return h;
+}
+
+/* Returns 1 if the windows are equivalent but for the flags of 'mask': on
+the random samples first, and then on all values of the registers that they
+name and all CZSV flags. No register depends on the flags, and the ALU
+either writes or keeps each flag, so all flags clear and all flags set
+cover the 16 combinations. */
+int equivalent(const struct Search *s, const struct Window *w,
+	const struct Window *x, int mask)
+{
+	for (int i = 0; i < SAMPLES; i++) {
+		if (!same(s, w, x, s->sample[i], mask)) return 0;
+	}
+	int b = (named(s, w) | named(s, x)) & 2 ? 256 : 1;
+	for (int ra = 0; ra < 256; ra++) {
+		for (int rb = 0; rb < b; rb++) {
+			for (int f = 0; f < 0x100; f += 0xF0) {
+				struct Machine m = {{(unsigned char)ra, (unsigned char)rb},
+					(unsigned char)f};
+				if (!same(s, w, x, m, mask)) return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/* Orders fingerprints by hash, cost and replacement. */
+int compare_entries(const void *a, const void *b)
+{
+	const struct Entry *x = a, *y = b;
+	if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+	if (x->cost != y->cost) return x->cost - y->cost;
+	return x->window - y->window;
+}
+
+/* Orders windows of the same length by their letters. */
+int compare_windows(const void *a, const void *b)
+{
+	return memcmp(((const struct Window *)a)->letter,
+		((const struct Window *)b)->letter, RULE_LENGTH);
+}
+
+/* Returns the cost of a replacement, as cost() does. */
+int rule_cost(const struct Rule *r)
+{
+	int words = 0;
+	for (int i = 0; i < r->size; i++) words += pattern_size(&r->to[i]);
+	return r->size << 4 | words;
+}
+
+/* Orders rules by window, and then by the cost of their replacement. */
+int compare_rules(const void *a, const void *b)
+{
+	const struct Rule *x = a, *y = b;
+	int c = memcmp(x->from, y->from, sizeof(x->from));
+	if (c) return c;
+	if (rule_cost(x) != rule_cost(y)) return rule_cost(x) - rule_cost(y);
+	return memcmp(x->to, y->to, sizeof(x->to));
+}
+
+/* Builds the replacements of up to MAX_REPLACEMENT instructions and their
+fingerprints. Returns 0 if memory can't be allocated. */
+int build_tables(struct Search *s)
+{
+	int n = 1, total = 1;
+	for (int i = 0; i < MAX_REPLACEMENT; i++) total += n *= s->letters;
+	s->replacement = calloc(total, sizeof(*s->replacement));
+	if (!s->replacement) return 0;
+	for (int i = 0; i < total; i++) {
+		// 0 is the empty window, then the ones of 1, 2, ... letters
+		struct Window *w = &s->replacement[i];
+		for (int k = i; k > 0; k /= s->letters) {
+			k--;
+			w->letter[w->length++] = (unsigned char)(k % s->letters);
+		}
+	}
+	s->replacements = total;
+	for (int m = 0; m < MASKS; m++) {
+		s->table[m] = malloc(total * sizeof(**s->table));
+		if (!s->table[m]) return 0;
+		for (int i = 0; i < total; i++) {
+			struct Entry e = {fingerprint(s, &s->replacement[i], masks[m]),
+				cost(s, &s->replacement[i]), i};
+			s->table[m][i] = e;
+		}
+		qsort(s->table[m], total, sizeof(**s->table), compare_entries);
+	}
+	return 1;
+}
+
+/* Returns 1 if the window, with A named first, is one of the previous
+irreducible windows. */
+int irreducible(const struct Search *s, struct Window w)
+{
+	if (!w.length) return 1;
+	if (s->alphabet[w.letter[0]].reg) {
+		for (int i = 0; i < w.length; i++) w.letter[i] = s->swapped[w.letter[i]];
+	}
+	return bsearch(&w, s->previous, s->previous_count, sizeof(w),
+		compare_windows) != NULL;
+}
+
+/* Searches the cheapest replacement of the window for each mask, and adds
+the ones that are cheaper than those of fewer flags to the rules. Returns 1
+if the window is irreducible, or -1 if memory can't be allocated. Windows
+that a rule reduces aren't extended, as the optimizer applies their rule
+within any longer window where it may. */
+int reduce(struct Worker *worker, const struct Window *w)
+{
+	const struct Search *s = worker->search;
+	int best = cost(s, w);
+	int used = named(s, w);
+	int result = 1;
+	for (int m = 0; m < MASKS; m++) {
+		struct Entry key = {fingerprint(s, w, masks[m]), 0, 0};
+		const struct Entry *table = s->table[m];
+		int lo = 0, hi = s->replacements;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (compare_entries(&table[mid], &key) < 0) lo = mid + 1;
+			else hi = mid;
+		}
+		for (; lo < s->replacements && table[lo].hash == key.hash
+			&& table[lo].cost < best; lo++) {
+			const struct Window *x = &s->replacement[table[lo].window];
+			if ((named(s, x) & ~used) || !equivalent(s, w, x, masks[m])) continue;
+			struct Rule r = {{{0}}, {{0}}, (unsigned char)w->length,
+				(unsigned char)x->length, (unsigned char)masks[m]};
+			for (int i = 0; i < w->length; i++) r.from[i] = s->alphabet[w->letter[i]];
+			for (int i = 0; i < x->length; i++) r.to[i] = s->alphabet[x->letter[i]];
+			if (!push(&worker->rules, &r, sizeof(r))) return -1;
+			best = table[lo].cost;
+			result = 0;
+			break;
+		}
+	}
+	return result;
+}
+
+/* Worker thread: extends the previous irreducible windows by each letter,
+and reduces the windows whose suffix is irreducible too. */
+#ifdef _WIN32
+DWORD WINAPI search_worker(LPVOID arg)
+#else
+void* search_worker(void *arg)
+#endif
+{
+	struct Worker *worker = arg;
+	struct Search *s = worker->search;
+	for (;;) {
+		mutex_lock(&s->lock);
+		int i = s->taken < s->previous_count ? s->taken++ : -1;
+		mutex_unlock(&s->lock);
+		if (i < 0 || worker->failed) break;
+		for (int l = 0; l < s->letters; l++) {
+			struct Window w = s->previous[i], suffix;
+			if (!w.length && s->alphabet[l].reg) continue; // A is named first
+			w.letter[w.length++] = (unsigned char)l;
+			memset(&suffix, 0, sizeof(suffix));
+			suffix.length = w.length - 1;
+			memcpy(suffix.letter, w.letter + 1, suffix.length);
+			if (w.length > 1 && !irreducible(s, suffix)) continue;
+			int r = reduce(worker, &w);
+			if (r < 0 || (r && !push(&worker->windows, &w, sizeof(w)))) {
+				worker->failed = 1;
+				break;
+			}
+		}
+	}
+	return 0;
+}
+
+/* Searches the windows of the length on the workers, and appends their
+rules to 'rules'. The irreducible windows become the previous ones. Returns
+0 if memory can't be allocated. */
+int search_length(struct Search *s, struct Worker *workers, int threads,
+	struct List *rules)
+{
+	struct List windows = {0};
+	int ok = 1;
+	s->taken = 0;
+	for (int i = 0; i < threads; i++) {
+		memset(&workers[i], 0, sizeof(workers[i]));
+		workers[i].search = s;
+#ifdef _WIN32
+		workers[i].thread = CreateThread(NULL, 0, search_worker, &workers[i], 0,
+			NULL);
+#else
+		pthread_create(&workers[i].thread, NULL, search_worker, &workers[i]);
+#endif
+	}
+	for (int i = 0; i < threads; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(workers[i].thread, INFINITE);
+		CloseHandle(workers[i].thread);
+#else
+		pthread_join(workers[i].thread, NULL);
+#endif
+		struct Worker *w = &workers[i];
+		ok = ok && !w->failed;
+		for (int k = 0; ok && k < w->windows.count; k++) {
+			ok = push(&windows, (struct Window *)w->windows.item + k,
+				sizeof(struct Window));
+		}
+		for (int k = 0; ok && k < w->rules.count; k++) {
+			ok = push(rules, (struct Rule *)w->rules.item + k,
+				sizeof(struct Rule));
+		}
+		free(w->windows.item);
+		free(w->rules.item);
+	}
+	// the workers finish in any order, so their results are sorted
+	qsort(windows.item, windows.count, sizeof(struct Window), compare_windows);
+	free(s->previous);
+	s->previous = windows.item;
+	s->previous_count = windows.count;
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	int length = DEFAULT_LENGTH;
+	int threads = processors();
+	uint32_t state = 80;
+	struct Search *s = calloc(1, sizeof(*s));
+	struct List rules = {0};
+	struct Text t = {0};
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--length") && i + 1 < argc) {
+			length = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else {
+			length = 0;
+		}
+	}
+	if (length < 1 || length > RULE_LENGTH || threads < 1) {
+		fprintf(stderr, "Usage: e80-superopt [--length 1-%d] [--threads n]\n",
+			RULE_LENGTH);
+		return 1;
+	}
+	struct Worker *workers = calloc(threads, sizeof(*workers));
+	if (!s || !workers) {
+		fputs("Memory allocation error!\n", stderr);
+		return 1;
+	}
+	build_alphabet(s);
+	tabulate_alu(s);
+	for (int i = 0; i < TESTS + SAMPLES; i++) {
+		uint32_t x = xorshift(&state);
+		struct Machine m = {{(unsigned char)x, (unsigned char)(x >> 8)},
+			(unsigned char)(x >> 16 & 0xF0)};
+		if (i < TESTS) s->test[i] = m;
+		else s->sample[i - TESTS] = m;
+	}
+	mutex_init(&s->lock);
+	int ok = build_tables(s);
+	s->previous = ok ? calloc(1, sizeof(struct Window)) : NULL;
+	s->previous_count = 1; // the empty window
+	for (int l = 1; s->previous && l <= length; l++) {
+		int found = rules.count;
+		if (!(ok = search_length(s, workers, threads, &rules))) break;
+		fprintf(stderr, "Length %d: %d rules, %d irreducible windows.\n", l,
+			rules.count - found, s->previous_count);
+	}
+	mutex_destroy(&s->lock);
+	// longer windows first, as the optimizer applies the first rule matching
+	qsort(rules.item, rules.count, sizeof(struct Rule), compare_rules);
+	ok = ok && s->previous && append(&t, RULES_SIGNATURE "\n");
+	for (int l = length; ok && l > 0; l--) {
+		for (int i = 0; ok && i < rules.count; i++) {
+			const struct Rule *r = (struct Rule *)rules.item + i;
+			if (r->length == l) ok = format_rule(r, &t);
+		}
+	}
+	if (ok) fputs(t.s, stdout);
+	else fputs("Memory allocation error!\n", stderr);
+	free(t.s);
+	free(rules.item);
+	free(s->previous);
+	free(s->replacement);
+	for (int m = 0; m < MASKS; m++) free(s->table[m]);
+	free(s);
+	free(workers);
+	return !ok;
+}
@@ -3,12 +3,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <setjmp.h>
 #include "error_handler.h"
 #include "data_structures.h"
 #include "parse_functions.h"
 
-void printf_number_format_help(void) {
-	fprintf(stderr,
+void printf_number_format_help(struct Text *t) {
+	append(t,
 		"Numbers can either be:\n"
 		"1) Hexadecimal preceded by 0x, up to 2 digits (eg. 0x0F)\n"
 		"2) Binary preceded by 0b, up to 8 digits (eg. 0b00001111)\n"
@@ -16,131 +17,285 @@ void printf_number_format_help(void) {
 		"Signed minimum is -128, -0b10000000, -0x80\n");
 }
 
-void printf_number_error(const char *s) {
+void printf_number_error(struct Text *t, const char *s) {
 	if (number(s) == HEX_ERROR) {
-		fprintf(stderr,
+		append(t,
 			"Hexadecimals are limited to 2 digits (eg. 0xF or 0x1A).");
 	} else if (number(s) == BIN_ERROR) {
-		fprintf(stderr, "Binaries are limited to 8 digits (eg. 0b00101011).");
+		append(t, "Binaries are limited to 8 digits (eg. 0b00101011).");
 	} else if (number(s) == OCTAL_ERROR) {
-		fprintf(stderr, "Leading zeroes are not allowed on decimal numbers.");
+		append(t, "Leading zeroes are not allowed on decimal numbers.");
 	} else if (number(s) == SIGNED_RANGE_ERROR) {
-		fprintf(stderr, "Signed minimum is -128.");
+		append(t, "Signed minimum is -128.");
 	} else if (number(s) == RANGE_ERROR) {
-		fprintf(stderr, "Unsigned numbers are limited to 0-255,");
+		append(t, "Unsigned numbers are limited to 0-255,");
 	}
 }
 
-/* Terminates execution, printing a message and returns an error code. */
-void error(enum ErrorCode errorlevel)
+void diagnose(struct Assembler *as, enum ErrorCode errorlevel)
 {
-	fprintf(stderr,	"\n******************************************************\n");
-	if (In.line_number) {
-		fprintf(stderr,
-			"Error in line %d : %s\n", In.line_number, In.current->line);
+	struct Diagnostic *d = &as->diagnostic;
+	struct Text *t = &d->message;
+	int line = as->In.line_number > 0 ? as->In.line_number : 0;
+	for (int i = 0; i < d->errors; i++) {
+		// later errors of a line are mostly consequences of the first one
+		if (line && d->error[i].line == line) return;
+	}
+	if (d->errors == MAX_ERRORS) return;
+	struct ErrorRecord *e = &d->error[d->errors++];
+	if (d->code == NO_ERROR) {
+		d->code = errorlevel;
+		d->line = line;
+	}
+	e->code = errorlevel;
+	e->line = line;
+	e->column = e->length = 0;
+	e->token = -1;
+	e->report = t->length;
+	append(t, "\n******************************************************\n");
+	if (line) {
+		const struct Line *current = as->In.current;
+		// the span of the current token, or else of the whole line
+		if (TOK->line == line && TOK->length) {
+			e->column = TOK->column;
+			e->length = TOK->length;
+			e->token = (int)(TOK - as->In.tokens);
+		} else {
+			e->column = current->column;
+			e->length = (int)current->length;
+		}
+		append(t, "Error in line %d : %.*s\n", line,
+			(int)current->length, as->In.source + current->offset);
 	}
 
 	switch (errorlevel) {
 	case OPEN_TEMPLATE:
-		fprintf(stderr, "Error! Can't open the template file '%s'", TEMPLATE);
+		append(t, "Error! Can't open the template file '%s'", TEMPLATE);
 		break;
 	case MAX_LENGTH_EXCEEDED:
-		fprintf(stderr, "Line exceeds maximum %d characters.", MAX_LINE_LENGTH);
+		append(t, "Line exceeds the maximum length.");
 		break;
 	case LABEL:
-		fprintf(stderr, "'%s' is not a valid label.", TOKEN);
+		append(t, "'%s' is not a valid label.", TOKEN);
 		break;
 	case EMPTY_STRING:
-		fprintf(stderr, "Empty strings are not permitted.");
+		append(t, "Empty strings are not permitted.");
 		break;
 	case UNCLOSED_STRING:
-		fprintf(stderr, "Quote expected after string '%s'.", TOKEN);
+		append(t, "Quote expected after string '%s'.", TOKEN);
 		break;
 	case ARRAY_ELEMENT:
 		if (eq(TOKEN,"")) {
-			fprintf(stderr, "Expected an array element.");
+			append(t, "Expected an array element.");
 		} else if (number(TOKEN) != NUMBER_ERROR) {
-			printf_number_error(TOKEN);
+			printf_number_error(t, TOKEN);
 		} else {
-			fprintf(stderr, "'%s' is not a literal.\n", TOKEN);
-			fprintf(stderr, "Example of an array: .DATA str 12, \"abc\", 0xAF, 0b1011.");
+			append(t, "'%s' is not a literal.\n", TOKEN);
+			append(t, "Example of an array: .DATA str 12, \"abc\", 0xAF, 0b1011.");
 		}
 		break;
 	case SPEED:
-		fprintf(stderr, "Speed must be between '%d' and '%d'.", MIN_SPEED, MAX_SPEED);
+		append(t, "Speed must be between '%d' and '%d'.", MIN_SPEED, MAX_SPEED);
 		break;
 	case NUMBER:
-		fprintf(stderr, "'%s' is not a valid number.\n", TOKEN);
-		printf_number_format_help();
+		append(t, "'%s' is not a valid number.\n", TOKEN);
+		printf_number_format_help(t);
 		break;
 	case MANY_LABELS:
-		puts("Maximum number of labels reached");
+		append(t, "Maximum number of labels reached");
 		break;
 	case DUPLICATE_LABEL:
-		fprintf(stderr, "This label has been set in a previous line.");
+		append(t, "This label has been set in a previous line.");
 		break;
 	case MEMORY_ALLOCATION_ERROR:
-		puts("Memory allocation error!");
+		append(t, "Memory allocation error!");
 		break;
 	case EXTRANEOUS:
-		fprintf(stderr, "'%s' was unexpected.", TOKEN);
+		append(t, "'%s' was unexpected.", TOKEN);
 		break;
 	case DIRECTIVE:
-		fprintf(stderr, "'%s' is not a directive.", TOKEN);
+		append(t, "'%s' is not a directive.", TOKEN);
 		break;
 	case INSTRUCTION_LABEL:
-		fprintf(stderr, "'%s' is no instruction or label.", TOKEN);
+		append(t, "'%s' is no instruction or label.", TOKEN);
 		break;
 	case INSTRUCTION_COLON:
-		fprintf(stderr, "'%s' is no instruction, or missing a colon.", PREVIOUS);
+		append(t, "'%s' is no instruction, or missing a colon.", PREVIOUS);
 		break;
 	case INSTRUCTION:
-		fprintf(stderr, "'%s' is no instruction.", TOKEN);
+		append(t, "'%s' is no instruction.", TOKEN);
 		break;
 	case RESERVED:
-		fprintf(stderr, "'%s' is reserved and cannot be used here.", TOKEN);
+		append(t, "'%s' is reserved and cannot be used here.", TOKEN);
 		break;
 	case REGISTER:
 		if (eq(TOKEN, "")) {
-			fprintf(stderr,"Expected register after '%s'.", PREVIOUS);
+			append(t, "Expected register after '%s'.", PREVIOUS);
 		} else {
-			fprintf(stderr, "'%s' is not a register.", TOKEN);
+			append(t, "'%s' is not a register.", TOKEN);
 		}
 		break;
 	case VALUE:
-		fprintf(stderr, "'%s' is not a number or label\n", TOKEN);
-		printf_number_error(TOKEN);
+		append(t, "'%s' is not a number or label\n", TOKEN);
+		printf_number_error(t, TOKEN);
 		break;
 	case COMMA:
-		fprintf(stderr, "Comma expected after '%s'.", PREVIOUS);
+		append(t, "Comma expected after '%s'.", PREVIOUS);
 		break;
 	case LEFTBRACKET:
-		fprintf(stderr, "LOAD/STORE requires a left bracket before '%s'.", TOKEN);
+		append(t, "LOAD/STORE requires a left bracket before '%s'.", TOKEN);
 		break;
 	case RIGHTBRACKET:
-		fprintf(stderr, "LOAD/STORE requires a right bracket after '%s'.", PREVIOUS);
+		append(t, "LOAD/STORE requires a right bracket after '%s'.", PREVIOUS);
 		break;
 	case OP2:
 		if (eq(TOKEN, "")) {
-			fprintf(stderr,"Expected number, label or register after comma.");
+			append(t, "Expected number, label or register after comma.");
 		} else {
-			fprintf(stderr, "'%s' is not a number, label or register.\n", TOKEN);
-			printf_number_error(TOKEN);
+			append(t, "'%s' is not a number, label or register.\n", TOKEN);
+			printf_number_error(t, TOKEN);
 		}
 		break;
 	case RAM_LIMIT:
-		fprintf(stderr, "%d-byte RAM limit exceeded.", RAM_SIZE);
+		append(t, "%d-byte RAM limit exceeded.", RAM_SIZE);
 		break;
 	case UNQUOTED_TITLE:
-		fprintf(stderr, "Quoted title string expected.");
+		append(t, "Quoted title string expected.");
 		break;
 	case DUPLICATE_TITLE:
-		fprintf(stderr, "Only one .TITLE directive is allowed.");
+		append(t, "Only one .TITLE directive is allowed.");
+		break;
+	case OPEN_SOURCE:
+		append(t, "Error! Can't read the source file.");
+		break;
+	case WRITE_OUTPUT:
+		append(t, "Error! Can't write the output file.");
+		break;
+	case OUTPUT_FORMAT:
+		append(t, "Error! Unknown output format; expected vhdl, bin, ihex, "
+			"readmemh, mif, mi, mem, coe or c.");
+		break;
+	case EXTERN:
+		append(t, ".EXTERN labels are resolved by the linker; "
+			"assemble with -c.");
+		break;
+	case OBJECT:
+		append(t, "Error! '%s' is no valid E80 object.", TOKEN);
+		break;
+	case UNDEFINED_SYMBOL:
+		append(t, "Error! '%s' is defined by none of the linked objects.",
+			TOKEN);
+		break;
+	case AMBIGUOUS_SYMBOL:
+		append(t, "Error! '%s' is defined by more than one linked object.",
+			TOKEN);
+		break;
+	case EXPRESSION:
+		if (eq(TOKEN, "")) {
+			append(t, "Expected a number or label after '%s'.", PREVIOUS);
+		} else {
+			append(t, "'%s' is not a number or label.", TOKEN);
+		}
+		break;
+	case PARENTHESIS:
+		append(t, "Right parenthesis expected after '%s'.", PREVIOUS);
+		break;
+	case DIVISION:
+		append(t, "Division by zero at '%s'.", TOKEN);
+		break;
+	case EXPRESSION_RANGE:
+		append(t, "The expression is out of range. Values must be 8-bit "
+			"(-128 to 255),\nintermediate results 32-bit, and shifts 0 to 31.");
+		break;
+	case RELOCATION:
+		append(t, "The expression can't be relocated by the linker; only "
+			"an address plus or\nminus a number, or the distance of two "
+			"addresses that are both in the code, in\nthe .DATA arrays or in "
+			"the .RESERVE buffers, can.");
+		break;
+	case CONSTANT:
+		append(t, ".LABEL values can't depend on addresses; use a code or "
+			".DATA label instead.");
+		break;
+	case TABLE:
+		append(t, "A .TABLE range is a count, or the first and last index "
+			"and an optional step,\nfollowed by a comma and the expression "
+			"of the index i; it must fit in RAM.");
+		break;
+	case RULES:
+		append(t, "Error! '%s' is no valid E80 rule database.", TOKEN);
+		break;
+	case ORIGIN:
+		append(t, ".ORG takes a constant address from 0 to %d, and .ALIGN a "
+			"constant from 1\nto 128.", RAM_SIZE);
+		break;
+	case RESERVE:
+		append(t, "A .RESERVE size is a constant number of words, from 1 to "
+			"%d.", RAM_SIZE);
+		break;
+	case LINK_OPTION:
+		append(t, "Error! --link takes the objects as they were assembled; "
+			"it can't be combined\nwith -c, -O, --rules or --batch.");
+		break;
+	case ORIGIN_BACKWARD:
+		append(t, ".ORG can't move the code back over the code before it.");
+		break;
+	case ORIGIN_OBJECT:
+		append(t, "Relocatable objects are laid out by the linker, so they "
+			"can't use '%s'.", TOKEN);
 		break;
 	default:
 		break;
 	}
-	fprintf(stderr,	"\n******************************************************\n");
-	
-	exit(errorlevel);
+	append(t, "\n******************************************************\n");
+	e->report_length = t->length - e->report;
+}
+
+void error(struct Assembler *as, enum ErrorCode errorlevel)
+{
+	diagnose(as, errorlevel);
+	if (as->In.line_number > 0 && errorlevel != MEMORY_ALLOCATION_ERROR
+		&& errorlevel != RAM_LIMIT && as->diagnostic.errors < MAX_ERRORS) {
+		longjmp(as->resync, errorlevel); // the passes set it before any line
+	}
+	longjmp(as->abort, errorlevel);
+}
+
+enum ErrorCode summarize(struct Assembler *as)
+{
+	struct Diagnostic *d = &as->diagnostic;
+	if (d->errors < 2) return d->code;
+	// insertion sort, keeping the order of the errors of the same line
+	for (int i = 1; i < d->errors; i++) {
+		struct ErrorRecord e = d->error[i];
+		int j = i;
+		for (; j > 0 && d->error[j - 1].line > e.line; j--) {
+			d->error[j] = d->error[j - 1];
+		}
+		d->error[j] = e;
+	}
+	struct Text t = {0};
+	int ok = 1;
+	for (int i = 0; ok && i < d->errors; i++) {
+		ok = appendn(&t, d->message.s + d->error[i].report,
+			d->error[i].report_length);
+	}
+	if (ok && d->errors == MAX_ERRORS) {
+		ok = append(&t, "Too many errors, the assembly was stopped.\n");
+	}
+	if (ok && append(&t, "%d errors found.\n", d->errors)) {
+		// the reports are moved in line order
+		size_t report = 0;
+		for (int i = 0; i < d->errors; i++) {
+			d->error[i].report = report;
+			report += d->error[i].report_length;
+		}
+		free(d->message.s);
+		d->message = t;
+	} else {
+		free(t.s);
+	}
+	d->code = d->error[0].code;
+	d->line = d->error[0].line;
+	return d->code;
 }
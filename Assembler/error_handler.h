@@ -19,7 +19,7 @@ enum ErrorCode {
 	SPEED,
 	NUMBER,
 	SIGNED,
-	MANY_LABELS,
+	MANY_LABELS, // unused since labels have no limit; keeps the exit codes
 	DUPLICATE_LABEL,
 	EXTRANEOUS,
 	DIRECTIVE,
@@ -35,7 +35,27 @@ enum ErrorCode {
 	OP2,
 	RAM_LIMIT,
 	UNQUOTED_TITLE,
-	DUPLICATE_TITLE
+	DUPLICATE_TITLE,
+	OPEN_SOURCE,
+	WRITE_OUTPUT,
+	OUTPUT_FORMAT,
+	EXTERN,
+	OBJECT,
+	UNDEFINED_SYMBOL,
+	AMBIGUOUS_SYMBOL,
+	EXPRESSION,
+	PARENTHESIS,
+	DIVISION,
+	EXPRESSION_RANGE,
+	RELOCATION,
+	CONSTANT,
+	TABLE,
+	RULES,
+	ORIGIN,
+	RESERVE,
+	LINK_OPTION,
+	ORIGIN_BACKWARD,
+	ORIGIN_OBJECT
 };
 
 enum NumErrorCode {
@@ -47,6 +67,20 @@ enum NumErrorCode {
 	RANGE_ERROR = -6
 };
 
-void error(enum ErrorCode errorlevel);
+struct Assembler;
+
+/* Records errorlevel and its report in the assembler's diagnostic, without
+interrupting the assembly. Only the first error of a line is recorded. */
+void diagnose(struct Assembler *as, enum ErrorCode errorlevel);
+
+/* Records the error and resumes the current pass at the next line. Errors
+that aren't line specific, memory and RAM limit errors, and the last error
+that fits in the diagnostic abort the assembly instead. */
+void error(struct Assembler *as, enum ErrorCode errorlevel);
+
+/* Sorts the recorded errors and their reports in line order, and adds their
+count to the reports if there are many. Returns the code of the first error,
+or NO_ERROR. */
+enum ErrorCode summarize(struct Assembler *as);
 
 #endif
@@ -0,0 +1,138 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// E80 instruction set table, perfect hash lookup and disassembler
+
+#include <stdio.h>
+#include <ctype.h>
+
+#include "isa.h"
+
+const struct Keyword isa[ISA_KEYWORDS] = {
+	// Type 1
+	{"HLT",    0x00, TYPE1,    1, 0},
+	{"NOP",    0x01, TYPE1,    1, 0},
+	{"RETURN", 0xF8, TYPE1,    1, 0},
+	// Type 2
+	{"LSHIFT", 0xA0, TYPE2,    1, 0},
+	{"RSHIFT", 0xD0, TYPE2,    1, 0},
+	{"PUSH",   0xE0, TYPE2,    1, 0},
+	{"POP",    0xF0, TYPE2,    1, 0},
+	// Type 3
+	{"JMP",    0x02, TYPE3,    2, 0},
+	{"JC",     0x04, TYPE3,    2, 0},
+	{"JNC",    0x05, TYPE3,    2, 0},
+	{"JZ",     0x06, TYPE3,    2, 0},
+	{"JNZ",    0x07, TYPE3,    2, 0},
+	{"JS",     0x08, TYPE3,    2, 0},
+	{"JNS",    0x09, TYPE3,    2, 0},
+	{"JV",     0x0A, TYPE3,    2, 0},
+	{"JNV",    0x0B, TYPE3,    2, 0},
+	{"CALL",   0xE8, TYPE3,    2, 0},
+	// Types 4 and 5, with opcodes matching their ALUop
+	{"MOV",    0x10, TYPE4_5,  2, 0},
+	{"ADD",    0x20, TYPE4_5,  2, 0},
+	{"SUB",    0x30, TYPE4_5,  2, 0},
+	{"AND",    0x40, TYPE4_5,  2, 0},
+	{"OR",     0x50, TYPE4_5,  2, 0},
+	{"XOR",    0x60, TYPE4_5,  2, 0},
+	{"ROR",    0x70, TYPE4_5,  2, 0},
+	{"STORE",  0x80, TYPE4_5,  2, 1},
+	{"LOAD",   0x90, TYPE4_5,  2, 1},
+	{"CMP",    0xB0, TYPE4_5,  2, 0},
+	{"BIT",    0xC0, TYPE4_5,  2, 0},
+	// Registers, R6 and R7 have aliases
+	{"R0",     0,    REGISTER_NAME, 0, 0},
+	{"R1",     1,    REGISTER_NAME, 0, 0},
+	{"R2",     2,    REGISTER_NAME, 0, 0},
+	{"R3",     3,    REGISTER_NAME, 0, 0},
+	{"R4",     4,    REGISTER_NAME, 0, 0},
+	{"R5",     5,    REGISTER_NAME, 0, 0},
+	{"R6",     6,    REGISTER_NAME, 0, 0},
+	{"FLAGS",  6,    REGISTER_NAME, 0, 0},
+	{"R7",     7,    REGISTER_NAME, 0, 0},
+	{"SP",     7,    REGISTER_NAME, 0, 0},
+};
+
+uint32_t isa_hash(const char *s, uint32_t seed)
+{
+	uint32_t h = seed;
+	for (; *s; s++) h = (h ^ (uint32_t)toupper((unsigned char)*s)) * 16777619u;
+	// mix the low bits into the high bits that select the slot
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	return h ^ (h >> 12);
+}
+
+const struct Keyword* keyword(const char *s)
+{
+	int len = 0;
+	if (!s) return NULL;
+	while (s[len]) {
+		if (++len > ISA_MAX_LENGTH) return NULL; // too long for a keyword
+	}
+	int slot = isa_slot[isa_hash(s, isa_seed) >> (32 - ISA_SLOT_BITS)];
+	if (!slot) return NULL;
+	// the hash is perfect for keywords only; confirm the match
+	const struct Keyword *k = &isa[slot - 1];
+	const char *name = k->name;
+	while (*name && *name == toupper((unsigned char)*s)) {
+		name++;
+		s++;
+	}
+	return *name || *s ? NULL : k;
+}
+
+const struct Keyword* decode(int instr1)
+{
+	instr1 &= 0xFF;
+	for (int i = 0; i < ISA_KEYWORDS; i++) {
+		const struct Keyword *k = &isa[i];
+		switch (k->format) {
+		case TYPE1:
+		case TYPE3:
+			if (instr1 == k->opcode) return k;
+			break;
+		case TYPE2:
+			if ((instr1 & 0xF8) == k->opcode) return k;
+			break;
+		case TYPE4_5:
+			// type 4 has zeroes in Instr1[2:0]
+			if ((instr1 & 0xF0) == k->opcode
+				&& (!(instr1 & 0x08) || !(instr1 & 0x07))) return k;
+			break;
+		}
+	}
+	return NULL;
+}
+
+int disassemble(char *dest, int instr1, int instr2)
+{
+	const struct Keyword *k = decode(instr1);
+	instr1 &= 0xFF;
+	instr2 &= 0xFF;
+	if (!k) {
+		sprintf(dest, "?");
+		return 0;
+	}
+	switch (k->format) {
+	case TYPE1:
+		sprintf(dest, "%s", k->name);
+		break;
+	case TYPE2:
+		sprintf(dest, "%s R%d", k->name, instr1 & 7);
+		break;
+	case TYPE3:
+		sprintf(dest, "%s %d", k->name, instr2);
+		break;
+	default:
+		if (instr1 & 0x08) {
+			// type 4, registers in Instr2[6:4] and Instr2[2:0]
+			sprintf(dest, k->bracketed ? "%s R%d, [R%d]" : "%s R%d, R%d",
+				k->name, (instr2 >> 4) & 7, instr2 & 7);
+		} else {
+			sprintf(dest, k->bracketed ? "%s R%d, [%d]" : "%s R%d, %d",
+				k->name, instr1 & 7, instr2);
+		}
+		break;
+	}
+	return k->size;
+}
@@ -0,0 +1,68 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// E80 instruction set table headers
+
+#ifndef ISA_H
+#define ISA_H
+
+#include <stdint.h>
+
+#define ISA_KEYWORDS 38 // instructions and register names in the table
+#define ISA_MAX_LENGTH 6 // longest keyword (RETURN, LSHIFT, RSHIFT)
+#define ISA_SLOT_BITS 7 // the perfect hash maps keywords to 128 slots
+
+/* Operand formats, as the instruction types in CPU.vhd */
+enum Format {
+	TYPE1, // <instr_noarg>, opcode in Instr1
+	TYPE2, // <instr_reg> <reg>, opcode in Instr1[7:3], reg in Instr1[2:0]
+	TYPE3, // <instr_n> <value>, opcode in Instr1, direct address in Instr2
+	TYPE4_5, // <instr_reg_op2> <reg>, <op2>, opcode in Instr1[7:4];
+	         // type 4 if op2 is a register, type 5 if it's a value
+	REGISTER_NAME // not an instruction; the opcode is the register address
+};
+
+/* Opcodes of the ISA table, with zeroes in their operand bits. */
+enum Opcode {
+	HLT_OP = 0x00, NOP_OP = 0x01, JMP_OP = 0x02, JC_OP = 0x04, JNC_OP = 0x05,
+	JZ_OP = 0x06, JNZ_OP = 0x07, JS_OP = 0x08, JNS_OP = 0x09, JV_OP = 0x0A,
+	JNV_OP = 0x0B, MOV_OP = 0x10, ADD_OP = 0x20, SUB_OP = 0x30, AND_OP = 0x40,
+	OR_OP = 0x50, XOR_OP = 0x60, ROR_OP = 0x70, STORE_OP = 0x80, LOAD_OP = 0x90,
+	LSHIFT_OP = 0xA0, CMP_OP = 0xB0, BIT_OP = 0xC0, RSHIFT_OP = 0xD0,
+	PUSH_OP = 0xE0, CALL_OP = 0xE8, POP_OP = 0xF0, RETURN_OP = 0xF8
+};
+
+/* Entry of the ISA table. */
+struct Keyword {
+	const char *name; // uppercase mnemonic or register name
+	unsigned char opcode; // Instr1 with zeroes in the operand bits
+	unsigned char format; // enum Format
+	unsigned char size; // words, 0 for registers
+	unsigned char bracketed; // op2 is an address in brackets (LOAD, STORE)
+};
+
+/* The ISA table; the single source of mnemonics, register names and their
+encodings for the parser, the sizing pass and the disassembler. */
+extern const struct Keyword isa[ISA_KEYWORDS];
+
+/* Perfect hash parameters, generated by isagen.c into isa_hash.c. Slots hold
+the ISA table index of a keyword plus 1, or 0 if they are empty. */
+extern const uint32_t isa_seed;
+extern const unsigned char isa_slot[1 << ISA_SLOT_BITS];
+
+/* Case-insensitive FNV-1a hash of s, starting from seed, with a final mix. */
+uint32_t isa_hash(const char *s, uint32_t seed);
+
+/* Returns the ISA table entry of s, case-insensitively, or NULL if s is not
+a mnemonic or a register name, including when s is NULL. Runs in O(1)
+without copying s. */
+const struct Keyword* keyword(const char *s);
+
+/* Returns the ISA table entry of the instruction whose first word is instr1,
+or NULL if instr1 is not a valid opcode. */
+const struct Keyword* decode(int instr1);
+
+/* Writes the assembly of the instruction in the words instr1 and instr2 at
+dest, which must hold at least 16 characters. Returns the instruction size,
+or 0 if instr1 is not a valid opcode, in which case dest is set to "?". */
+int disassemble(char *dest, int instr1, int instr2);
+
+#endif
@@ -0,0 +1,17 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Perfect hash of the ISA table; generated by isagen.c, don't edit
+
+#include "isa.h"
+
+const uint32_t isa_seed = 0x811C9E9Du;
+
+const unsigned char isa_slot[1 << ISA_SLOT_BITS] = {
+	 0,  0,  0,  0, 17,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0, 35,  0, 11,  0,  0, 27,  0,  0,  0,  0, 30,  0,  0,  1,
+	 0,  0, 26,  0, 10,  0, 21,  0, 28,  0,  0,  0,  2,  0,  0,  0,
+	 0, 24,  0, 34,  0,  4,  0, 22, 32,  0,  9,  0,  0,  0,  0, 38,
+	12,  0,  6,  0,  0,  0, 19,  0, 20,  0, 37,  0,  0,  0, 18,  0,
+	 0, 36,  0,  0,  0,  0, 33,  0,  0,  0,  0,  0,  0,  0,  0, 25,
+	23,  0, 14,  0,  0,  0,  0,  0,  7,  0,  3,  0, 13,  0,  0,  5,
+	 0, 15,  0,  0,  0, 31,  0,  0, 29,  0,  0,  0,  0, 16,  8,  0,
+};
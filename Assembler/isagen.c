@@ -0,0 +1,42 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Perfect hash generator for the ISA table; not part of E80ASM itself.
+// Regenerate isa_hash.c after changing the table in isa.c with:
+//     gcc -std=c99 -o isagen isagen.c isa.c isa_hash.c
+//     isagen > isa_hash.c
+
+#include <stdio.h>
+#include <string.h>
+
+#include "isa.h"
+
+#define SLOTS (1 << ISA_SLOT_BITS)
+
+/* Fills slots with the table indexes plus 1, hashed with seed. Returns 0 if
+two keywords collide. */
+int place(uint32_t seed, unsigned char *slots)
+{
+	memset(slots, 0, SLOTS);
+	for (int i = 0; i < ISA_KEYWORDS; i++) {
+		uint32_t slot = isa_hash(isa[i].name, seed) >> (32 - ISA_SLOT_BITS);
+		if (slots[slot]) return 0;
+		slots[slot] = (unsigned char)(i + 1);
+	}
+	return 1;
+}
+
+int main(void)
+{
+	unsigned char slots[SLOTS];
+	uint32_t seed = 2166136261u; // FNV-1a offset basis
+	while (!place(seed, slots)) seed++;
+	printf("// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>\n");
+	printf("// Perfect hash of the ISA table; generated by isagen.c, don't edit\n\n");
+	printf("#include \"isa.h\"\n\n");
+	printf("const uint32_t isa_seed = 0x%08lXu;\n\n", (unsigned long) seed);
+	printf("const unsigned char isa_slot[1 << ISA_SLOT_BITS] = {");
+	for (int i = 0; i < SLOTS; i++) {
+		printf(i % 16 ? " %2d," : "\n\t%2d,", slots[i]);
+	}
+	printf("\n};\n");
+	return 0;
+}
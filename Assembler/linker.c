@@ -0,0 +1,333 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Relocatable objects and linker; writes an assembly as an object, and lays
+// out the objects that a program needs into a single RAM image
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "linker.h"
+#include "assembler.h"
+#include "error_handler.h"
+#include "parse_functions.h"
+#include "isa.h"
+
+#define OBJECT_SIGNATURE "E80 OBJECT"
+#define MAX_RECORD_LENGTH 1024 // characters of an object record
+
+/* An object read for linking. Names are kept back to back in 'names'. */
+struct Module {
+	uint8_t mem[RAM_SIZE];
+	unsigned char type[RAM_SIZE]; // enum WordType
+	char comment[RAM_SIZE][MAX_COMMENT_LENGTH];
+	int reloc[RAM_SIZE]; // 0 for none, -1 or -2 for an address of the code
+	// or the data of this object, or extern plus 1
+	int words; // words of the image
+	int code; // words before the first .DATA word
+	int reserved; // words of the .RESERVE buffers that follow the image
+	struct Text names;
+	size_t external[RAM_SIZE]; // names of the .EXTERN labels
+	int target[RAM_SIZE]; // object and symbol of each one, as object << 8
+	// | symbol, once they are resolved
+	int externals; // number of .EXTERN labels
+	size_t symbol[RAM_SIZE]; // names of the code and .DATA labels
+	int value[RAM_SIZE]; // their addresses in the object
+	int section[RAM_SIZE]; // their relocation, -1 for code or -2 for data
+	int symbols; // number of labels
+	int title; // offset of the .TITLE in 'names', or -1
+	int speed;
+	int simdip;
+	int monitor;
+	int monitor_reloc;
+	char linked; // the object is part of the program
+	int base; // address of its code in the linked image
+	int data; // address of its .DATA words in the linked image
+};
+
+/* Returns the relocation record of the value of a word or a directive with
+the given enum Relocation, section and label, as in WordInfo. */
+const char* relocation(const struct Assembler *as, int reloc, int section,
+	int label)
+{
+	if (reloc == ADDRESS_VALUE) {
+		return section == CODE_LABEL ? "+C" : section == DATA_LABEL ? "+D"
+			: "+R";
+	}
+	if (reloc != EXTERN_VALUE) return "-";
+	const struct LabelElement *l = &as->Out.label[label - 1];
+	return as->In.text.s + as->In.symbols.symbol[l->symbol].name;
+}
+
+int format_object(const struct Assembler *as, struct Text *t)
+{
+	const struct OutputHeader *Out = &as->Out;
+	int words = RAM_SIZE;
+	int reserved = 0;
+	while (words && Out->word[words - 1].type == UNUSED_WORD) words--;
+	for (int i = 0; i < Out->labels; i++) {
+		const struct LabelElement *l = &Out->label[i];
+		if (l->kind == RESERVED_LABEL && l->val + l->size - words > reserved) {
+			reserved = l->val + l->size - words;
+		}
+	}
+	if (!append(t, OBJECT_SIGNATURE "\n")) return 0;
+	if (Out->title.length && !append(t, "TITLE %s\n", Out->title.s)) return 0;
+	if (!append(t, "SPEED %d\nSIMDIP %d\nMONITOR %d %s\n", Out->speed,
+		Out->simdip, Out->monitor, relocation(as,
+		Out->monitor_relocation, Out->monitor_section, Out->monitor_label))) {
+		return 0;
+	}
+	for (int i = 0; i < Out->labels; i++) {
+		const struct LabelElement *l = &Out->label[i];
+		if (l->kind != CODE_LABEL && l->kind != DATA_LABEL
+			&& l->kind != RESERVED_LABEL) continue;
+		if (!append(t, "SYMBOL %s %d %s\n",
+			as->In.text.s + as->In.symbols.symbol[l->symbol].name, l->val,
+			relocation(as, ADDRESS_VALUE, l->kind, 0))) {
+			return 0;
+		}
+	}
+	if (reserved && !append(t, "RESERVE %d\n", reserved)) return 0;
+	for (int addr = 0; addr < words; addr++) {
+		const struct WordInfo *w = &Out->word[addr];
+		char text[MAX_COMMENT_LENGTH];
+		const char *comment = listing_comment(as, addr, text);
+		if (!append(t, "WORD %c %02X %s%s%s\n", "-IOD"[w->type], Out->mem[addr],
+			relocation(as, w->relocation, w->section, w->label),
+			*comment ? " " : "",
+			comment)) return 0;
+	}
+	return 1;
+}
+
+/* Adds a name to the names of m, and returns its offset, or -1 if memory
+can't be allocated. */
+long addname(struct Module *m, const char *name)
+{
+	size_t offset = m->names.length;
+	if (!append(&m->names, "%s", name) || !appendn(&m->names, "", 1)) {
+		return -1;
+	}
+	return (long)offset;
+}
+
+/* Returns the relocation of a record: 0 for '-', -1 for '+C', -2 for '+D'
+or '+R', whose .DATA words and .RESERVE buffers move together, or the index
+of the .EXTERN label plus 1, which is added if it's new. Returns -3 if memory
+can't be allocated or there are too many labels. */
+int readreloc(struct Module *m, const char *s)
+{
+	if (!strcmp(s, "-")) return 0;
+	if (!strcmp(s, "+C")) return -1;
+	if (!strcmp(s, "+D") || !strcmp(s, "+R")) return -2;
+	if (s[0] == '+') return -3; // no label starts with '+'
+	for (int i = 0; i < m->externals; i++) {
+		if (!strcmp(m->names.s + m->external[i], s)) return i + 1;
+	}
+	long name = m->externals < RAM_SIZE ? addname(m, s) : -1;
+	if (name < 0) return -3;
+	m->external[m->externals] = (size_t)name;
+	return ++m->externals;
+}
+
+/* Reads the records of an object into m. Returns 0 if it's no valid object
+or memory can't be allocated. */
+int read_object(struct Module *m, const char *object)
+{
+	char line[MAX_RECORD_LENGTH];
+	char name[MAX_RECORD_LENGTH];
+	char section[3];
+	char type;
+	int n, rest;
+	unsigned v;
+	m->title = -1;
+	m->speed = DEFAULT_SPEED;
+	m->simdip = DEFAULT_SIMDIP;
+	m->monitor = DEFAULT_MONITOR;
+	if (!sgets(line, sizeof(line), &object)
+		|| strcmp(line, OBJECT_SIGNATURE "\n")) return 0;
+	while (sgets(line, sizeof(line), &object)) {
+		size_t length = strcspn(line, "\r\n");
+		if (!line[length] && *object) return 0; // a record too long
+		line[length] = '\0';
+		if (!strncmp(line, "TITLE ", 6)) {
+			long title = addname(m, line + 6);
+			if (title < 0) return 0;
+			m->title = (int)title;
+		} else if (sscanf(line, "SPEED %d", &n) == 1) {
+			if (n < MIN_SPEED || n > MAX_SPEED) return 0;
+			m->speed = n;
+		} else if (sscanf(line, "SIMDIP %d", &n) == 1) {
+			if (n < 0 || n > 255) return 0;
+			m->simdip = n;
+		} else if (sscanf(line, "MONITOR %d %s", &n, name) == 2) {
+			if (n < 0 || n > 255) return 0;
+			m->monitor = n;
+			m->monitor_reloc = readreloc(m, name);
+			if (m->monitor_reloc < -2) return 0;
+		} else if (sscanf(line, "SYMBOL %s %d %2s", name, &n, section) == 3) {
+			long symbol = m->symbols < RAM_SIZE ? addname(m, name) : -1;
+			int reloc = readreloc(m, section);
+			if (symbol < 0 || n < 0 || n > 255 || reloc >= 0 || reloc < -2) {
+				return 0;
+			}
+			m->symbol[m->symbols] = (size_t)symbol;
+			m->section[m->symbols] = reloc;
+			m->value[m->symbols++] = n;
+		} else if (sscanf(line, "RESERVE %d", &n) == 1) {
+			if (n < 1 || n > RAM_SIZE) return 0;
+			m->reserved = n;
+		} else if (sscanf(line, "WORD %c %x %s %n", &type, &v, name, &rest) == 3) {
+			const char *kind = strchr("-IOD", type);
+			if (!kind || !type || v > 255 || m->words == RAM_SIZE) {
+				return 0;
+			}
+			m->mem[m->words] = (uint8_t)v;
+			m->type[m->words] = (unsigned char)(kind - "-IOD");
+			m->reloc[m->words] = readreloc(m, name);
+			if (m->reloc[m->words] < -2) return 0;
+			snprintf(m->comment[m->words], MAX_COMMENT_LENGTH, "%s", line + rest);
+			if (m->type[m->words] != DATA_WORD) m->code = m->words + 1;
+			m->words++;
+		} else if (line[0]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Reports an error about a name, such as a label or a file, and returns its
+code. */
+enum ErrorCode link_error(struct Assembler *as, enum ErrorCode code,
+	const char *name)
+{
+	as->In.token = name; // reported as the offending token
+	diagnose(as, code);
+	return code;
+}
+
+/* Finds the objects that define the .EXTERN labels of the linked objects,
+and links them too. Returns NO_ERROR, or the code of the reported error. */
+enum ErrorCode resolve(struct Assembler *as, struct Module *m, int count)
+{
+	char changed = 1;
+	while (changed) {
+		changed = 0;
+		for (int i = 0; i < count; i++) {
+			for (int e = 0; m[i].linked && e < m[i].externals; e++) {
+				const char *name = m[i].names.s + m[i].external[e];
+				int found = 0;
+				for (int j = 0; j < count; j++) {
+					for (int s = 0; s < m[j].symbols; s++) {
+						if (strcmp(m[j].names.s + m[j].symbol[s], name)) continue;
+						// the target is placed once the objects are laid out
+						m[i].target[e] = j << 8 | s;
+						found++;
+					}
+				}
+				if (!found) return link_error(as, UNDEFINED_SYMBOL, name);
+				if (found > 1) return link_error(as, AMBIGUOUS_SYMBOL, name);
+				int j = m[i].target[e] >> 8;
+				if (!m[j].linked) m[j].linked = changed = 1;
+			}
+		}
+	}
+	return NO_ERROR;
+}
+
+/* Returns the linked address of the address n of object m, in its code if
+reloc is -1, or else in its data, even if n is past either of them. */
+int place(const struct Module *m, int n, int reloc)
+{
+	return reloc == -1 ? m->base + n : m->data + n - m->code;
+}
+
+/* Returns the linked value of a value of object i with the given
+relocation; the value of a .EXTERN label is added to its address. */
+int relocate_value(const struct Module *m, int i, int reloc, int n)
+{
+	if (!reloc) return n;
+	if (reloc < 0) return place(&m[i], n, reloc) & 0xFF;
+	const struct Module *target = &m[m[i].target[reloc - 1] >> 8];
+	int s = m[i].target[reloc - 1] & 0xFF;
+	return (place(target, target->value[s], target->section[s]) + n) & 0xFF;
+}
+
+/* Adds a region of the linked image to as->Out, unless it's empty. */
+void addregion(struct OutputHeader *Out, unsigned char kind, int addr,
+	int size)
+{
+	struct Region r = {kind, addr, addr, size, -1, 0};
+	if (size > 0) Out->region[Out->regions++] = r;
+}
+
+/* Writes the words of the linked objects to as->Out, and their code, .DATA
+words and .RESERVE buffers as regions, since the image has no labels that
+would mark them. */
+void write_image(struct Assembler *as, const struct Module *m, int count)
+{
+	struct OutputHeader *Out = &as->Out;
+	for (int i = 0; i < count; i++) {
+		if (!m[i].linked) continue;
+		addregion(Out, CODE_REGION, m[i].base, m[i].code);
+		addregion(Out, DATA_REGION, m[i].data, m[i].words - m[i].code);
+		addregion(Out, RESERVED_REGION, m[i].data + m[i].words - m[i].code,
+			m[i].reserved);
+	}
+	for (int i = 0; i < count; i++) {
+		for (int addr = 0; m[i].linked && addr < m[i].words; addr++) {
+			int dest = place(&m[i], addr, addr < m[i].code ? -1 : -2);
+			int n = relocate_value(m, i, m[i].reloc[addr], m[i].mem[addr]);
+			Out->mem[dest] = (uint8_t)n;
+			Out->word[dest].type = m[i].type[addr];
+			strcpy(Out->comment[dest], m[i].comment[addr]);
+			const struct Keyword *k = addr ? decode(m[i].mem[addr - 1]) : NULL;
+			if (m[i].reloc[addr] && m[i].type[addr] == OPERAND_WORD && k) {
+				renumber(Out->comment[dest], n, k->bracketed);
+			}
+		}
+	}
+	Out->speed = m[0].speed;
+	Out->simdip = (uint8_t)m[0].simdip;
+	Out->monitor = relocate_value(m, 0, m[0].monitor_reloc, m[0].monitor);
+}
+
+enum ErrorCode link_objects(struct Assembler *as, char *const *objects,
+	char *const *names, int count)
+{
+	struct Module *m = calloc(count, sizeof(*m));
+	enum ErrorCode result = NO_ERROR;
+	int addr = 0;
+	reset_assembler(as);
+	if (!m) return link_error(as, MEMORY_ALLOCATION_ERROR, "");
+	for (int i = 0; i < count && result == NO_ERROR; i++) {
+		if (!read_object(&m[i], objects[i])) {
+			result = link_error(as, OBJECT, names[i]);
+		}
+	}
+	m[0].linked = 1;
+	if (result == NO_ERROR) result = resolve(as, m, count);
+	// the code of the linked objects, followed by all of their data and
+	// .RESERVE buffers
+	for (int i = 0; i < count; i++) {
+		m[i].base = addr;
+		if (m[i].linked) addr += m[i].code;
+	}
+	for (int i = 0; i < count; i++) {
+		m[i].data = addr;
+		if (m[i].linked) addr += m[i].words - m[i].code + m[i].reserved;
+	}
+	if (result == NO_ERROR && addr > RAM_SIZE) {
+		result = link_error(as, RAM_LIMIT, "");
+	}
+	if (result == NO_ERROR) {
+		write_image(as, m, count);
+		if (m[0].title >= 0 && !append(&as->Out.title, "%s",
+			m[0].names.s + m[0].title)) {
+			result = link_error(as, MEMORY_ALLOCATION_ERROR, "");
+		}
+	}
+	for (int i = 0; i < count; i++) free(m[i].names.s);
+	free(m);
+	return result;
+}
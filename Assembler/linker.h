@@ -0,0 +1,40 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Relocatable objects and linker headers
+
+#ifndef LINKER_H
+#define LINKER_H
+
+#include "data_structures.h"
+
+/* Appends the relocatable object of an assembly made with as->object set
+to t. The object is a text of records, one per line:
+  E80 OBJECT              the signature, on the first line
+  TITLE text              the .TITLE, if any
+  SPEED n                 the .SPEED level
+  SIMDIP n                the .SIMDIP value
+  MONITOR n reloc         the .MONITOR address
+  SYMBOL name n reloc     the address of a code, .DATA or .RESERVE label
+  RESERVE n               the words of .RESERVE buffers after the last word
+  WORD type hex reloc ... a RAM word from address 0 up, and its comment
+The word type is I (instruction), O (operand) or D (.DATA). Values that hold
+the address of a label of the object are relocated by the linker with the
+section of the label, marked by reloc '+C' for the code, '+D' for the .DATA
+arrays or '+R' for the .RESERVE buffers, even if the value is past the
+section, as in arr-1; values that hold a .EXTERN label plus a number are
+resolved from the SYMBOL records of the other objects and added to the
+number, marked by the name of the label; constants and numbers are marked by
+'-' and kept as they are. Returns 0 if memory can't be allocated. */
+int format_object(const struct Assembler *as, struct Text *t);
+
+/* Links the texts of count objects, named by their files, into the RAM
+image of as->Out: the first object, which holds the program's start and
+directives, and the objects that define the .EXTERN labels of the linked
+ones, transitively; objects that nothing refers to are left out. The code of
+the linked objects is laid out from address 0 in their order, followed by
+their .DATA words and .RESERVE buffers, and their operands and comments are
+relocated. Returns NO_ERROR, or the code of the error, which is reported in
+as->diagnostic. */
+enum ErrorCode link_objects(struct Assembler *as, char *const *objects,
+	char *const *names, int count);
+
+#endif
@@ -0,0 +1,746 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Language server; publishes diagnostics and answers hovers and label queries
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "lsp.h"
+#include "assembler.h"
+#include "isa.h"
+#include "parse_functions.h"
+
+/* An open document, with its resident assembly. */
+struct Document {
+	char *uri; // JSON-escaped, as sent by the client
+	struct Text text; // current source
+	struct Assembler *as; // assembly of the current source
+};
+
+/* State of the language server. */
+struct Server {
+	FILE *out;
+	struct Document *doc;
+	int docs; // number of open documents
+	int size; // allocated documents
+	struct Text body; // message being composed
+	struct Text string; // scratchpad for decoded JSON strings
+	char failed; // the message couldn't be composed
+	char shutdown; // the client requested a shutdown
+	char utf8; // positions count UTF-8 bytes, as agreed in initialize
+};
+
+/* Skips the JSON whitespace at s. */
+const char* json_space(const char *s)
+{
+	while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r') s++;
+	return s;
+}
+
+/* Returns the end of the JSON value at s, or NULL if it's malformed. */
+const char* json_skip(const char *s)
+{
+	int depth = 0; // nested objects and arrays
+	s = json_space(s);
+	do {
+		if (*s == '"') {
+			for (s++; *s != '"'; s++) {
+				if (!*s || (*s == '\\' && !*++s)) return NULL;
+			}
+			s++;
+		} else if (*s == '{' || *s == '[') {
+			depth++;
+			s++;
+		} else if (depth && (*s == '}' || *s == ']')) {
+			depth--;
+			s++;
+		} else if (depth && (*s == ',' || *s == ':')) {
+			s++;
+		} else if (depth && json_space(s) != s) {
+			s = json_space(s);
+		} else if (*s && !strchr(",:{}[]\"", *s)) {
+			// number, true, false or null
+			while (*s && !strchr(",:{}[]\" \t\r\n", *s)) s++;
+		} else {
+			return NULL;
+		}
+	} while (depth);
+	return s;
+}
+
+/* Returns the value of member 'key' of the JSON object at s, or NULL if it
+has no such member. */
+const char* json_member(const char *s, const char *key)
+{
+	size_t n = strlen(key);
+	if (!s || *(s = json_space(s)) != '{') return NULL;
+	for (s = json_space(s + 1); *s == '"'; s = json_space(s + 1)) {
+		const char *name = s + 1;
+		const char *value = json_skip(s);
+		if (!value) return NULL;
+		size_t length = (size_t)(value - 1 - name); // without the quotes
+		value = json_space(value);
+		if (*value != ':') return NULL;
+		value = json_space(value + 1);
+		if (length == n && !strncmp(name, key, n)) return value;
+		s = json_skip(value);
+		if (!s || *(s = json_space(s)) != ',') return NULL;
+	}
+	return NULL;
+}
+
+/* Returns the value at the dot-separated path of members, starting from the
+JSON object at s, or NULL if it's missing. */
+const char* json_get(const char *s, const char *path)
+{
+	char key[32];
+	while (s && *path) {
+		size_t n = strcspn(path, ".");
+		if (n >= sizeof(key)) return NULL;
+		memcpy(key, path, n);
+		key[n] = '\0';
+		s = json_member(s, key);
+		path += n;
+		if (*path) path++; // skip the dot
+	}
+	return s;
+}
+
+/* Returns the JSON integer at s, or fallback if s is NULL or no number. */
+int json_int(const char *s, int fallback)
+{
+	if (!s) return fallback;
+	char *end;
+	s = json_space(s);
+	long n = strtol(s, &end, 10);
+	return end == s ? fallback : (int)n;
+}
+
+/* Returns the first element of the JSON array at s, or NULL if it's empty. */
+const char* json_first(const char *s)
+{
+	if (!s || *(s = json_space(s)) != '[') return NULL;
+	s = json_space(s + 1);
+	return *s == ']' ? NULL : s;
+}
+
+/* Returns the element after the JSON array element at s, or NULL. */
+const char* json_next(const char *s)
+{
+	s = json_skip(s);
+	if (!s || *(s = json_space(s)) != ',') return NULL;
+	return json_space(s + 1);
+}
+
+/* Returns the code point of the 4 hex digits at s, or -1. */
+long json_hex(const char *s)
+{
+	long u = 0;
+	for (int i = 0; i < 4; i++) {
+		int d = hexdigit(s[i]); // stops at the terminator too
+		if (d < 0) return -1;
+		u = 16 * u + d;
+	}
+	return u;
+}
+
+/* Appends the code point u to t in UTF-8. */
+int utf8(struct Text *t, long u)
+{
+	char b[4];
+	int n;
+	if (u < 0x80) {
+		b[0] = (char)u;
+		n = 1;
+	} else if (u < 0x800) {
+		b[0] = (char)(0xC0 | u >> 6);
+		b[1] = (char)(0x80 | (u & 0x3F));
+		n = 2;
+	} else if (u < 0x10000) {
+		b[0] = (char)(0xE0 | u >> 12);
+		b[1] = (char)(0x80 | (u >> 6 & 0x3F));
+		b[2] = (char)(0x80 | (u & 0x3F));
+		n = 3;
+	} else {
+		b[0] = (char)(0xF0 | u >> 18);
+		b[1] = (char)(0x80 | (u >> 12 & 0x3F));
+		b[2] = (char)(0x80 | (u >> 6 & 0x3F));
+		b[3] = (char)(0x80 | (u & 0x3F));
+		n = 4;
+	}
+	return appendn(t, b, n);
+}
+
+/* Decodes the JSON string at s to UTF-8 text in t, replacing its contents.
+Returns 0 if s is no string or memory can't be allocated. */
+int json_string(const char *s, struct Text *t)
+{
+	t->length = 0;
+	if (!s || *(s = json_space(s)) != '"' || !append(t, "")) return 0;
+	for (s++; *s != '"'; s++) {
+		if (!*s) return 0;
+		if (*s != '\\') {
+			if (!appendn(t, s, 1)) return 0;
+			continue;
+		}
+		long u = *++s; // escaped character
+		switch (*s) {
+		case 'b': u = '\b'; break;
+		case 'f': u = '\f'; break;
+		case 'n': u = '\n'; break;
+		case 'r': u = '\r'; break;
+		case 't': u = '\t'; break;
+		case 'u':
+			if ((u = json_hex(s + 1)) < 0) return 0;
+			s += 4;
+			// combine a surrogate pair of UTF-16
+			if (u >= 0xD800 && u < 0xDC00 && s[1] == '\\' && s[2] == 'u') {
+				long low = json_hex(s + 3);
+				if (low >= 0xDC00 && low < 0xE000) {
+					u = 0x10000 + ((u - 0xD800) << 10) + (low - 0xDC00);
+					s += 6;
+				}
+			}
+			break;
+		case '\0':
+			return 0;
+		}
+		if (!utf8(t, u)) return 0;
+	}
+	return 1;
+}
+
+/* Appends printf-formatted text to the message being composed. */
+void compose(struct Server *srv, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	if (!vappend(&srv->body, format, args)) srv->failed = 1;
+	va_end(args);
+}
+
+/* Appends the n characters at s to the message as a JSON string. */
+void quote(struct Server *srv, const char *s, size_t n)
+{
+	struct Text *t = &srv->body;
+	int ok = appendn(t, "\"", 1);
+	for (size_t i = 0; ok && i < n; i++) {
+		unsigned char c = (unsigned char)s[i];
+		if (c == '"' || c == '\\') {
+			ok = append(t, "\\%c", c);
+		} else if (c == '\n') {
+			ok = appendn(t, "\\n", 2);
+		} else if (c < 0x20) {
+			ok = append(t, "\\u%04X", c);
+		} else {
+			ok = appendn(t, s + i, 1);
+		}
+	}
+	if (!ok || !appendn(t, "\"", 1)) srv->failed = 1;
+}
+
+/* Writes the composed message to the client, framed by its header. A message
+that couldn't be composed is dropped. */
+void transmit(struct Server *srv)
+{
+	if (!srv->failed && srv->body.length) {
+		fprintf(srv->out, "Content-Length: %lu\r\n\r\n",
+			(unsigned long)srv->body.length);
+		fwrite(srv->body.s, 1, srv->body.length, srv->out);
+		fflush(srv->out);
+	}
+	srv->body.length = 0;
+	srv->failed = 0;
+}
+
+/* Reads the next message from in into a null-terminated string that must be
+freed by the caller. Returns NULL at the end of the input, or if the message
+is malformed or can't be stored. */
+char* receive(FILE *in)
+{
+	char header[256];
+	long length = -1;
+	while (fgets(header, sizeof(header), in)) {
+		if (!strcmp(header, "\r\n") || !strcmp(header, "\n")) {
+			// the body follows the empty line after the headers
+			char *s = length >= 0 ? malloc(length + 1) : NULL;
+			if (!s || fread(s, 1, length, in) != (size_t)length) {
+				free(s);
+				return NULL;
+			}
+			s[length] = '\0';
+			return s;
+		}
+		if (!strncmp(header, "Content-Length:", 15)) {
+			length = strtol(header + 15, NULL, 10);
+		}
+	}
+	return NULL;
+}
+
+/* Returns the UTF-16 code units of the n bytes of UTF-8 at s, which is how
+LSP positions count characters, unless the client agreed to count the bytes
+themselves (utf8). */
+int units(const char *s, int n, char utf8)
+{
+	int u = 0;
+	if (utf8) return n;
+	for (int i = 0; i < n; i++) {
+		unsigned char c = (unsigned char)s[i];
+		if ((c & 0xC0) != 0x80) u += c >= 0xF0 ? 2 : 1; // surrogate pairs
+	}
+	return u;
+}
+
+/* Returns the bytes of UTF-8 at s that span u UTF-16 code units, or u
+bytes if utf8 is set, up to the end of its line. */
+int bytes(const char *s, int u, char utf8)
+{
+	int n = 0;
+	while (u > 0 && s[n] && s[n] != '\n') {
+		int start = n;
+		for (n++; ((unsigned char)s[n] & 0xC0) == 0x80; n++);
+		u -= utf8 ? n - start : (unsigned char)s[start] >= 0xF0 ? 2 : 1;
+	}
+	return n;
+}
+
+/* Returns the offset of the start of the given line in t, or the end of t
+if it has fewer lines. */
+size_t linestart(const struct Text *t, int line)
+{
+	size_t i = 0;
+	for (; line > 0 && i < t->length; i++) {
+		if (t->s[i] == '\n') line--;
+	}
+	return line > 0 ? t->length : i;
+}
+
+/* Returns the raw source line of the assembled line at index i. */
+const char* rawline(const struct Document *doc, int i)
+{
+	const struct Line *line = &doc->as->In.lines[i];
+	return doc->text.s + line->offset - line->column;
+}
+
+/* Appends a JSON range of the given line and byte columns of raw, which is
+the start of that line. */
+void range(struct Server *srv, int line, const char *raw, int column,
+	int length)
+{
+	int start = units(raw, column, srv->utf8);
+	int end = start + units(raw + column, length, srv->utf8);
+	compose(srv, "{\"start\":{\"line\":%d,\"character\":%d},"
+		"\"end\":{\"line\":%d,\"character\":%d}}", line, start, line, end);
+}
+
+/* Appends a JSON location of token t of the document. */
+void location(struct Server *srv, const struct Document *doc,
+	const struct Token *t)
+{
+	compose(srv, "{\"uri\":\"%s\",\"range\":", doc->uri);
+	range(srv, t->line - 1, rawline(doc, t->line - 1), t->column, t->length);
+	compose(srv, "}");
+}
+
+/* Appends the diagnostics of the document to the message, one per error. */
+void diagnostics(struct Server *srv, const struct Document *doc)
+{
+	const struct Diagnostic *d = &doc->as->diagnostic;
+	for (int i = 0; i < d->errors; i++) {
+		const struct ErrorRecord *e = &d->error[i];
+		compose(srv, i ? ",{\"range\":" : "{\"range\":");
+		if (e->line) {
+			range(srv, e->line - 1, rawline(doc, e->line - 1), e->column,
+				e->length);
+		} else {
+			compose(srv, "{\"start\":{\"line\":0,\"character\":0},"
+				"\"end\":{\"line\":0,\"character\":0}}");
+		}
+		compose(srv, ",\"severity\":1,\"code\":%d,\"source\":\"e80asm\","
+			"\"message\":", e->code);
+		// the report without its banners and the offending line
+		struct Text *t = &srv->string;
+		t->length = 0;
+		if (!append(t, "")) srv->failed = 1;
+		const char *s = d->message.s + e->report;
+		const char *end = s + e->report_length;
+		while (s < end) {
+			size_t n = strcspn(s, "\n");
+			if (n && *s != '*' && strncmp(s, "Error in line ", 14)) {
+				if (t->length && !appendn(t, "\n", 1)) srv->failed = 1;
+				if (!appendn(t, s, n)) srv->failed = 1;
+			}
+			s += n + 1; // reports end with a newline
+		}
+		quote(srv, t->s, t->length);
+		compose(srv, "}");
+	}
+}
+
+/* Publishes the diagnostics of the document, or none if it's closed. */
+void publish(struct Server *srv, const struct Document *doc, char closed)
+{
+	compose(srv, "{\"jsonrpc\":\"2.0\","
+		"\"method\":\"textDocument/publishDiagnostics\","
+		"\"params\":{\"uri\":\"%s\",\"diagnostics\":[", doc->uri);
+	if (!closed) diagnostics(srv, doc);
+	compose(srv, "]}}");
+	transmit(srv);
+}
+
+/* Returns the open document of the request parameters, or NULL. */
+struct Document* document(struct Server *srv, const char *params)
+{
+	const char *uri = json_get(params, "textDocument.uri");
+	const char *end = uri ? json_skip(uri) : NULL;
+	if (!end || *uri != '"') return NULL;
+	size_t n = (size_t)(end - uri - 2); // without the quotes
+	for (int i = 0; i < srv->docs; i++) {
+		struct Document *doc = &srv->doc[i];
+		if (strlen(doc->uri) == n && !strncmp(doc->uri, uri + 1, n)) return doc;
+	}
+	return NULL;
+}
+
+/* Opens the document of the request parameters, replacing it if it's already
+open, and assembles it. Returns NULL if memory can't be allocated. */
+struct Document* open_document(struct Server *srv, const char *params)
+{
+	struct Document *doc = document(srv, params);
+	if (!doc) {
+		const char *uri = json_get(params, "textDocument.uri");
+		const char *end = uri ? json_skip(uri) : NULL;
+		if (!end || *uri != '"') return NULL;
+		if (srv->docs == srv->size) {
+			int size = srv->size ? 2 * srv->size : 8;
+			struct Document *grown = realloc(srv->doc, size * sizeof(*grown));
+			if (!grown) return NULL;
+			srv->doc = grown;
+			srv->size = size;
+		}
+		doc = &srv->doc[srv->docs];
+		memset(doc, 0, sizeof(*doc));
+		size_t n = (size_t)(end - uri - 2); // without the quotes
+		doc->uri = malloc(n + 1);
+		doc->as = new_assembler();
+		if (!doc->uri || !doc->as) {
+			free(doc->uri);
+			free_assembler(doc->as);
+			return NULL;
+		}
+		memcpy(doc->uri, uri + 1, n);
+		doc->uri[n] = '\0';
+		srv->docs++;
+	}
+	if (!json_string(json_get(params, "textDocument.text"), &doc->text)) {
+		doc->text.length = 0;
+		if (!append(&doc->text, "")) return NULL;
+	}
+	assemble(doc->as, doc->text.s, NULL);
+	return doc;
+}
+
+/* Frees the document, and removes it from the open ones. */
+void free_document(struct Server *srv, struct Document *doc)
+{
+	free(doc->uri);
+	free(doc->text.s);
+	free_assembler(doc->as);
+	*doc = srv->doc[--srv->docs]; // the order of the documents is irrelevant
+}
+
+/* Closes the document, and publishes no diagnostics for it. */
+void close_document(struct Server *srv, struct Document *doc)
+{
+	publish(srv, doc, 1);
+	free_document(srv, doc);
+}
+
+/* Replaces the characters [a, b) of t with the n characters at s. Returns 0
+if memory can't be allocated, in which case t is left unchanged. */
+int splice(struct Text *t, size_t a, size_t b, const char *s, size_t n)
+{
+	struct Text edited = {0};
+	if (!appendn(&edited, t->s, a) || !appendn(&edited, s, n)
+		|| !appendn(&edited, t->s + b, t->length - b)) {
+		free(edited.s);
+		return 0;
+	}
+	free(t->s);
+	*t = edited;
+	return 1;
+}
+
+/* Applies the content changes of the request parameters to the document in
+order, and reassembles it after each one, re-lexing only the changed lines
+of ranged changes. */
+void change_document(struct Server *srv, struct Document *doc,
+	const char *params)
+{
+	const char *changes = json_get(params, "contentChanges");
+	for (const char *c = json_first(changes); c; c = json_next(c)) {
+		struct Text *s = &srv->string;
+		if (!json_string(json_member(c, "text"), s)) continue;
+		const char *r = json_member(c, "range");
+		if (!r) {
+			// the whole document was replaced
+			if (!splice(&doc->text, 0, doc->text.length, s->s, s->length)) {
+				continue;
+			}
+			assemble(doc->as, doc->text.s, NULL);
+			continue;
+		}
+		int first = json_int(json_get(r, "start.line"), 0);
+		int last = json_int(json_get(r, "end.line"), first);
+		size_t start = linestart(&doc->text, first);
+		size_t end = linestart(&doc->text, last);
+		size_t a = start + bytes(doc->text.s + start,
+			json_int(json_get(r, "start.character"), 0), srv->utf8);
+		size_t b = end + bytes(doc->text.s + end,
+			json_int(json_get(r, "end.character"), 0), srv->utf8);
+		if (b < a) b = a;
+		ptrdiff_t delta = (ptrdiff_t)s->length - (ptrdiff_t)(b - a);
+		if (!splice(&doc->text, a, b, s->s, s->length)) continue;
+		update(doc->as, doc->text.s, first, last - first + 1, start, delta,
+			NULL);
+	}
+}
+
+/* Returns the token of the document at the position of the request
+parameters, or NULL. */
+const struct Token* token_at(const struct Server *srv,
+	const struct Document *doc, const char *params)
+{
+	const struct InputHeader *In = &doc->as->In;
+	int line = json_int(json_get(params, "position.line"), -1);
+	int character = json_int(json_get(params, "position.character"), -1);
+	if (line < 0 || line >= In->lines_count || character < 0) return NULL;
+	int column = bytes(rawline(doc, line), character, srv->utf8);
+	const struct Token *t = &In->tokens[In->lines[line].first];
+	for (; t->kind != END_TOKEN; t++) {
+		if (column >= t->column && column < t->column + t->length) return t;
+	}
+	return NULL;
+}
+
+/* Returns 1 if the assembly reported an error in the given line, whose
+words and labels are then left from a partial pass. */
+int erroneous(const struct Assembler *as, int line)
+{
+	for (int i = 0; i < as->diagnostic.errors; i++) {
+		if (as->diagnostic.error[i].line == line) return 1;
+	}
+	return 0;
+}
+
+/* Describes token t of the assembly in markdown: the value of numbers and
+labels, and the address and encoding of the words of its line, unless
+either line has an error. */
+void describe(const struct Assembler *as, const struct Token *t,
+	struct Text *h)
+{
+	const struct OutputHeader *Out = &as->Out;
+	const char *text = as->In.text.s + t->text;
+	char bits[2][9]; // binary words
+	if (t->kind == NUMBER_TOKEN) {
+		binary(bits[0], t->value);
+		append(h, "`%s` = %d = 0x%02X = 0b%s", text, t->value, t->value,
+			bits[0]);
+		if (t->value > 127) append(h, " (signed %d)", t->value - 256);
+	} else if (t->kind == REGISTER_TOKEN) {
+		append(h, "Register `R%d`", t->value);
+	} else if (t->kind == SYMBOL_TOKEN
+		&& as->In.symbols.symbol[t->value].label >= 0) {
+		const struct LabelElement *l
+			= &Out->label[as->In.symbols.symbol[t->value].label];
+		int line = as->In.tokens[l->token].line;
+		binary(bits[0], l->val);
+		if (erroneous(as, line)) {
+			append(h, "Label `%s`, defined in line %d, which has an error",
+				text, line);
+		} else {
+			append(h, "Label `%s` = %d = 0x%02X = 0b%s, defined in line %d",
+				text, l->val, l->val, bits[0], line);
+		}
+	}
+	if (erroneous(as, t->line)) return;
+	// the words that the line of the token produced
+	int data = 0; // first data word, if any
+	int words = 0; // number of data words
+	for (int addr = 0; addr < RAM_SIZE; addr++) {
+		const struct WordInfo *w = &Out->word[addr];
+		if (w->line != t->line) continue;
+		if (w->type == INSTRUCTION_WORD) {
+			char assembly[16];
+			int size = disassemble(assembly, Out->mem[addr], Out->mem[addr + 1]);
+			binary(bits[0], Out->mem[addr]);
+			binary(bits[1], Out->mem[addr + 1]);
+			if (h->length) append(h, "\n\n");
+			append(h, "Address %d (0x%02X): `%s`\n\n", addr, addr, assembly);
+			if (size == 2) {
+				append(h, "Encoding: 0x%02X 0x%02X = `%s %s`", Out->mem[addr],
+					Out->mem[addr + 1], bits[0], bits[1]);
+			} else {
+				append(h, "Encoding: 0x%02X = `%s`", Out->mem[addr], bits[0]);
+			}
+		} else if (w->type == DATA_WORD && !words++) {
+			data = addr;
+		}
+	}
+	if (words) {
+		if (h->length) append(h, "\n\n");
+		append(h, "Data at address %d (0x%02X), %d word%s", data, data, words,
+			words > 1 ? "s" : "");
+	}
+}
+
+/* Answers a hover request with a description of the token under the
+position, or null. */
+void hover(struct Server *srv, const struct Document *doc, const char *params)
+{
+	const struct Token *t = doc ? token_at(srv, doc, params) : NULL;
+	struct Text *h = &srv->string;
+	h->length = 0;
+	if (!append(h, "")) srv->failed = 1;
+	if (t) describe(doc->as, t, h);
+	if (!h->length) {
+		compose(srv, "null");
+		return;
+	}
+	compose(srv, "{\"contents\":{\"kind\":\"markdown\",\"value\":");
+	quote(srv, h->s, h->length);
+	compose(srv, "},\"range\":");
+	range(srv, t->line - 1, rawline(doc, t->line - 1), t->column, t->length);
+	compose(srv, "}");
+}
+
+/* Answers a definition request with the location of the label under the
+position, or null. */
+void definition(struct Server *srv, const struct Document *doc,
+	const char *params)
+{
+	const struct Token *t = doc ? token_at(srv, doc, params) : NULL;
+	int i = t && t->kind == SYMBOL_TOKEN
+		? doc->as->In.symbols.symbol[t->value].label : -1;
+	if (i < 0) {
+		compose(srv, "null");
+		return;
+	}
+	location(srv, doc, &doc->as->In.tokens[doc->as->Out.label[i].token]);
+}
+
+/* Answers a references request with the locations of all the occurrences of
+the symbol under the position, including its definition if requested. */
+void references(struct Server *srv, const struct Document *doc,
+	const char *params)
+{
+	const struct Token *t = doc ? token_at(srv, doc, params) : NULL;
+	compose(srv, "[");
+	if (t && t->kind == SYMBOL_TOKEN) {
+		const struct InputHeader *In = &doc->as->In;
+		const char *declaration = json_get(params, "context.includeDeclaration");
+		int label = In->symbols.symbol[t->value].label;
+		int skip = label >= 0 && !(declaration && !strncmp(declaration, "true", 4))
+			? doc->as->Out.label[label].token : -1; // the definition
+		char comma = 0;
+		for (int i = 0; i < In->count; i++) {
+			const struct Token *r = &In->tokens[i];
+			if (r->kind != SYMBOL_TOKEN || r->value != t->value || i == skip) {
+				continue;
+			}
+			if (comma) compose(srv, ",");
+			location(srv, doc, r);
+			comma = 1;
+		}
+	}
+	compose(srv, "]");
+}
+
+/* Agrees to count positions in UTF-8 bytes if the client of the initialize
+request offers it, or else keeps the UTF-16 code units that LSP defaults
+to, and answers with the encoding. */
+void initialize(struct Server *srv, const char *params)
+{
+	const char *e = json_get(params, "capabilities.general.positionEncodings");
+	for (e = json_first(e); e && !srv->utf8; e = json_next(e)) {
+		srv->utf8 = json_string(e, &srv->string)
+			&& !strcmp(srv->string.s, "utf-8");
+	}
+	compose(srv, "\"result\":{\"capabilities\":{\"positionEncoding\":\"%s\","
+		"\"textDocumentSync\":{\"openClose\":true,\"change\":2},"
+		"\"hoverProvider\":true,\"definitionProvider\":true,"
+		"\"referencesProvider\":true},\"serverInfo\":{\"name\":\"e80asm\"}}}",
+		srv->utf8 ? "utf-8" : "utf-16");
+}
+
+/* Handles a message of the client. Returns 0 when the client exits. */
+int handle(struct Server *srv, const char *message)
+{
+	const char *id = json_member(message, "id");
+	const char *params = json_member(message, "params");
+	int idlength = id ? (int)(json_skip(id) - id) : 0;
+	char method[64] = "";
+	if (json_string(json_member(message, "method"), &srv->string)) {
+		snprintf(method, sizeof(method), "%s", srv->string.s);
+	}
+	if (!strcmp(method, "exit")) return 0;
+	if (!strncmp(method, "textDocument/did", 16)) {
+		// notifications of the document contents
+		struct Document *doc = document(srv, params);
+		if (!strcmp(method, "textDocument/didOpen")) {
+			doc = open_document(srv, params);
+		} else if (!strcmp(method, "textDocument/didChange") && doc) {
+			change_document(srv, doc, params);
+		} else if (!strcmp(method, "textDocument/didClose") && doc) {
+			close_document(srv, doc);
+			return 1;
+		} else {
+			return 1;
+		}
+		if (doc) publish(srv, doc, 0);
+		return 1;
+	}
+	if (!id || idlength <= 0) return 1; // other notifications are ignored
+	compose(srv, "{\"jsonrpc\":\"2.0\",\"id\":%.*s,", idlength, id);
+	if (!strcmp(method, "initialize")) {
+		initialize(srv, params);
+	} else if (!strcmp(method, "shutdown")) {
+		srv->shutdown = 1;
+		compose(srv, "\"result\":null}");
+	} else if (!strcmp(method, "textDocument/hover")) {
+		compose(srv, "\"result\":");
+		hover(srv, document(srv, params), params);
+		compose(srv, "}");
+	} else if (!strcmp(method, "textDocument/definition")) {
+		compose(srv, "\"result\":");
+		definition(srv, document(srv, params), params);
+		compose(srv, "}");
+	} else if (!strcmp(method, "textDocument/references")) {
+		compose(srv, "\"result\":");
+		references(srv, document(srv, params), params);
+		compose(srv, "}");
+	} else {
+		compose(srv, "\"error\":{\"code\":-32601,\"message\":\"Unknown method\"}}");
+	}
+	transmit(srv);
+	return 1;
+}
+
+int lsp(FILE *in, FILE *out)
+{
+	struct Server srv = {0};
+	char *message;
+	srv.out = out;
+	while ((message = receive(in))) {
+		int running = handle(&srv, message);
+		free(message);
+		if (!running) break;
+	}
+	while (srv.docs) free_document(&srv, &srv.doc[0]);
+	free(srv.doc);
+	free(srv.body.s);
+	free(srv.string.s);
+	return !srv.shutdown;
+}
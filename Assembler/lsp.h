@@ -0,0 +1,18 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Language server headers
+
+#ifndef LSP_H
+#define LSP_H
+
+#include <stdio.h>
+
+/* Serves the Language Server Protocol over the JSON-RPC messages of in and
+out, which should be binary streams, until the client exits. The assembly of
+each open document stays resident, and edits re-lex only their lines before
+the passes run again; diagnostics are published after every edit, and hovers
+(encoding, address, hex), label definitions and references are answered from
+the token stream and the RAM image. Returns 0 if the client requested a
+shutdown before exiting, or 1 otherwise. */
+int lsp(FILE *in, FILE *out);
+
+#endif
@@ -4,316 +4,539 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 
+#include "assembler.h"
+#include "backends.h"
+#include "batch.h"
+#include "simulator.h"
+#include "sweep.h"
+#include "lsp.h"
+#include "memory_map.h"
+#include "analyzer.h"
+#include "profiler.h"
+#include "linker.h"
+#include "rules.h"
+#include "stats.h"
 #include "error_handler.h"
 #include "data_structures.h"
 #include "parse_functions.h"
 
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#if STATS
+#define STATS_USAGE " [--stats|--stats-json]"
+#define STATS_HELP \
+	"    --stats    Prints the wall time of each assembly phase and counters\n" \
+	"               of lines, tokens, conversions, lookups and bytes to\n" \
+	"               stderr; --stats-json prints them as JSON.\n"
+#else
+#define STATS_USAGE ""
+#define STATS_HELP ""
+#endif
+
+/* Prints the diagnostic of a failed assembly and returns its error code. */
+int fail(struct Assembler *as)
+{
+	fputs(as->diagnostic.message.s, stderr);
+	return as->diagnostic.code;
+}
+
+/* Prints the statistics of the last assembly to stderr, as a table, or as
+JSON if json is set. */
+void print_stats(struct Assembler *as, char json)
+{
+#if STATS
+	struct Text t = {0};
+	measure(as);
+	if (format_stats(as->stats, &t, json)) fputs(t.s, stderr);
+	free(t.s);
+#else
+	(void)as;
+	(void)json;
+#endif
+}
+
+/* Prints the words and cycles saved by the optimizer to stderr. */
+void print_savings(const struct Assembler *as)
+{
+	fprintf(stderr, "Optimized: %d words saved, %d cycles saved per execution "
+		"of the rewritten code.\n", as->Out.saved_words, as->Out.saved_cycles);
+}
+
+/* Runs the unoptimized assembly of the source as well as the optimized
+computer c, and prints the cycles that the optimized run saved to stderr.
+The figure of print_savings counts each rewrite once, while this one counts
+every execution of it. Nothing is printed if either run doesn't halt. */
+void print_run_savings(const char *source, const struct Computer *c,
+	unsigned long limit)
+{
+	struct Assembler *as = new_assembler();
+	struct Computer original, optimized = *c;
+	if (!as) return;
+	if (assemble(as, source, NULL) == NO_ERROR) {
+		load_assembly(&original, as);
+		if (simulate(&original, limit) && simulate(&optimized, limit)) {
+			fprintf(stderr, "The run took %lu cycles, %ld less than without "
+				"optimizing.\n", optimized.cycles,
+				(long) original.cycles - (long) optimized.cycles);
+		}
+	}
+	free_assembler(as);
+}
+
+/* Prints the RAM taken by the .TABLE arrays of the program to stderr. */
+void print_tables(const struct Assembler *as)
+{
+	struct Text t = {0};
+	if (format_tables(as, &t) && t.s) fputs(t.s, stderr);
+	free(t.s);
+}
+
+/* Prints the memory map of the assembled program to stderr. */
+void print_map(const struct Assembler *as)
+{
+	struct Text t = {0};
+	if (format_map(as, &t)) fputs(t.s, stderr);
+	free(t.s);
+}
+
+/* Reads the rule database at path into r. Returns NO_ERROR, or the code of
+the error, which is reported in as->diagnostic. */
+int load_rules(struct Assembler *as, const char *path, struct Rules *r)
+{
+	FILE *f = fopen(path, "r");
+	char *text = f ? readall(f) : NULL;
+	enum ErrorCode result = NO_ERROR;
+	if (f) fclose(f);
+	as->In.token = path; // reported as the offending token
+	if (!text) {
+		result = OPEN_SOURCE;
+	} else if (!read_rules(r, text)) {
+		result = RULES;
+	}
+	free(text);
+	if (result != NO_ERROR) diagnose(as, result);
+	return result;
+}
+
+/* Runs the computer until it halts or reaches the cycle limit, and prints
+its final state to stdout. */
+int run(struct Computer *c, unsigned long limit)
+{
+	struct Text t = {0};
+	simulate(c, limit);
+	dump(c, &t);
+	if (!t.s) {
+		fputs("Memory allocation error!\n", stderr);
+		return MEMORY_ALLOCATION_ERROR;
+	}
+	fputs(t.s, stdout);
+	free(t.s);
+	return NO_ERROR;
+}
+
+/* Runs the computer for all 256 DIP inputs at once, and prints the final
+state of each one to stdout. */
+int run_sweep(const struct Computer *c, unsigned long limit)
+{
+	struct Text t = {0};
+	struct Sweep *s = malloc(sizeof(*s));
+	if (s) {
+		load_sweep(s, c);
+		sweep(s, limit);
+		dump_sweep(s, &t);
+		free(s);
+	}
+	if (!t.s) {
+		fputs("Memory allocation error!\n", stderr);
+		return MEMORY_ALLOCATION_ERROR;
+	}
+	fputs(t.s, stdout);
+	free(t.s);
+	return NO_ERROR;
+}
+
+/* Runs the computer with a profile of its cycles, and prints the annotated
+source of the assembly to stdout, or its call stacks if stacks is set. */
+int run_profile(struct Computer *c, unsigned long limit,
+	const struct Assembler *as, char stacks)
+{
+	struct Text t = {0};
+	struct Profile *p = malloc(sizeof(*p));
+	if (p) {
+		profile(p, c, limit);
+		if (!(stacks ? format_stacks(p, as, &t) : format_profile(p, as, &t))) {
+			free(t.s);
+			t.s = NULL;
+		}
+		free(p);
+	}
+	if (!t.s) {
+		fputs("Memory allocation error!\n", stderr);
+		return MEMORY_ALLOCATION_ERROR;
+	}
+	fputs(t.s, stdout);
+	free(t.s);
+	return NO_ERROR;
+}
+
+/* Links the object files at the paths into the RAM image of as->Out.
+Returns NO_ERROR, or the code of the error, which is reported in
+as->diagnostic. */
+enum ErrorCode link_files(struct Assembler *as, char **paths, int count)
+{
+	char **objects = calloc(count, sizeof(*objects));
+	enum ErrorCode result = objects ? NO_ERROR : MEMORY_ALLOCATION_ERROR;
+	for (int i = 0; i < count && result == NO_ERROR; i++) {
+		FILE *f = fopen(paths[i], "r");
+		objects[i] = f ? readall(f) : NULL;
+		if (f) fclose(f);
+		if (!objects[i]) {
+			as->In.token = paths[i];
+			result = OPEN_SOURCE;
+		}
+	}
+	if (result != NO_ERROR) {
+		diagnose(as, result);
+	} else {
+		result = link_objects(as, objects, paths, count);
+	}
+	for (int i = 0; objects && i < count; i++) free(objects[i]);
+	free(objects);
+	return result;
+}
+
+/* Assembles the source without rendering it, or links the count object
+files at the paths of --link instead if count isn't 0, leaving the RAM
+image in as->Out. Returns like assemble(). */
+enum ErrorCode build(struct Assembler *as, const char *source,
+	char **paths, int count)
+{
+	if (count) return link_files(as, paths, count);
+	return assemble(as, source, NULL);
+}
+
 int main(int argc, char *argv[])
 {
+	char quiet = 0; // /Q switch
+	const char *batch_path = NULL; // --batch directory or list file
+	char run_source = 0; // --run switch
+	const char *program_path = NULL; // --run-vhd Program.vhd file
+	unsigned long cycles = DEFAULT_CYCLES; // --cycles limit
+	char all_inputs = 0; // --sweep switch
+	const struct Backend *format = backends; // --format, VHDL by default
+	char language_server = 0; // --lsp switch
+	char stats = 0; // --stats switch, 2 for --stats-json
+	char optimize = 0; // -O switch, 2 for -O2
+	const char *rules_path = NULL; // --rules database
+	struct Rules rules = {0};
+	char map = 0; // --map switch
+	char analyze = 0; // --analyze switch
+	char profiling = 0; // --profile switch, 2 for --profile-stacks
+	char object = 0; // -c switch
+	int link_first = 0, link_count = 0; // --link object files in argv
+	for (int i = 1; i < argc; i++) {
+		if (eq(argv[i], "/Q")) {
+			quiet = 1;
+		} else if (eq(argv[i], "--batch") && i + 1 < argc) {
+			batch_path = argv[++i];
+		} else if (eq(argv[i], "--run")) {
+			run_source = 1;
+		} else if (eq(argv[i], "--run-vhd") && i + 1 < argc) {
+			program_path = argv[++i];
+		} else if (eq(argv[i], "--sweep")) {
+			run_source = all_inputs = 1;
+		} else if (eq(argv[i], "--cycles") && i + 1 < argc) {
+			cycles = strtoul(argv[++i], NULL, 10);
+		} else if (eq(argv[i], "--format") && i + 1 < argc) {
+			format = backend(argv[++i]);
+		} else if (eq(argv[i], "--emit-c")) {
+			format = backend("c");
+		} else if (eq(argv[i], "--lsp")) {
+			language_server = 1;
+		} else if (eq(argv[i], "-O")) {
+			optimize = 1;
+		} else if (eq(argv[i], "-O2")) {
+			optimize = 2;
+		} else if (eq(argv[i], "--rules") && i + 1 < argc) {
+			rules_path = argv[++i];
+		} else if (eq(argv[i], "--map")) {
+			map = 1;
+		} else if (eq(argv[i], "--analyze")) {
+			analyze = 1;
+		} else if (eq(argv[i], "-c")) {
+			object = 1;
+		} else if (eq(argv[i], "--link")) {
+			link_first = i + 1;
+			while (i + 1 < argc && argv[i + 1][0] != '-' && !eq(argv[i + 1], "/Q")) {
+				i++;
+			}
+			link_count = i + 1 - link_first;
+		} else if (eq(argv[i], "--profile")) {
+			run_source = profiling = 1;
+		} else if (eq(argv[i], "--profile-stacks")) {
+			run_source = 1;
+			profiling = 2;
+#if STATS
+		} else if (eq(argv[i], "--stats")) {
+			stats = 1;
+		} else if (eq(argv[i], "--stats-json")) {
+			stats = 2;
+#endif
+		}
+	}
 
-	char str[MAX_LINE_LENGTH] = {0}; // scratchpad string
-	char instr[MAX_LINE_LENGTH] = {0}; // current instruction
-	char title[MAX_LINE_LENGTH] = {0}; // .TITLE string (optional)
-	int speed = DEFAULT_SPEED; // .SPEED value
-	int monitor = DEFAULT_MONITOR; // .MONITOR value
-	char simdip[9] = DEFAULT_SIMDIP; // .SIMDIP value
-	int reg, reg2; // register address
-	int n; // scratchpad index or value
-	int len, spaces; // formatting helpers
-	char* CtrlD = NULL; // check if Ctrl+D is pressed
-	FILE* asm_input = stdin; // fopen("test.e80asm", "r");
-	FILE* vhdl_template = fopen(TEMPLATE, "r");
-	if (!vhdl_template) error(OPEN_TEMPLATE);
+	struct Assembler *as = new_assembler();
+	if (!as) {
+		fputs("Memory allocation error!\n", stderr);
+		return MEMORY_ALLOCATION_ERROR;
+	}
+
+	if (!format) {
+		diagnose(as, OUTPUT_FORMAT);
+		return fail(as);
+	}
+
+	if (link_count && (object || optimize || rules_path || batch_path)) {
+		// the objects are linked as they were assembled
+		diagnose(as, LINK_OPTION);
+		return fail(as);
+	}
+
+	if (rules_path) {
+		if (load_rules(as, rules_path, &rules) != NO_ERROR) return fail(as);
+		as->rules = &rules;
+	}
+
+	if (language_server) {
+		// serve an editor over stdio, without banners
+		free_assembler(as);
+#ifdef _WIN32
+		// message lengths are counted in bytes, including carriage returns
+		_setmode(_fileno(stdin), _O_BINARY);
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		return lsp(stdin, stdout);
+	}
+
+	if (program_path) {
+		// simulate a previously generated Program.vhd
+		struct Computer c;
+		FILE *f = fopen(program_path, "r");
+		char *vhdl = f ? readall(f) : NULL;
+		if (f) fclose(f);
+		if (!vhdl || !load_program(&c, vhdl)) {
+			free(vhdl);
+			diagnose(as, OPEN_SOURCE);
+			return fail(as);
+		}
+		free(vhdl);
+		free_assembler(as);
+		return all_inputs ? run_sweep(&c, cycles) : run(&c, cycles);
+	}
+
+	struct Template *template = NULL;
+	if (!run_source && !analyze && !object && !format->render) {
+		FILE* vhdl_template = fopen(TEMPLATE, "r");
+		if (!vhdl_template) {
+			diagnose(as, OPEN_TEMPLATE);
+			return fail(as);
+		}
+		// the template is compiled once, and shared by all assemblies
+		char *text = readall(vhdl_template);
+		fclose(vhdl_template);
+		template = text ? compile_template(text) : NULL;
+		free(text);
+		if (!template) {
+			diagnose(as, MEMORY_ALLOCATION_ERROR);
+			return fail(as);
+		}
+	}
+
+	if (batch_path) {
+		int result = batch(batch_path, template, format, optimize,
+			as->rules);
+		free(rules.rule);
+		free_template(template);
+		free_assembler(as);
+		return result;
+	}
 
 	/* Starting message (hide if /Q switch is enabled) */
-	if (argc < 2 || (strcmp(argv[1],"/Q") && strcmp(argv[1],"/q"))) {
+	if (!quiet && !link_count) {
 		fprintf(stderr,
 			"E80 CPU Assembler v3.0 - April 2026, Panos Stokas\n\n"
 			"Translates an E80-assembly program to VHDL code via stdin.\n\n"
-			"E80ASM [/Q]\n\n"
-			"    /Q      Silent mode, hides this message.\n\n"
+			"E80ASM [/Q] [--batch directory|list] [--run] [--run-vhd file]\n"
+			"       [--sweep] [--cycles limit] [--format name] [--lsp] [-O|-O2]\n"
+			"       [--rules file] [--map] [--analyze] [--emit-c]\n"
+			"       [--profile|--profile-stacks] [-c] [--link objects]"
+			STATS_USAGE "\n\n"
+			"    /Q         Silent mode, hides this message.\n"
+			"    --batch    Assembles all %s files of a directory, or the\n"
+			"               files of a list, on all processor cores. Outputs\n"
+			"               are written next to their sources as %s files.\n"
+			"    --run      Executes the assembled program instead of writing\n"
+			"               its VHDL code, and prints the registers and the\n"
+			"               .MONITOR block after it halts.\n"
+			"    --run-vhd  Executes a previously generated Program.vhd file.\n"
+			"    --sweep    Executes the program for each of the 256 DIP inputs\n"
+			"               at once, and prints a row of registers and .MONITOR\n"
+			"               words per input.\n"
+			"    --cycles   Stops execution after 'limit' cycles if the program\n"
+			"               doesn't halt (default %d).\n"
+			"    --format   Writes the RAM image as a memory initialization\n"
+			"               file instead of VHDL code: bin (raw binary),\n"
+			"               ihex (Intel HEX), readmemh (Verilog), mif (Quartus),\n"
+			"               mi (Gowin), mem or coe (Xilinx), c (--emit-c).\n"
+			"    --emit-c   Translates the program to C, as --format c does;\n"
+			"               the C program executes its basic blocks as\n"
+			"               compiled code and prints what --run and --sweep\n"
+			"               print, many times faster.\n"
+			"    --lsp      Runs as a language server over stdin and stdout,\n"
+			"               for live diagnostics, hovers and label lookups\n"
+			"               in editors.\n"
+			"    -O         Optimizes the program with peephole rewrites that\n"
+			"               keep its registers, flags and data as they are,\n"
+			"               and reports the words and cycles saved; with\n"
+			"               --run, also the cycles that the run saved.\n"
+			"    -O2        Also lays out the code by its control flow:\n"
+			"               removes unreachable code and unused .DATA arrays,\n"
+			"               places jump targets right after their jumps, and\n"
+			"               moves the data down to the code. The addresses\n"
+			"               of .DATA arrays must be taken by their labels.\n"
+			"    --rules    Also rewrites with the rules of a database found\n"
+			"               by the e80superopt tool.\n"
+			"    --map      Prints the memory map of the program to stderr:\n"
+			"               its code, data and .RESERVE buffers, the free\n"
+			"               words and the headroom of the stack, with the\n"
+			"               code and data moved or removed by -O2.\n"
+			"    --analyze  Prints the cycles of the paths and loops of each\n"
+			"               subroutine, its worst case where loop counts are\n"
+			"               constant, the stack depth and the run time at the\n"
+			"               .SPEED level, without running the program.\n"
+			"    --profile  Executes the program and prints its source lines\n"
+			"               with their cycles and taken branches, and the\n"
+			"               cycles of each subroutine; --profile-stacks prints\n"
+			"               its call stacks for flame graph tools instead.\n"
+			"    -c         Writes a relocatable %s object instead of VHDL\n"
+			"               code, which may use the .EXTERN labels of other\n"
+			"               objects.\n"
+			"    --link     Links the program object and the library objects\n"
+			"               that it needs into one RAM image, and writes it in\n"
+			"               the output format, or runs, profiles, analyzes or\n"
+			"               maps it instead of the program of stdin.\n"
+			STATS_HELP "\n"
 			"Example:\n\n"
 			"e80asm < myprogram.e80asm > ..\\VHDL\\program.vhd\n\n"
-			"Type your assembly code and press Ctrl-D & [Enter].\n");
+			"Type your assembly code and press Ctrl-D & [Enter].\n",
+			SOURCE_EXTENSION, OUTPUT_EXTENSION, DEFAULT_CYCLES,
+			OBJECT_EXTENSION);
 	}
 
-	/* Read lines from stdin until EOF or end-of-transmit (Ctrl-D). */
-	while (!CtrlD && fgets(str, MAX_LINE_LENGTH, asm_input)) {
-		 if ((CtrlD = strchr(str, 4))) { // end of transmit found
-			*CtrlD = 0; // replace end of transmit with terminal
-		} else if (!strchr(str, '\n') && !feof(asm_input)) {
-			// a line without a newline character, is either the last line or
-			// it exceeds the maximum supported size.
-			error(MAX_LENGTH_EXCEEDED);
-		}
-		trim(str); // trim whitespace and comments
-		enqueue(str); // store the line in the global "In" structure
+	char *source = link_count ? NULL : readall(stdin);
+	if (!source && !link_count) {
+		diagnose(as, MEMORY_ALLOCATION_ERROR);
+		return fail(as);
 	}
 
-	/* Collect labels (symbols).
-	Label/value pairs are added to the "Out" structure. Error checking is
-	minimal in this stage. */
-	Out.addr = 0; // current memory address in the global "Out" structure
-	firstline(); // go to the first token of the queued code
-	while (In.current) { // read until the last line
-		if (eq(TOKEN, ".LABEL")) {
-			// <directive> ::= ".LABEL" <s+> <label> <s+> <number>
-			strcpy(str, nexttoken()); // <label>
-			if (!label(str)) error(LABEL);
-			n = number(nexttoken()); // <number>
-			if (n < 0) error(NUMBER); // error codes = negative values
-			addlabel(str, n);
-		} else if (eq(TOKEN, ".DATA")) {
-			// <directive> ::= ".DATA" <s+> <label> <s+> <array>
-			strcpy(str, nexttoken()); // <label>
-			if (!label(str)) error(LABEL);
-			addlabel(str, 0); // data labels are calculated in the next stage
-		} else if (instr_size1(TOKEN)) {
-			nextaddr(); // combines Out.addr++ and ram limit check
-		} else if (instr_size2(TOKEN)) {
-			nextaddr();
-			nextaddr(); // two-word instructions
-		} else if (label(TOKEN)) {
-			// consequtive labels are not allowed
-			if (Out.labels > 0 && Out.label[Out.labels-1].val == Out.addr) {
-				error(INSTRUCTION);
-			}
-			strcpy(str, TOKEN);
-			// catch missing colons now, otherwise most instruction typos
-			// will be regarded as labels, causing syntactically correct
-			// but misleading errors at use sites during the second pass
-			if (!eq(nexttoken(), ":")) error(INSTRUCTION_COLON);
-			addlabel(str, Out.addr);
-			// check the next token instead of the next line to process
-			// <label:> <instruction> cases
-			nexttoken();
-			continue;
+#if STATS
+	struct Stats collected = {0};
+	if (stats) as->stats = &collected;
+#endif
+	as->optimize = optimize;
+
+	if (analyze) {
+		// assemble or link without rendering, and analyze the RAM image
+		struct Text t = {0};
+		enum ErrorCode result = build(as, source, argv + link_first,
+			link_count);
+		if (result != NO_ERROR) result = fail(as);
+		if (stats) print_stats(as, stats == 2);
+		if (result != NO_ERROR) return result;
+		if (optimize) print_savings(as);
+		if (map) print_map(as);
+		if (!format_analysis(as, &t)) {
+			fputs("Memory allocation error!\n", stderr);
+			result = MEMORY_ALLOCATION_ERROR;
+		} else {
+			fputs(t.s, stdout);
 		}
-		nextline();
+		free(t.s);
+		free(source);
+		free_assembler(as);
+		return result;
 	}
-	
-	sortlabels(); // to allow bsearch in findlabel
-
-	/* Parse directives.
-	E80 is designed according to the Neumann model where machine code and data
-	are stored in the same area. However, .DATA arrays are checked against
-	overwriting program code. */
-	firstline();
-	while (In.current) {
-		if (eq(TOKEN, ".TITLE")) {
-			// <directive> ::= ".TITLE" <s+> <quoted_string>
-			if (title[0]) error(DUPLICATE_TITLE); // previously set
-			nexttoken();
-			if (TOKEN[0] != '"') error(UNQUOTED_TITLE);
-			strncpy(title, TOKEN + 1, strlen(TOKEN) - 2); // unquote
-		} else if (eq(TOKEN, ".MONITOR")) {
-			// <directive> ::= ".MONITOR" <s+> <value>
-			monitor = value(nexttoken());
-		} else if (eq(TOKEN, ".SPEED")) {
-			// <directive> ::= ".SPEED" <s+> <level>
-			speed = number(nexttoken());
-			if (speed < MIN_SPEED || speed > MAX_SPEED) error(SPEED);
-		} else if (eq(TOKEN, ".SIMDIP")) {
-			// <directive> ::= ".SIMDIP" <s+> <value>
-			bitcopy(simdip, value(nexttoken()), 7, 0);
-		} else if (eq(TOKEN, ".LABEL")) {
-			findlabel(nexttoken()); // includes dupe checking
-			nexttoken(); // number was checked during symbol collection
-		} else if (eq(TOKEN, ".DATA")) {
-			// <directive> ::= ".DATA" <s+> <label> <s+> <array>
-			Out.label[findlabel(nexttoken())].val = Out.addr;
-			do {
-				nexttoken();
-				if (!array_element(TOKEN)) error(ARRAY_ELEMENT);
-				// <array_element> ::= <number> | <quoted_string>
-				if (TOKEN[0] != '"') {
-					// <number>, write on the RAM as 8 bits
-					bitcopy(RAM, value(TOKEN), 7, 0);
-					// add the original number as a comment
-					sprintf(COMMENT, "%s", TOKEN);
-					nextaddr();
-				} else {
-					// <quoted_string> ::= "\"" <char+> "\""
-					// skip quotes and write each character's ASCII
-					// value on the RAM as 8 bits
-					for (unsigned int i = 1; i < strlen(TOKEN) -1; i++) {
-						bitcopy(RAM, (int)TOKEN[i], 7, 0);
-						// add each character as a comment
-						sprintf(COMMENT, "'%c' (%d)", TOKEN[i], TOKEN[i]);
-						nextaddr();
-					}
-				}
-				// <array> ::= <array_element> | <array_element> <,> <array>
-			} while (eq(nexttoken(), ","));
-			if (!eq(TOKEN, "")) error(COMMA);
-		} else if (TOKEN[0] == '.') {
-			error(DIRECTIVE);
-		} else if (!eq(TOKEN, "")) {
-			// a non empty token which is not a directive ⇒ end of directives
-			break;
+
+	if (object) {
+		// assemble without optimizing or rendering, and write the object
+		struct Text t = {0};
+		as->object = 1;
+		enum ErrorCode result = assemble(as, source, NULL);
+		if (result != NO_ERROR) result = fail(as);
+		if (stats) print_stats(as, stats == 2);
+		if (result == NO_ERROR && !format_object(as, &t)) {
+			fputs("Memory allocation error!\n", stderr);
+			result = MEMORY_ALLOCATION_ERROR;
+		} else if (result == NO_ERROR) {
+			fputs(t.s, stdout);
 		}
-		if (nexttoken()) error(EXTRANEOUS);
-		nextline();
+		free(t.s);
+		free(source);
+		free_assembler(as);
+		return result;
 	}
-	
-	/* Parse instructions according to the BNF syntax rules.
-	The parser functions (instr_argumentless, instr_n, etc) handle syntax
-	checking, translation and write the opcode to the "Out" structure's	array.
-	The remaining bits are filled by the code below. The RAM and COMMENT
-	macros specify a string element at Out.addr. Each binary instruction is
-	followed by a comment with its assembly mnemonic. For two-word instructions
-	the first part will not have a comment. Comments therefore are used to
-	differentiate between one and two word instructions and allows to create
-	well-formatted VHDL code where each instruction is writen in one line. */
-	Out.addr = 0;
-	while (In.current) {
-		if ((instr_noarg(TOKEN))) {
-			// <[instruction]> ::= <instr_noarg>
-			sprintf(COMMENT, "%s", TOKEN);
-			nextaddr();
-		} else if (instr_reg(TOKEN)) {
-			// <[instruction]> ::= <instr_reg> <s+> <reg>
-			strcpy(instr, TOKEN);
-			reg = regnum(nexttoken());
-			if (reg < 0) error(REGISTER);
-			bitcopy(RAM, reg, 2, 0); // <reg> in Instr1[2:0]
-			sprintf(COMMENT, "%s R%d", instr, reg);
-			nextaddr();
-		} else if (instr_n(TOKEN)) {
-			// <[instruction]>  ::= <instr_n> <s+> <value>
-			strcpy(instr, TOKEN);
-			n = value(nexttoken());
-			if (n < 0) error(VALUE);
-			nextaddr();
-			bitcopy(RAM, n, 7, 0); // <value>
-			sprintf(COMMENT, "%s %d", instr, n);
-			nextaddr();
-		} else if (instr_reg_op2(TOKEN)) {
-			// <instruction> ::= <instr_reg_op2> <s+> <reg> <,> <op2>
-			char bracket_op2 = load_store(TOKEN); // op2 must be bracketed
-			strcpy(instr, TOKEN);
-			reg = regnum(nexttoken());
-			if (reg < 0) error(REGISTER);
-			if (!eq(nexttoken(), ",")) error(COMMA);
-			str[0] = 0; // clear scratchpad string
-			sprintf(str, "%s R%d, ", instr, reg);
-			nexttoken();
-			if (bracket_op2) {
-				if (!eq(TOKEN,"[")) error(LEFTBRACKET);
-				sprintf(str+strlen(str),"[");
-				nexttoken();
-			}
-			n = value(TOKEN);
-			reg2 = regnum(TOKEN);
-			if (n >= 0) {
-				// op2 = <value>
-				bitcopy(RAM, reg, 3, 0); // <reg> in Instr1[3:0]
-				nextaddr();
-				bitcopy(RAM, n, 7, 0); // <number> in Instr2
-				if (n < 128 || bracket_op2) {
-					sprintf(COMMENT, "%s%d", str, n);
-				} else {
-					// signed equivalent for non-address
-					sprintf(COMMENT, "%s%d (-%d)", str, n, 256-n);
-				}
-			} else if (reg2 >= 0) {
-				// op2 = <reg>
-				strcpy(&RAM[4], "1000");
-				nextaddr();
-				bitcopy(RAM, reg, 7, 4); // <reg> in Instr2[7:4]
-				bitcopy(RAM, reg2, 3, 0); // <reg> (op2) in Instr2[3:0]
-				sprintf(COMMENT, "%sR%d", str, reg2);
-			} else {
-				error(OP2);
-			}
-			if (bracket_op2) {
-				if (!eq(nexttoken(),"]")) error(RIGHTBRACKET);
-				sprintf(COMMENT+strlen(COMMENT), "]");
-			}
-			nextaddr();
-		} else if (findlabel(TOKEN) != -1) { // includes dupe checking
-			// label syntax was checked during symbol collection
-			nexttoken();
-			nexttoken();
-			continue;
-		} else if (!eq(TOKEN, "")) {
-			error(INSTRUCTION_LABEL);
-		}
-		if (nexttoken()) error(EXTRANEOUS);
-		nextline();
+
+	if (run_source) {
+		// assemble or link without rendering, and simulate the RAM image
+		struct Computer c;
+		enum ErrorCode result = build(as, source, argv + link_first,
+			link_count);
+		if (result != NO_ERROR) result = fail(as);
+		if (stats) print_stats(as, stats == 2);
+		if (result != NO_ERROR) return result;
+		if (optimize) print_savings(as);
+		if (map) print_map(as);
+		load_assembly(&c, as);
+		if (optimize) print_run_savings(source, &c, cycles);
+		if (profiling) result = run_profile(&c, cycles, as, profiling == 2);
+		free(source);
+		free_assembler(as);
+		if (profiling) return result;
+		return all_inputs ? run_sweep(&c, cycles) : run(&c, cycles);
 	}
 
-	/* Print the converted VHDL code using the template file.
-	Each instruction reserves one line, followed by a comment specifying the
-	instruction in hex and the disassembled mnemonic. */
-	char hex[5] = {0}; // bin to hex conversion string (max 4 digits)
-	while (fgets(str, MAX_LINE_LENGTH, vhdl_template) != NULL) {
-		if (strstr(str, "--")) {
-			if (!eq(title,"")) {
-				printf(str, title);
-			} else {
-				printf(str, DEFAULT_TITLE);
-			}
-		} else if (strstr(str, "SPEED_directive")) {
-			printf(str, speed); // template contains %d specifier
-		} else if (strstr(str, "MONITOR_directive")) {
-			printf(str, monitor); // template contains %d specifier
-		} else if (strstr(str, "SIMDIP_directive")) {
-			printf(str, simdip); // template contains %s specifier
-		} else if (strstr(str, "MACHINE_CODE_PLACEHOLDER")) {
-			str[0] = 0; // clear scratchpad string
-			for (Out.addr = 0; Out.addr < RAM_SIZE; Out.addr++) {
-				if (eq(RAM, "")) continue; // handled by OTHERS in VHDL
-				len = strlen(str);
-				/* Write the instruction address in the end of the current
-				line; this allows for two-word instructions to have
-				both parts in the same line, such as:
-				addr => "instr1", addr+1 => "instr2" -- comment
-				or, for single-word instructions:
-				addr => "instr1",                    -- comment. */
-				sprintf(str + len, "%d", Out.addr);
-				len = strlen(str);
-				n = (unsigned) strtoul(RAM, NULL, 2); // for the hex conversion
-				if (len < 15) {
-					// space after the address in the 1st part of the line
-					// this allows for 1-3 address digits
-					spaces = 4 - len;
-					// write the hexadecimal conversion of the binary instruction
-					// or "data" if the word is from .DATA
-					if (COMMENT[0] && COMMENT[0] < 57) {
-						// comment is data (starts from quote or number)
-						strcpy(hex,"data");
-					} else {
-						sprintf(hex, "%02X", n); // instr1 to hex part of comment
-					}
-				} else {
-					// space after the address in the 2nd part of the line
-					spaces = 23 - len;
-					sprintf(hex + 2, "%02X", n); // instr2 to hex part of comment
-				}
-				// write the VHDL assignment of the word after the address
-				sprintf(str + len, "%*c=> \"%s\", ", spaces, ' ', RAM);
-				// write the hex conversion of the instruction part
-				if (!eq(COMMENT, "")) {
-					// comments are written after single-word instructions
-					// or after the 2nd part of two-word instructions
-					len = strlen(str);
-					// streamline comments for both instruction types
-					spaces = 39 - len;
-					sprintf(str + len, "%*c-- %-6s%s", spaces, ' ', hex, COMMENT);
-					puts(str);
-					str[0] = 0; // prepare for new line
-					hex[0] = 0; // prepare for new hex conversion
-				}
-			}
-		} else {
-			printf(str); // unmodified template lines
-		}
+	enum ErrorCode result = NO_ERROR;
+	if (!link_count) {
+		result = translate(as, source, template, format);
+	} else if ((result = link_files(as, argv + link_first, link_count))
+		== NO_ERROR) {
+		result = render_image(as, template, format);
+	}
+	if (result != NO_ERROR) {
+		result = fail(as);
+		if (stats) print_stats(as, stats == 2);
+		return result;
+	}
+#ifdef _WIN32
+	// keep line feeds and 0x1A bytes of binary output intact
+	if (format->binary) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+	fwrite(as->output.s, 1, as->output.length, stdout);
+	if (!link_count) {
+		fprintf(stderr, "\n\nAssembly complete with no errors.\n");
 	}
+	print_tables(as);
+	if (optimize) print_savings(as);
+	if (map) print_map(as);
+	if (stats) print_stats(as, stats == 2);
 
-	fprintf(stderr, "\n\nAssembly complete with no errors.\n");
-	
+	free(source);
+	free(rules.rule);
+	free_template(template);
+	free_assembler(as);
 	return NO_ERROR;
 }
@@ -0,0 +1,177 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Memory map of the RAM image
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory_map.h"
+#include "data_structures.h"
+#include "parse_functions.h"
+
+/* Splits the RAM image into regions at its code and data labels, for an
+image that the optimizer didn't lay out. Returns the number of regions. */
+int split_image(const struct Assembler *as, struct Region *region)
+{
+	const struct OutputHeader *Out = &as->Out;
+	int start[256]; // label at each address, or -1
+	int n = 0;
+	for (int a = 0; a < 256; a++) start[a] = -1;
+	for (int i = 0; i < Out->labels; i++) {
+		const struct LabelElement *l = &Out->label[i];
+		if (l->kind == CODE_LABEL || l->kind == DATA_LABEL) start[l->val] = i;
+	}
+	for (int a = 0; a < RAM_SIZE; a++) {
+		const struct WordInfo *w = &Out->word[a];
+		if (w->type == UNUSED_WORD) continue;
+		unsigned char kind = w->type == DATA_WORD ? DATA_REGION : CODE_REGION;
+		if (!n || start[a] >= 0 || region[n - 1].kind != kind
+			|| region[n - 1].to + region[n - 1].size != a) {
+			struct Region r = {kind, a, a, 0, start[a], w->line};
+			region[n++] = r;
+		}
+		region[n - 1].size++;
+	}
+	return n;
+}
+
+/* Appends a region for each .RESERVE buffer of the program to region,
+unless the layout optimizer placed them already, and returns the new number
+of regions. */
+int reserved_regions(const struct Assembler *as, struct Region *region, int n)
+{
+	const struct OutputHeader *Out = &as->Out;
+	for (int i = 0; i < n; i++) {
+		if (region[i].kind == RESERVED_REGION) return n;
+	}
+	for (int i = 0; i < Out->labels; i++) {
+		const struct LabelElement *l = &Out->label[i];
+		if (l->kind != RESERVED_LABEL || l->size <= 0) continue;
+		struct Region r = {RESERVED_REGION, l->val, l->val, l->size, i,
+			as->In.tokens[l->token].line};
+		region[n++] = r;
+	}
+	return n;
+}
+
+int program_top(const struct Assembler *as)
+{
+	const struct OutputHeader *Out = &as->Out;
+	int top = RAM_SIZE - 1;
+	while (top >= 0 && Out->word[top].type == UNUSED_WORD) top--;
+	for (int i = 0; i < Out->labels; i++) {
+		const struct LabelElement *l = &Out->label[i];
+		if (l->kind == RESERVED_LABEL && l->val + l->size - 1 > top) {
+			top = l->val + l->size - 1;
+		}
+	}
+	// the buffers of a linked image are only known by their regions
+	for (int i = 0; i < Out->regions; i++) {
+		const struct Region *r = &Out->region[i];
+		if (r->kind == RESERVED_REGION && r->to + r->size - 1 > top) {
+			top = r->to + r->size - 1;
+		}
+	}
+	return top;
+}
+
+/* Orders regions by their address in the image, and the removed ones last,
+by their address in source order. */
+int compareregions(const void *a, const void *b)
+{
+	const struct Region *x = a, *y = b;
+	if ((x->to < 0) != (y->to < 0)) return x->to < 0 ? 1 : -1;
+	if (x->to != y->to) return x->to - y->to;
+	return x->from - y->from;
+}
+
+/* Appends a row of the map for the words [from, from + size), or for a
+removed region if from is negative. */
+int maprow(struct Text *t, int from, int size, const char *kind, int line,
+	const char *label, const char *change)
+{
+	char address[24] = "-";
+	if (from >= 0 && size > 1) {
+		sprintf(address, "%d-%d", from, from + size - 1);
+	} else if (from >= 0) {
+		sprintf(address, "%d", from);
+	}
+	if (!append(t, "%-9s %5d  %-4s", address, size, kind)) return 0;
+	if (line && !append(t, "  %4d", line)) return 0;
+	if (*change) return append(t, "  %-20s %s\n", label, change);
+	return append(t, *label ? "  %s\n" : "\n", label);
+}
+
+int format_tables(const struct Assembler *as, struct Text *t)
+{
+	const struct InputHeader *In = &as->In;
+	int words = 0, tables = 0;
+	for (int i = 0; i < as->Out.labels; i++) {
+		const struct LabelElement *l = &as->Out.label[i];
+		// the directive precedes the label's defining token
+		if (l->kind != DATA_LABEL
+			|| !eq(In->text.s + In->tokens[l->token - 1].text, ".TABLE")) {
+			continue;
+		}
+		if (!append(t, tables++ ? ", %s %d word%s" : "Tables: %s %d word%s",
+			In->text.s + In->symbols.symbol[l->symbol].name, l->size,
+			l->size == 1 ? "" : "s")) return 0;
+		words += l->size;
+	}
+	return !tables || append(t, "; %d words of RAM in all.\n", words);
+}
+
+int format_map(const struct Assembler *as, struct Text *t)
+{
+	static const char *const kinds[] = {"code", "data", "rsvd"};
+	const struct OutputHeader *Out = &as->Out;
+	struct Region region[2 * RAM_SIZE];
+	int words[3] = {0}; // code, data and reserved words
+	int unused = 0;
+	int addr = 0; // first address after the previous region
+	int n = Out->regions;
+	if (n) {
+		memcpy(region, Out->region, n * sizeof(*region));
+	} else {
+		n = split_image(as, region);
+	}
+	n = reserved_regions(as, region, n);
+	qsort(region, n, sizeof(*region), compareregions);
+	if (!append(t, "\nAddress   Words  Kind  Line  Label\n")) return 0;
+	for (int i = 0; i <= n; i++) {
+		const struct Region *r = &region[i];
+		char change[32] = "";
+		const char *label = "";
+		int to = i < n && r->to >= 0 ? r->to : RAM_SIZE;
+		if (addr < to) {
+			// the words between regions, and after the last one
+			if (!maprow(t, addr, to - addr, "free", 0, "", "")) return 0;
+			unused += to - addr;
+			addr = to;
+		}
+		if (i == n) break;
+		if (r->label >= 0) {
+			int symbol = Out->label[r->label].symbol;
+			label = as->In.text.s + as->In.symbols.symbol[symbol].name;
+		}
+		if (r->to < 0) {
+			sprintf(change, "removed from %d", r->from);
+		} else {
+			if (r->from != r->to) sprintf(change, "moved from %d", r->from);
+			words[r->kind] += r->size;
+			addr = r->to + r->size;
+		}
+		if (!maprow(t, r->to, r->size, kinds[r->kind], r->line, label, change)) {
+			return 0;
+		}
+	}
+	int top = program_top(as);
+	if (!append(t, "\nCode %d words, data %d words, reserved %d words, "
+		"free %d words.\n", words[CODE_REGION], words[DATA_REGION],
+		words[RESERVED_REGION], unused)) return 0;
+	// the stack grows down from 0xFE into the free words above the program
+	if (top == 0xFE - 1) return append(t, "Stack headroom: 1 word, at %d.\n",
+		0xFE);
+	return append(t, "Stack headroom: %d words, from %d down to %d.\n",
+		0xFE - top, 0xFE, top + 1);
+}
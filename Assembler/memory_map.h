@@ -0,0 +1,25 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Memory map headers
+
+#ifndef MEMORY_MAP_H
+#define MEMORY_MAP_H
+
+#include "data_structures.h"
+
+/* Appends the memory map of the RAM image to t: its code, data and .RESERVE
+regions by address, with their sizes, source lines and labels, the free
+words left between them, the headroom of the stack above the program, and
+the blocks and arrays that the layout optimizer (-O2) moved or removed.
+Returns 0 if memory can't be allocated. */
+int format_map(const struct Assembler *as, struct Text *t);
+
+/* Appends the .TABLE arrays of the program with their words, and the RAM
+they take in all, to t, or nothing if there are none. Returns 0 if memory
+can't be allocated. */
+int format_tables(const struct Assembler *as, struct Text *t);
+
+/* Returns the highest address that the program takes, by its words or its
+.RESERVE buffers, or -1 if it takes none. */
+int program_top(const struct Assembler *as);
+
+#endif
@@ -0,0 +1,964 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Optimizer; rewrites the decoded instructions of the RAM image with the exact
+// register and flag semantics of CPU.vhd and ALU.vhd, and lays out its blocks
+
+#include <stdio.h>
+#include <string.h>
+
+#include "optimizer.h"
+#include "data_structures.h"
+#include "isa.h"
+#include "parse_functions.h"
+#include "rules.h"
+#include "simulator.h"
+
+/* Registers and flags, as bits of the state that an instruction reads or
+writes. R6 stands for the bits of FLAGS other than C, Z, S and V, so that an
+explicit access to FLAGS covers all of them. */
+#define REGISTER(r) (1 << (r))
+#define C_FLAG (1 << 8)
+#define Z_FLAG (1 << 9)
+#define S_FLAG (1 << 10)
+#define V_FLAG (1 << 11)
+#define ARITHMETIC_FLAGS (C_FLAG | Z_FLAG | S_FLAG | V_FLAG)
+#define ALL_STATE 0xFFF
+
+#define OPCODE(o) ((o)->k->opcode)
+
+/* A decoded instruction of the code. */
+struct Op {
+	unsigned char addr; // address before optimization
+	unsigned char size;
+	unsigned char instr1;
+	unsigned char instr2;
+	const struct Keyword *k;
+	char removed;
+	struct WordInfo word[2]; // metadata of its words
+	char comment[MAX_COMMENT_LENGTH];
+	int live; // state read after it before it's written again
+	int block; // basic block of the layout (-O2), or -1
+};
+
+/* The decoded instructions, from address 0 up to the first word that isn't
+code. Jump targets keep their original addresses until relocation. */
+struct Code {
+	struct Op op[RAM_SIZE];
+	int count; // number of instructions
+	int end; // first address after the code
+	int at[RAM_SIZE]; // instruction at each address, or -1 in operand words
+	int cycles; // cycles saved per execution of the rewritten instructions
+	struct Region block[RAM_SIZE]; // basic blocks of the layout
+	int blocks; // number of basic blocks, or 0 if the layout didn't run
+	const struct Rules *rules; // superoptimizer rules (--rules), or NULL
+};
+
+/* Returns the register in Instr1, or the first one of type 4, or -1. */
+int first_register(const struct Op *o)
+{
+	if (o->k->format == TYPE2) return o->instr1 & 7;
+	if (o->k->format != TYPE4_5) return -1;
+	return o->instr1 & 0x08 ? (o->instr2 >> 4) & 7 : o->instr1 & 7;
+}
+
+/* Returns the second register of type 4, or -1. */
+int second_register(const struct Op *o)
+{
+	return o->k->format == TYPE4_5 && o->instr1 & 0x08 ? o->instr2 & 7 : -1;
+}
+
+/* Returns the state bits of register r; FLAGS covers all flags. */
+int register_state(int r)
+{
+	if (r < 0) return 0;
+	return r == 6 ? REGISTER(6) | ARITHMETIC_FLAGS : REGISTER(r);
+}
+
+/* Returns the state that the instruction may read. Halting, calls and
+returns expose all of it. */
+int reads(const struct Op *o)
+{
+	static const int conditions[4] = {C_FLAG, Z_FLAG, S_FLAG, V_FLAG};
+	int r = register_state(first_register(o));
+	int r2 = register_state(second_register(o));
+	switch (OPCODE(o)) {
+	case HLT_OP:
+	case CALL_OP:
+	case RETURN_OP:
+		return ALL_STATE;
+	case NOP_OP:
+	case JMP_OP:
+		return 0;
+	case PUSH_OP:
+		return r | REGISTER(7);
+	case POP_OP:
+		return REGISTER(7);
+	case MOV_OP:
+	case LOAD_OP:
+		return r2;
+	}
+	if (o->k->format == TYPE3) return conditions[(OPCODE(o) - 4) / 2]; // J<flag>
+	return r | r2; // the ALU operands, or the stored register and address
+}
+
+/* Returns the state that the instruction always writes. When the ALU
+result goes to FLAGS, it takes precedence over the flags of the operation;
+CMP and BIT with FLAGS write back its value, and change nothing. */
+int writes(const struct Op *o)
+{
+	int r = first_register(o);
+	switch (OPCODE(o)) {
+	case PUSH_OP:
+		return REGISTER(7);
+	case POP_OP:
+		return register_state(r) | REGISTER(7);
+	case MOV_OP:
+	case LOAD_OP:
+		return register_state(r);
+	case ADD_OP:
+	case SUB_OP:
+	case LSHIFT_OP:
+	case RSHIFT_OP:
+		return register_state(r) | ARITHMETIC_FLAGS;
+	case AND_OP:
+	case OR_OP:
+	case XOR_OP:
+	case ROR_OP:
+		return register_state(r) | Z_FLAG | S_FLAG;
+	case CMP_OP:
+		return r == 6 ? 0 : ARITHMETIC_FLAGS;
+	case BIT_OP:
+		return r == 6 ? 0 : Z_FLAG | S_FLAG;
+	}
+	return 0;
+}
+
+/* Returns 1 if the instruction has no effect other than writing registers
+and flags. */
+char pure(const struct Op *o)
+{
+	int op = OPCODE(o);
+	return op != STORE_OP && (o->k->format == TYPE4_5
+		|| op == LSHIFT_OP || op == RSHIFT_OP);
+}
+
+/* Returns 1 if the instruction can continue to the next one. */
+char falls(const struct Op *o)
+{
+	int op = OPCODE(o);
+	return op != HLT_OP && op != JMP_OP && op != RETURN_OP;
+}
+
+/* Returns the first instruction at or after instruction i that isn't
+removed, or c->count if the code ends before it. */
+int follow(const struct Code *c, int i)
+{
+	while (i < c->count && c->op[i].removed) i++;
+	return i;
+}
+
+/* Returns the instruction that follows instruction i, or c->count. */
+int after(const struct Code *c, int i)
+{
+	return follow(c, i + 1);
+}
+
+/* Returns the instruction at the target of a jump or call, c->count if the
+removed instructions at the end of the code lead to it, or -1 if the target
+is outside the code. */
+int target(const struct Code *c, const struct Op *o)
+{
+	return o->instr2 < c->end ? follow(c, c->at[o->instr2]) : -1;
+}
+
+/* Returns the state that is read at the start of instruction i. Leaving the
+code, whether through a jump or into the unused words after it, which halt
+the computer, exposes all of it. */
+int entry(const struct Code *c, int i)
+{
+	if (i < 0 || i >= c->count) return ALL_STATE;
+	const struct Op *o = &c->op[i];
+	return reads(o) | (o->live & ~writes(o));
+}
+
+/* Computes the state that is live after each instruction, backwards until
+no set changes. */
+void liveness(struct Code *c)
+{
+	char changed = 1;
+	for (int i = 0; i < c->count; i++) c->op[i].live = 0;
+	while (changed) {
+		changed = 0;
+		for (int i = c->count - 1; i >= 0; i--) {
+			struct Op *o = &c->op[i];
+			int live = 0;
+			if (o->removed) continue;
+			if (falls(o)) live |= entry(c, after(c, i));
+			if (o->k->format == TYPE3 && OPCODE(o) != CALL_OP) {
+				live |= entry(c, target(c, o));
+			}
+			if (live != o->live) {
+				o->live = live;
+				changed = 1;
+			}
+		}
+	}
+}
+
+/* Returns 1 if a jump or call leads to instruction i. */
+char targeted(const struct Code *c, int i)
+{
+	for (int j = 0; j < c->count; j++) {
+		const struct Op *o = &c->op[j];
+		if (!o->removed && o->k->format == TYPE3 && target(c, o) == i) return 1;
+	}
+	return 0;
+}
+
+/* Returns 1 if the subroutine at instruction i returns on all its paths with
+the stack as it found it, never pops below its entry or accesses the stack
+pointer explicitly, and calls only such subroutines, so that it behaves the
+same at any stack depth. verdict memoizes the subroutines that are checked:
+1 while being checked, which assumes recursive calls are balanced, 2 if
+balanced, or 3 if not. */
+char balanced(const struct Code *c, int i, char *verdict)
+{
+	int depth[RAM_SIZE]; // stack depth at each instruction, or -1
+	int work[RAM_SIZE]; // instructions to visit
+	int n = 0;
+	char ok = 1;
+	if (verdict[i]) return verdict[i] != 3;
+	verdict[i] = 1;
+	for (int j = 0; j < c->count; j++) depth[j] = -1;
+	depth[i] = 0;
+	work[n++] = i;
+	while (ok && n) {
+		int j = work[--n];
+		const struct Op *o = &c->op[j];
+		int d = depth[j];
+		int next[2] = {after(c, j), 0}; // successors
+		int successors = 1;
+		int t = o->k->format == TYPE3 ? target(c, o) : -1;
+		if (first_register(o) == 7 || second_register(o) == 7) {
+			ok = 0;
+			break;
+		}
+		switch (OPCODE(o)) {
+		case PUSH_OP:
+			d++;
+			break;
+		case POP_OP:
+			if (--d < 0) ok = 0;
+			break;
+		case RETURN_OP:
+			if (d) ok = 0;
+			continue;
+		case HLT_OP:
+			continue;
+		case CALL_OP:
+			if (t < 0 || t >= c->count || !balanced(c, t, verdict)) ok = 0;
+			break;
+		case JMP_OP:
+			next[0] = t;
+			break;
+		default:
+			if (o->k->format == TYPE3) next[successors++] = t; // J<flag>
+		}
+		for (int k = 0; ok && k < successors; k++) {
+			int s = next[k];
+			if (s < 0 || s >= c->count || d >= RAM_SIZE) {
+				ok = 0; // leaves the code
+			} else if (depth[s] < 0) {
+				depth[s] = d;
+				work[n++] = s;
+			} else if (depth[s] != d) {
+				ok = 0; // unbalanced loop or join
+			}
+		}
+	}
+	verdict[i] = ok ? 2 : 3;
+	return ok;
+}
+
+/* Returns 1 if return addresses are used only by RETURNs, so that moving the
+code doesn't change the values of the program: all calls go to balanced
+subroutines, and no RETURN is reached from address 0 outside them, such as
+a computed jump by PUSH and RETURN. */
+char disciplined(const struct Code *c)
+{
+	char verdict[RAM_SIZE] = {0};
+	char seen[RAM_SIZE] = {0};
+	int work[RAM_SIZE]; // instructions to visit from address 0
+	int n = 0;
+	for (int i = 0; i < c->count; i++) {
+		const struct Op *o = &c->op[i];
+		if (OPCODE(o) != CALL_OP) continue;
+		int t = target(c, o);
+		if (t < 0 || t >= c->count || !balanced(c, t, verdict)) return 0;
+	}
+	seen[0] = 1;
+	work[n++] = 0;
+	while (n) {
+		const struct Op *o = &c->op[work[--n]];
+		int next[2] = {falls(o) ? after(c, work[n]) : -1, -1};
+		if (OPCODE(o) == RETURN_OP) return 0;
+		if (o->k->format == TYPE3 && OPCODE(o) != CALL_OP) next[1] = target(c, o);
+		for (int k = 0; k < 2; k++) {
+			int s = next[k];
+			if (s >= 0 && s < c->count && !seen[s]) {
+				seen[s] = 1;
+				work[n++] = s;
+			}
+		}
+	}
+	return 1;
+}
+
+/* Changes the opcode of an instruction, whose comment is then disassembled
+from its words with the name of the new opcode. */
+void recode(struct Op *o, int instr1)
+{
+	o->instr1 = (unsigned char) instr1;
+	o->k = decode(instr1);
+	o->size = o->k->size;
+	o->comment[0] = '\0';
+	o->word[0].mnemonic = o->word[1].mnemonic = 0;
+}
+
+/* Removes an instruction. */
+void drop(struct Code *c, int i)
+{
+	c->op[i].removed = 1;
+	c->cycles++;
+}
+
+/* Pure instructions whose writes are overwritten before being read, such as
+a MOV followed by another one to the same register, or a CMP whose flags
+aren't tested. */
+char dead_code(struct Code *c, int i)
+{
+	const struct Op *o = &c->op[i];
+	if (!pure(o) || writes(o) & o->live) return 0;
+	drop(c, i);
+	return 1;
+}
+
+/* MOV r, r */
+char self_move(struct Code *c, int i)
+{
+	const struct Op *o = &c->op[i];
+	if (OPCODE(o) != MOV_OP || second_register(o) != first_register(o)) return 0;
+	drop(c, i);
+	return 1;
+}
+
+/* A jump to the next instruction, taken or not. */
+char skip_jump(struct Code *c, int i)
+{
+	const struct Op *o = &c->op[i];
+	if (o->k->format != TYPE3 || OPCODE(o) == CALL_OP) return 0;
+	if (target(c, o) != after(c, i)) return 0;
+	drop(c, i);
+	return 1;
+}
+
+/* A jump or call to an unconditional JMP goes to its target instead, one
+cycle less for each JMP that is bypassed. */
+char thread_jump(struct Code *c, int i)
+{
+	struct Op *o = &c->op[i];
+	char seen[RAM_SIZE] = {0};
+	int hops = 0;
+	int dest = o->instr2;
+	if (o->k->format != TYPE3) return 0;
+	int t = target(c, o);
+	while (t >= 0 && t < c->count && OPCODE(&c->op[t]) == JMP_OP) {
+		if (seen[t]) return 0; // a loop of jumps never leaves
+		seen[t] = 1;
+		dest = c->op[t].instr2;
+		t = target(c, &c->op[t]);
+		hops++;
+	}
+	if (!hops) return 0;
+	o->instr2 = (unsigned char) dest;
+	c->cycles += hops;
+	return 1;
+}
+
+/* JMP to a RETURN returns instead. */
+char jump_to_return(struct Code *c, int i)
+{
+	struct Op *o = &c->op[i];
+	if (OPCODE(o) != JMP_OP) return 0;
+	int t = target(c, o);
+	if (t < 0 || t >= c->count || OPCODE(&c->op[t]) != RETURN_OP) return 0;
+	recode(o, RETURN_OP);
+	o->word[0].type = INSTRUCTION_WORD;
+	c->cycles++;
+	return 1;
+}
+
+/* J<flag> over a JMP becomes JN<flag> to the JMP's target:
+	JZ skip      =>  JNZ far
+	JMP far
+	skip: */
+char invert_jump(struct Code *c, int i)
+{
+	struct Op *o = &c->op[i];
+	int j = after(c, i);
+	if (o->k->format != TYPE3 || OPCODE(o) == JMP_OP || OPCODE(o) == CALL_OP
+		|| j >= c->count || OPCODE(&c->op[j]) != JMP_OP || targeted(c, j)
+		|| target(c, o) != after(c, j)) return 0;
+	recode(o, o->instr1 ^ 1); // the conditions alternate with their negations
+	o->instr2 = c->op[j].instr2;
+	drop(c, j);
+	return 1;
+}
+
+/* CALL followed by RETURN jumps to the subroutine, which then returns to
+the caller's caller directly; the RETURN stays if it's also a jump target.
+Each execution saves the RETURN, while the JMP takes the single cycle of the
+CALL. The JMP doesn't push the return address, so the stack word below the
+pointer keeps its old value, unlike after a run of the original program;
+such words are regarded as free. */
+char tail_call(struct Code *c, int i)
+{
+	struct Op *o = &c->op[i];
+	char verdict[RAM_SIZE] = {0};
+	int j = after(c, i);
+	if (OPCODE(o) != CALL_OP || j >= c->count
+		|| OPCODE(&c->op[j]) != RETURN_OP) return 0;
+	int t = target(c, o);
+	if (t < 0 || t >= c->count || !balanced(c, t, verdict)) return 0;
+	recode(o, JMP_OP);
+	if (targeted(c, j)) {
+		c->cycles++; // the RETURN is still reached by the jumps to it
+	} else {
+		drop(c, j);
+	}
+	return 1;
+}
+
+/* A test of a register right after an ALU operation that wrote it, whose
+Z and S flags are already set by the operation:
+	ADD R0, R1   =>  ADD R0, R1
+	CMP R0, 0        JZ zero
+	JZ zero
+Tests with ADD, SUB or CMP by 0 also set C and V, so they go only if C and V
+aren't read. */
+char redundant_test(struct Code *c, int i)
+{
+	const struct Op *o = &c->op[i];
+	int j = after(c, i);
+	int r = first_register(o);
+	int op = OPCODE(o);
+	if (!pure(o) || op == MOV_OP || op == LOAD_OP || op == CMP_OP
+		|| op == BIT_OP || r < 0 || r > 5 || j >= c->count || targeted(c, j)) {
+		return 0;
+	}
+	const struct Op *test = &c->op[j];
+	int n = test->instr2;
+	if (first_register(test) != r) return 0;
+	if (second_register(test) >= 0) {
+		// AND, OR and BIT with itself
+		op = OPCODE(test);
+		if (second_register(test) != r
+			|| (op != AND_OP && op != OR_OP && op != BIT_OP)) return 0;
+	} else {
+		switch (OPCODE(test)) {
+		case AND_OP:
+		case BIT_OP:
+			if (n != 0xFF) return 0;
+			break;
+		case OR_OP:
+		case XOR_OP:
+		case ROR_OP:
+			if (n) return 0;
+			break;
+		case ADD_OP:
+		case SUB_OP:
+		case CMP_OP:
+			if (n || test->live & (C_FLAG | V_FLAG)) return 0;
+			break;
+		default:
+			return 0;
+		}
+	}
+	drop(c, j);
+	return 1;
+}
+
+/* Binds the pattern registers of p to the registers of instruction o, or
+returns 0 if o doesn't match p. Numbers must be constants, as the values of
+code and .DATA labels can change. */
+char match_pattern(const struct Op *o, const struct Pattern *p, int *bound)
+{
+	int r[2] = {first_register(o), second_register(o)};
+	int reg[2] = {p->reg, p->reg2};
+	if (OPCODE(o) != p->op || r[0] > 5 || r[1] > 5
+		|| (r[1] < 0) != (p->reg2 < 0) || (o->k->format == TYPE4_5 && r[1] < 0
+		&& (o->instr2 != p->n || o->word[1].relocation != ABSOLUTE_VALUE))) {
+		return 0;
+	}
+	for (int k = 0; k < 2 && reg[k] >= 0; k++) {
+		if (bound[reg[k]] < 0 && bound[!reg[k]] != r[k]) bound[reg[k]] = r[k];
+		if (bound[reg[k]] != r[k]) return 0;
+	}
+	return 1;
+}
+
+/* A window of instructions that a rule of the superoptimizer's database
+rewrites into fewer cycles or words, where the flags that it may change are
+overwritten before being read:
+	XOR R0, R0   =>  MOV R0, 0     if Z and S aren't read */
+char superoptimized(struct Code *c, int i)
+{
+	int op = c->op[i].instr1 >> 4;
+	for (int n = c->rules ? c->rules->first[op] : 0;
+		c->rules && n < c->rules->first[op + 1]; n++) {
+		const struct Rule *r = &c->rules->rule[n];
+		int window[RULE_LENGTH];
+		int bound[PATTERN_REGISTERS] = {-1, -1};
+		int j = i, k = 0;
+		for (; k < r->length && j < c->count; k++, j = after(c, j)) {
+			if (!match_pattern(&c->op[j], &r->from[k], bound)) break;
+			window[k] = j;
+		}
+		if (k < r->length) continue;
+		int live = c->op[window[k - 1]].live;
+		if ((r->dead & CARRY && live & C_FLAG) || (r->dead & ZERO
+			&& live & Z_FLAG) || (r->dead & SIGN && live & S_FLAG)
+			|| (r->dead & OVERFLOW && live & V_FLAG)) continue;
+		for (k = 1; k < r->length && !targeted(c, window[k]); k++);
+		if (k < r->length) continue;
+		for (k = 0; k < r->size; k++) {
+			struct Op *o = &c->op[window[k]];
+			int instr2; // the window binds the registers of its replacement
+			recode(o, encode_pattern(&r->to[k], bound, &instr2));
+			o->instr2 = (unsigned char) instr2;
+			o->word[1] = o->word[0];
+			o->word[1].type = OPERAND_WORD;
+			o->word[1].label = 0;
+			o->word[1].relocation = ABSOLUTE_VALUE;
+		}
+		for (; k < r->length; k++) drop(c, window[k]);
+		return 1;
+	}
+	return 0;
+}
+
+/* Applies the first rule that matches an instruction. Returns 0 if none
+does. */
+char rewrite(struct Code *c)
+{
+	liveness(c);
+	for (int i = 0; i < c->count; i++) {
+		if (c->op[i].removed) continue;
+		if (dead_code(c, i) || self_move(c, i) || skip_jump(c, i)
+			|| thread_jump(c, i) || jump_to_return(c, i) || invert_jump(c, i)
+			|| tail_call(c, i) || redundant_test(c, i)
+			|| superoptimized(c, i)) return 1;
+	}
+	return 0;
+}
+
+/* Decodes the code of the RAM image. Returns 0 if the program can't be
+optimized safely: it takes the address of a code label in a value operand,
+computes addresses with expressions or keeps them in .DATA, loads or stores
+the code directly, jumps into an operand word, falls from its last
+instruction into .DATA, uses return addresses as values, or places its words
+with .ORG or .ALIGN. */
+char decode_code(const struct Assembler *as, struct Code *c)
+{
+	const struct OutputHeader *Out = &as->Out;
+	int addr = 0;
+	c->count = 0;
+	c->cycles = 0;
+	c->blocks = 0;
+	for (; addr < RAM_SIZE; addr++) {
+		const struct WordInfo *w = &Out->word[addr];
+		if (Out->skipped[addr]) return 0;
+		if (w->relocation == ADDRESS_VALUE
+			&& (!w->label || w->type == DATA_WORD)) return 0;
+	}
+	addr = 0;
+	while (addr < RAM_SIZE && Out->word[addr].type == INSTRUCTION_WORD) {
+		struct Op *o = &c->op[c->count];
+		memset(o, 0, sizeof(*o));
+		o->addr = (unsigned char) addr;
+		o->block = -1;
+		o->instr1 = Out->mem[addr];
+		o->k = decode(o->instr1);
+		if (!o->k) return 0;
+		o->size = o->k->size;
+		o->word[0] = Out->word[addr];
+		if (o->size > 1) {
+			o->instr2 = Out->mem[addr + 1];
+			o->word[1] = Out->word[addr + 1];
+		}
+		strcpy(o->comment, Out->comment[addr + o->size - 1]);
+		c->at[addr] = c->count++;
+		if (o->size > 1) c->at[addr + 1] = -1;
+		addr += o->size;
+	}
+	c->end = addr;
+	for (; addr < RAM_SIZE; addr++) {
+		if (Out->word[addr].type != DATA_WORD
+			&& Out->word[addr].type != UNUSED_WORD) return 0;
+	}
+	for (int i = 0; i < c->count; i++) {
+		const struct Op *o = &c->op[i];
+		if (o->k->format == TYPE3) {
+			if (o->instr2 < c->end && c->at[o->instr2] < 0) return 0;
+		} else if (o->k->format == TYPE4_5 && !(o->instr1 & 0x08)) {
+			int l = o->word[1].label - 1;
+			if (l >= 0 && as->Out.label[l].kind == CODE_LABEL) return 0;
+			if (o->k->bracketed && o->instr2 < c->end) return 0;
+		}
+	}
+	return c->count && !(falls(&c->op[c->count - 1]) && c->end < RAM_SIZE
+		&& Out->word[c->end].type != UNUSED_WORD) && disciplined(c);
+}
+
+/* Marks block b as reached from address 0, to visit its successors. */
+void reach(char *reached, int *work, int *n, int b)
+{
+	if (b < 0 || reached[b]) return;
+	reached[b] = 1;
+	work[(*n)++] = b;
+}
+
+/* Returns the first code label at the address range [from, from + size),
+or -1. */
+int code_label(const struct Assembler *as, int from, int size)
+{
+	for (int i = 0; i < as->Out.labels; i++) {
+		const struct LabelElement *l = &as->Out.label[i];
+		if (l->kind == CODE_LABEL && l->val >= from && l->val < from + size) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* Splits the code into basic blocks, removes the ones that can't be reached
+from address 0, and reorders the rest so that unconditional jumps lead to
+the next block, for skip_jump to remove them. A block that falls through,
+including into the return address of its CALL, stays followed by its
+successor; a J<flag> costs the same cycle either way, so it isn't turned
+around. The JMPs of the deepest loops, which run most often, get their
+targets first. Returns 0, leaving the code as it is, if a jump leaves the
+code or the last instruction falls out of it. */
+char layout(const struct Assembler *as, struct Code *c)
+{
+	struct Op op[RAM_SIZE]; // the instructions in their new order
+	int leader[RAM_SIZE + 1] = {0}; // 1 at the first instruction of a block
+	int of[RAM_SIZE]; // block of each instruction
+	int head[RAM_SIZE], tail[RAM_SIZE]; // first and last instruction
+	int depth[RAM_SIZE] = {0}; // loops around each block
+	int next[RAM_SIZE], prev[RAM_SIZE]; // chains of blocks laid out in a row
+	int work[RAM_SIZE]; // blocks to visit, and then JMP blocks by heat
+	int order[RAM_SIZE]; // instructions in their new order
+	char reached[RAM_SIZE] = {0};
+	int blocks = 0, last = -1, n = 0;
+	for (int i = 0; i < c->count; i++) {
+		const struct Op *o = &c->op[i];
+		if (o->removed) continue;
+		if (last < 0) leader[i] = 1;
+		last = i;
+		if (o->k->format == TYPE3) {
+			int t = target(c, o);
+			if (t < 0 || t >= c->count) return 0; // leaves the code
+			leader[t] = 1;
+		}
+		if (OPCODE(o) != CALL_OP && (o->k->format == TYPE3 || !falls(o))) {
+			leader[after(c, i)] = 1;
+		}
+	}
+	if (last < 0 || falls(&c->op[last])) return 0;
+	for (int i = 0; i <= last; i++) {
+		if (c->op[i].removed) continue;
+		if (leader[i]) head[blocks++] = i;
+		of[i] = blocks - 1;
+		tail[blocks - 1] = i;
+	}
+	for (int i = last; i >= 0; i--) {
+		// removed instructions lead to the block of the next one
+		if (c->op[i].removed) of[i] = of[follow(c, i)];
+	}
+
+	// blocks reached from address 0 through jumps, calls and fall-through
+	reach(reached, work, &n, 0);
+	while (n) {
+		int b = work[--n];
+		for (int i = head[b]; i <= tail[b]; i = after(c, i)) {
+			const struct Op *o = &c->op[i];
+			if (o->k->format == TYPE3) {
+				reach(reached, work, &n, of[target(c, o)]);
+			}
+		}
+		if (falls(&c->op[tail[b]])) reach(reached, work, &n, b + 1);
+	}
+	// a jump back to an earlier block closes a loop around the blocks between
+	for (int b = 0; b < blocks; b++) {
+		const struct Op *o = &c->op[tail[b]];
+		next[b] = prev[b] = -1;
+		if (!reached[b] || o->k->format != TYPE3 || OPCODE(o) == CALL_OP) {
+			continue;
+		}
+		for (int k = of[target(c, o)]; k <= b; k++) depth[k]++;
+	}
+
+	// chain each block to the one it falls into, and then the JMPs by heat
+	for (int b = 0; b < blocks; b++) {
+		if (!reached[b]) continue;
+		if (falls(&c->op[tail[b]])) {
+			next[b] = b + 1;
+			prev[b + 1] = b;
+		} else if (OPCODE(&c->op[tail[b]]) == JMP_OP) {
+			int k = n++;
+			for (; k > 0 && depth[work[k - 1]] < depth[b]; k--) {
+				work[k] = work[k - 1];
+			}
+			work[k] = b;
+		}
+	}
+	for (int k = 0; k < n; k++) {
+		int b = work[k];
+		int x = of[target(c, &c->op[tail[b]])];
+		int h = b; // first block of b's chain
+		while (prev[h] >= 0) h = prev[h];
+		if (next[b] >= 0 || prev[x] >= 0 || x == 0 || h == x) continue;
+		next[b] = x;
+		prev[x] = b;
+	}
+
+	// the chains in source order, from address 0, and then the rest
+	n = 0;
+	for (int b = 0; b < blocks; b++) {
+		if (!reached[b] || prev[b] >= 0) continue;
+		for (int k = b; k >= 0; k = next[k]) {
+			for (int i = k ? tail[k - 1] + 1 : 0; i <= tail[k]; i++) {
+				order[n++] = i;
+			}
+		}
+	}
+	for (int b = 0; b < blocks; b++) {
+		if (reached[b]) continue;
+		for (int i = b ? tail[b - 1] + 1 : 0; i <= tail[b]; i++) {
+			c->op[i].removed = 1; // unreachable, so it saves no cycles
+			order[n++] = i;
+		}
+	}
+	for (int i = last + 1; i < c->count; i++) order[n++] = i;
+
+	for (int b = 0; b < blocks; b++) {
+		struct Region *r = &c->block[b];
+		int first = b ? tail[b - 1] + 1 : 0;
+		r->kind = CODE_REGION;
+		r->from = c->op[first].addr;
+		r->to = -1;
+		r->size = c->op[tail[b]].addr + c->op[tail[b]].size - r->from;
+		r->label = code_label(as, r->from, r->size);
+		r->line = c->op[first].word[0].line;
+	}
+	for (int i = 0; i < c->count; i++) {
+		op[i] = c->op[order[i]];
+		op[i].block = order[i] <= last ? of[order[i]] : -1;
+	}
+	for (int i = 0; i < c->count; i++) {
+		c->op[i] = op[i];
+		c->at[op[i].addr] = i;
+	}
+	c->blocks = blocks;
+	return 1;
+}
+
+/* Moves the remaining instructions down over the removed ones, relocates
+the jumps and the code labels, and writes them back to the RAM image, along
+with the regions of the basic blocks if they were laid out. Returns the
+first address after the code. */
+int relocate(struct Assembler *as, struct Code *c)
+{
+	struct OutputHeader *Out = &as->Out;
+	int placed[RAM_SIZE + 1]; // new address of each instruction
+	int words[RAM_SIZE] = {0}; // words of each block
+	int addr = 0;
+	for (int i = 0; i < c->count; i++) {
+		placed[i] = addr; // removed ones are placed at the next one
+		if (!c->op[i].removed) addr += c->op[i].size;
+	}
+	placed[c->count] = addr;
+	for (addr = 0; addr < c->end; addr++) {
+		Out->mem[addr] = 0;
+		memset(&Out->word[addr], 0, sizeof(Out->word[addr]));
+		Out->comment[addr][0] = '\0';
+	}
+	for (int i = 0; i < c->count; i++) {
+		struct Op *o = &c->op[i];
+		if (o->removed) continue;
+		addr = placed[i];
+		if (o->block >= 0) {
+			if (!words[o->block]) c->block[o->block].to = addr;
+			words[o->block] += o->size;
+		}
+		if (o->k->format == TYPE3 && o->instr2 < c->end) {
+			o->instr2 = (unsigned char) placed[c->at[o->instr2]];
+		}
+		if (o->k->format == TYPE3) renumber(o->comment, o->instr2, 0);
+		Out->mem[addr] = o->instr1;
+		Out->word[addr] = o->word[0];
+		if (o->size > 1) {
+			Out->mem[addr + 1] = o->instr2;
+			Out->word[addr + 1] = o->word[1];
+		}
+		strcpy(Out->comment[addr + o->size - 1], o->comment);
+	}
+	for (int i = 0; i < Out->labels; i++) {
+		struct LabelElement *l = &Out->label[i];
+		if (l->kind == CODE_LABEL && l->val < c->end) {
+			l->val = (unsigned char) placed[c->at[l->val]];
+		}
+	}
+	for (int b = 0; b < c->blocks; b++) {
+		// removed blocks keep their size in the source
+		if (words[b]) c->block[b].size = words[b];
+		Out->region[Out->regions++] = c->block[b];
+	}
+	Out->saved_words = c->end - placed[c->count];
+	Out->saved_cycles = c->cycles;
+	return placed[c->count];
+}
+
+/* Records the .DATA arrays and .RESERVE buffers as regions that stay where
+they are, for the memory map. */
+void keep_data(struct Assembler *as)
+{
+	struct OutputHeader *Out = &as->Out;
+	for (int i = 0; i < Out->labels; i++) {
+		const struct LabelElement *l = &Out->label[i];
+		if ((l->kind != DATA_LABEL && l->kind != RESERVED_LABEL)
+			|| l->size <= 0) continue;
+		struct Region r = {l->kind == DATA_LABEL ? DATA_REGION
+			: RESERVED_REGION, l->val, l->val, l->size, i,
+			as->In.tokens[l->token].line};
+		Out->region[Out->regions++] = r;
+	}
+}
+
+/* Moves the .DATA arrays from address 'from' down to address 'end' after
+the code, without the ones that no instruction or .MONITOR refers to, and
+the .RESERVE buffers after them, and relocates the operands that hold their
+labels. The data stays where it is if a bracketed address or a .MONITOR
+without a label points into it or its buffers, as it can't be told apart
+from a constant. */
+void pack_data(struct Assembler *as, int from, int end)
+{
+	struct OutputHeader *Out = &as->Out;
+	uint8_t mem[RAM_SIZE];
+	struct WordInfo word[RAM_SIZE];
+	char comment[RAM_SIZE][MAX_COMMENT_LENGTH];
+	char used[RAM_SIZE] = {0}; // 1 at the start of a referenced array
+	int monitor = Out->monitor_label - 1; // label of the .MONITOR, or -1
+	int top = from; // first address after the data
+	int last = from; // first address after the data and the buffers
+	while (top < RAM_SIZE && Out->word[top].type == DATA_WORD) top++;
+	for (int i = 0; i < Out->labels; i++) {
+		const struct LabelElement *l = &Out->label[i];
+		if (l->kind == RESERVED_LABEL && l->val + l->size > last) {
+			last = l->val + l->size;
+		}
+	}
+	if (last < top) last = top;
+	for (int addr = 1; addr < end; addr++) {
+		int l = Out->word[addr].label - 1;
+		if (Out->word[addr].type != OPERAND_WORD) continue;
+		if (l >= 0 && Out->label[l].kind == DATA_LABEL) {
+			used[Out->label[l].val] = 1;
+		} else if (l >= 0 && Out->label[l].kind == RESERVED_LABEL) {
+			continue;
+		} else if (decode(Out->mem[addr - 1])->bracketed
+			&& !(Out->mem[addr - 1] & 0x08)
+			&& Out->mem[addr] >= from && Out->mem[addr] < last) {
+			keep_data(as);
+			return;
+		}
+	}
+	if (monitor >= 0 && Out->label[monitor].kind == DATA_LABEL) {
+		used[Out->label[monitor].val] = 1;
+	} else if (monitor < 0 || Out->label[monitor].kind != RESERVED_LABEL) {
+		if (Out->monitor >= from && Out->monitor < last) {
+			keep_data(as);
+			return;
+		}
+	}
+
+	for (int addr = from; addr < top; addr++) {
+		mem[addr] = Out->mem[addr];
+		word[addr] = Out->word[addr];
+		strcpy(comment[addr], Out->comment[addr]);
+		Out->mem[addr] = 0;
+		memset(&Out->word[addr], 0, sizeof(Out->word[addr]));
+		Out->comment[addr][0] = '\0';
+	}
+	int addr = end;
+	for (int i = 0; i < Out->labels; i++) {
+		struct LabelElement *l = &Out->label[i];
+		if (l->kind != DATA_LABEL) continue;
+		int stop = top; // first address after the array
+		for (int j = i + 1; j < Out->labels; j++) {
+			if (Out->label[j].kind == DATA_LABEL) {
+				stop = Out->label[j].val;
+				break;
+			}
+		}
+		struct Region r = {DATA_REGION, l->val, addr, stop - l->val, i,
+			as->In.tokens[l->token].line};
+		if (used[l->val]) {
+			for (int a = l->val; a < stop; a++, addr++) {
+				Out->mem[addr] = mem[a];
+				Out->word[addr] = word[a];
+				strcpy(Out->comment[addr], comment[a]);
+			}
+			l->val = (unsigned char) r.to;
+		} else {
+			r.to = -1;
+			Out->saved_words += r.size;
+		}
+		Out->region[Out->regions++] = r;
+	}
+	// the buffers have no words to move, only their labels
+	for (int i = 0; i < Out->labels; i++) {
+		struct LabelElement *l = &Out->label[i];
+		if (l->kind != RESERVED_LABEL || l->size <= 0) continue;
+		struct Region r = {RESERVED_REGION, l->val, addr, l->size, i,
+			as->In.tokens[l->token].line};
+		l->val = (unsigned char) addr;
+		addr += l->size;
+		Out->region[Out->regions++] = r;
+	}
+	for (addr = 1; addr < end; addr++) {
+		int l = Out->word[addr].label - 1;
+		if (Out->word[addr].type != OPERAND_WORD || l < 0
+			|| (Out->label[l].kind != DATA_LABEL
+			&& Out->label[l].kind != RESERVED_LABEL)) continue;
+		Out->mem[addr] = Out->label[l].val;
+		renumber(Out->comment[addr], Out->mem[addr],
+			decode(Out->mem[addr - 1])->bracketed);
+	}
+	if (monitor >= 0 && (Out->label[monitor].kind == DATA_LABEL
+		|| Out->label[monitor].kind == RESERVED_LABEL)) {
+		Out->monitor = Out->label[monitor].val;
+	}
+}
+
+void optimize(struct Assembler *as)
+{
+	struct Code c;
+	if (!decode_code(as, &c)) return;
+	c.rules = as->rules;
+	while (rewrite(&c));
+	char laid = as->optimize > 1 && layout(as, &c);
+	if (laid) while (rewrite(&c));
+	int end = relocate(as, &c);
+	if (laid) pack_data(as, c.end, end);
+}
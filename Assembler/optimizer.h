@@ -0,0 +1,25 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Optimizer headers
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "data_structures.h"
+
+/* Rewrites wasteful instruction patterns of the translated RAM image, moves
+the following instructions down over the freed words, and relocates the
+jumps and code labels. Registers, flags and memory outside the code are left
+as the original program leaves them; words below the stack pointer are
+regarded as free, and the code as unobservable. Programs that take the
+address of a code label in a value operand, load or store words of the code
+directly, or use return addresses other than by RETURN, are left unchanged.
+At level 2 (-O2), the basic blocks of the code are then laid out by its
+control flow: blocks unreachable from address 0 are removed, jumps are
+turned into fall-throughs, and the .DATA arrays that no operand or .MONITOR
+refers to by label are removed, while the rest move down to the end of the
+code, leaving the freed words to the stack. The moved and removed blocks and
+arrays are recorded in Out.region. The words and the cycles per execution
+saved are recorded in Out.saved_words and Out.saved_cycles. */
+void optimize(struct Assembler *as);
+
+#endif
@@ -5,67 +5,58 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
 
 #include "parse_functions.h"
+#include "isa.h"
 #include "error_handler.h"
 #include "data_structures.h"
 #include "config.h"
 
-/* Converts a string to uppercase, excluding quoted parts
-taking into account escaped quotes. */
-void uppercase(char *s)
+int hexdigit(char c)
 {
-	if (!s || !*s) return; // ignore NULL or empty strings
-	*s = (char)toupper(*s); // first character
-	char quoted = 0; // flag
-	for (s++; *s; s++) {
-		if (s[-1] != '\\' && s[0] == '"') { // \" = escaped quote
-			 quoted = !quoted;
-		}
-		if (!quoted) *s = (char)toupper(*s);
-	}
+	if (c >= '0' && c <= '9') return c - '0';
+	c = (char)toupper((unsigned char)c);
+	return c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
 }
 
 int number(const char *s)
 {
 	if (!s) return -1;
-	int n; // converted value (or negative error code)
-	char valid[MAX_LINE_LENGTH]; // for sscanf masking -- valid digits
-	char invalid[MAX_LINE_LENGTH]; // for sscanf masking -- invalid characters
-	char S[MAX_LINE_LENGTH]; // uppercase version of the parameter
+	int n = 0; // converted value (or negative error code)
+	int digits = 0; // number of valid digits
 	char negative = 0; // is the input negative ?
-	strcpy(S,s);
-	uppercase(S);
 	// check if input is negative
-	if (S[0] == '-') {
+	if (s[0] == '-') {
 		negative = 1;
-		memmove(S, S+1, strlen(S)); // remove the minus
+		s++; // skip the minus
 	}
-	// extract the valid digits of the parameter and convert it
-	// according to its prefix
-	if (!strncmp(S, "0X", 2)) {
+	// convert the digits according to the prefix; the whole string must be
+	// valid, so that no copies are needed, whatever its length
+	if (s[0] == '0' && toupper((unsigned char)s[1]) == 'X') {
 		// Hexadecimal format, up to 2 digits
-		if (sscanf(S, "0X%2[0-9A-F]%[^\n]", valid, invalid) != 1) {
-			return HEX_ERROR;
+		for (s += 2; digits < 2 && hexdigit(*s) >= 0; s++, digits++) {
+			n = 16 * n + hexdigit(*s);
 		}
-		n = (int)strtol(valid, NULL, 16);
-	} else if (!strncmp(S, "0B", 2)) {
+		if (!digits || *s) return HEX_ERROR;
+	} else if (s[0] == '0' && toupper((unsigned char)s[1]) == 'B') {
 		// Binary format, up to 8 digits
-		if (sscanf(S, "0B%8[01]%[^\n]", valid, invalid) != 1) {
-			return BIN_ERROR;
+		for (s += 2; digits < 8 && (*s == '0' || *s == '1'); s++, digits++) {
+			n = 2 * n + (*s - '0');
 		}
-		n = (int)strtol(valid, NULL, 2);
+		if (!digits || *s) return BIN_ERROR;
 	} else {
 		// Decimal format
-		if (sscanf(S, "%[0-9]%[^0-9]", valid, invalid) != 1) {
-			return NUMBER_ERROR;
+		const char *start = s;
+		for (; isdigit((unsigned char)*s); s++) {
+			if (n <= 255) n = 10 * n + (*s - '0'); // saturate above 255
 		}
-		if (S[0] == '0' && strlen(S) > 1) {
+		if (s == start || *s) return NUMBER_ERROR;
+		if (start[0] == '0' && s - start > 1) {
 			// trailing zero is not accepted because it signifies
 			// octal numbers in GNU-assembly
 			return OCTAL_ERROR;
 		}
-		n = (int)strtol(S, NULL, 10);
 	}
 	if (n > 0 && negative) {
 		if (n > 128) return SIGNED_RANGE_ERROR; // <= -128
@@ -75,29 +66,23 @@ int number(const char *s)
 	return n;
 }
 
-void trim(char *s)
+const char* trim(const char *s, size_t *n)
 {
-	if (!s || !*s) return;
-	char *start = s;
-	char *end = s; // end of string
+	const char *end = s; // end of the line
+	const char *stop = s + *n;
 	char quoted = 0;
-	while (*end) { // find the terminal or an unquoted semicolon
+	while (end < stop) { // find the end or an unquoted semicolon
 		// flip the quoted flag if the current end is non-escaped quote (\*)
-		if (*end == '"' && (end == start || end[-1] != '\\')) quoted = !quoted;
+		if (*end == '"' && (end == s || end[-1] != '\\')) quoted = !quoted;
 		// stop parsing at comments (non-quoted semicolon)
 		if (!quoted && *end == ';') break;
 		// move to the next character
 		end++;
 	}
-	end--; // terminal = [end+1]
-	while (isspace(*start)) start++; // first non-trimmable up to terminal
-	if (start < end) {
-		while (isspace(*end)) end--; // last non-trimmable
-	}
-	end[1] = '\0'; // terminate after the last non-trimmable
-	// shift the trimmed content to the begin of the string,
-	// +1 for a single character, and +1 for the added terminator
-	memmove(s, start, end - start + 2);
+	while (s < end && isspace((unsigned char)*s)) s++; // first non-trimmable
+	while (end > s && isspace((unsigned char)end[-1])) end--; // last one
+	*n = (size_t)(end - s);
+	return s;
 }
 
 char eq(const char *s1, const char *s2)
@@ -114,94 +99,50 @@ char eq(const char *s1, const char *s2)
 	return !*s1 && !*s2;
 }
 
-char instr_size1(const char *s)
+char instr_size(struct Assembler *as)
 {
-	// search string: space + str + space
-	char search_str[strlen(s)+3];
-	sprintf(search_str, " %s ", s);
-	uppercase(search_str);
-	return (strstr(" HLT NOP RETURN RSHIFT LSHIFT PUSH POP ",search_str) != 0);
+	return TOK->kind == MNEMONIC_TOKEN ? (char) isa[TOK->value].size : 0;
 }
 
-char instr_size2(const char *s)
+char reserved(const char *s)
 {
-	// search string: space + str + space
-	char search_str[strlen(s)+3];
-	sprintf(search_str, " %s ", s);
-	uppercase(search_str);
-	return (strstr(" JMP JC JNC JZ JNZ JS JNS JV JNV CALL MOV ADD SUB ROR AND"
-		" OR XOR STORE LOAD CMP BIT ", search_str) != 0);
+	return keyword(s) != NULL; // instructions and registers
 }
 
-char reserved(const char *s)
+/* Writes the opcode of the current token at the current RAM address if it's
+an instruction of the given format, and returns its size, or 0 otherwise. */
+char instr_format(struct Assembler *as, enum Format format)
 {
-	if (instr_size1(s)) return 1;
-	if (instr_size2(s)) return 1;
-	// search string: space + s + space
-	char search_str[strlen(s)+3];
-	sprintf(search_str, " %s ", s);
-	uppercase(search_str);
-	return (strstr(" R0 R1 R2 R3 R4 R5 R6 R7 SP FLAGS ", search_str) != 0);
+	if (TOK->kind != MNEMONIC_TOKEN) return 0;
+	const struct Keyword *k = &isa[TOK->value];
+	if (k->format != format) return 0;
+	RAM = k->opcode;
+	return (char) k->size;
 }
 
-char instr_noarg(const char *s)
+char instr_noarg(struct Assembler *as)
 {
-	if      (eq(s, "HLT"))    strcpy(RAM, "00000000");
-	else if (eq(s, "NOP"))    strcpy(RAM, "00000001");
-	else if (eq(s, "RETURN")) strcpy(RAM, "11111000");
-	else return 0;
-	return 1;
+	return instr_format(as, TYPE1);
 }
 
-char instr_reg(const char *s)
+char instr_reg(struct Assembler *as)
 {
-	if      (eq(s, "LSHIFT")) strcpy(RAM, "10100");
-	else if (eq(s, "RSHIFT")) strcpy(RAM, "11010");
-	else if (eq(s, "PUSH"))   strcpy(RAM, "11100");
-	else if (eq(s, "POP"))    strcpy(RAM, "11110");
-	else return 0;
-	return 1;
+	return instr_format(as, TYPE2);
 }
 
-char instr_n(const char *s)
+char instr_n(struct Assembler *as)
 {
-	if      (eq(s, "JMP"))  strcpy(RAM, "00000010");
-	else if (eq(s, "JC"))   strcpy(RAM, "00000100");
-	else if (eq(s, "JNC"))  strcpy(RAM, "00000101");
-	else if (eq(s, "JZ"))   strcpy(RAM, "00000110");
-	else if (eq(s, "JNZ"))  strcpy(RAM, "00000111");
-	else if (eq(s, "JS"))   strcpy(RAM, "00001000");
-	else if (eq(s, "JNS"))  strcpy(RAM, "00001001");
-	else if (eq(s, "JV"))   strcpy(RAM, "00001010");
-	else if (eq(s, "JNV"))  strcpy(RAM, "00001011");
-	else if (eq(s, "CALL")) strcpy(RAM, "11101000");
-	else return 0;
-	return 2;
+	return instr_format(as, TYPE3);
 }
 
-char instr_reg_op2(const char *s)
+char instr_reg_op2(struct Assembler *as)
 {
-	if      (eq(s, "MOV"))   strcpy(RAM, "0001");
-	else if (eq(s, "ADD"))   strcpy(RAM, "0010");
-	else if (eq(s, "SUB"))   strcpy(RAM, "0011");
-	else if (eq(s, "AND"))   strcpy(RAM, "0100");
-	else if (eq(s, "OR"))    strcpy(RAM, "0101");
-	else if (eq(s, "XOR"))   strcpy(RAM, "0110");
-	else if (eq(s, "ROR"))   strcpy(RAM, "0111");
-	else if (eq(s, "STORE")) strcpy(RAM, "1000");
-	else if (eq(s, "LOAD"))  strcpy(RAM, "1001");
-	else if (eq(s, "CMP"))   strcpy(RAM, "1011");
-	else if (eq(s, "BIT"))   strcpy(RAM, "1100");
-	else return 0;
-	return 2;
+	return instr_format(as, TYPE4_5);
 }
 
-char load_store(const char *s)
+char load_store(struct Assembler *as)
 {
-	if      (eq(s, "STORE")) strcpy(RAM, "1000");
-	else if (eq(s, "LOAD"))  strcpy(RAM, "1001");
-	else return 0;
-	return 2;
+	return instr_format(as, TYPE4_5) && isa[TOK->value].bracketed ? 2 : 0;
 }
 
 /* <label_char> ::= <letter> | <dec> | "_" */
@@ -211,66 +152,439 @@ char label_char(const char c)
 }
 
 /* <label> ::= <letter> <label_char*> */
-char label(const char *s)
+char label(struct Assembler *as, const char *s)
 {
 	if (!isalpha(s[0])) return 0;
 	for (int i = 1; s[i] != '\0'; i++) {
 		if (!label_char(s[i])) return 0;
 	}
 	// don't allow labels to use reserved words
-	if (reserved(s)) error(RESERVED);
+	if (reserved(s)) error(as, RESERVED);
 	return 1;
 }
 
-/* <array_element> ::= <number> | <quoted_string> */
-char array_element(const char *s)
+/* <array_element> ::= <value> | <quoted_string> */
+char array_element(struct Assembler *as)
 {
-	int len = strlen(s);
-	if (s[0] == '"') {
+	if (TOK->kind == STRING_TOKEN) {
 		// <quoted_string> ::= "\"" <char+> "\""
-		if (len < 3) error(EMPTY_STRING);
-		// the closing quote is handled at nexttoken in data_structures.c
-	} else if (number(s) < 0) {
-		error(ARRAY_ELEMENT);
+		if (strlen(TOKEN) < 3) error(as, EMPTY_STRING);
+	} else if (!expression(TOK)) {
+		error(as, ARRAY_ELEMENT);
+	}
+	return 1;
+}
+
+int literal(struct Assembler *as)
+{
+	return TOK->kind == NUMBER_TOKEN ? TOK->value : -1;
+}
+
+int regnum(struct Assembler *as)
+{
+	return TOK->kind == REGISTER_TOKEN ? TOK->value : -1;
+}
+
+/* Evaluation of an expression. It reads In.tokens directly instead of
+moving the current token, so that .LABEL expressions can be evaluated out of
+line order when other expressions refer to them. */
+struct Evaluation {
+	struct Assembler *as;
+	int next; // index of the next token
+	int address; // value of $
+	enum ErrorCode error; // first error, or NO_ERROR
+	int token; // index of the offending token
+	const int *index; // value of the index i of a .TABLE, or NULL
+};
+
+/* A value and its relocation: 0 if it's absolute, -1 if it's an address of
+the program, the index of a .EXTERN label plus 1 if it's that label plus a
+number, or -2 if it depends on addresses in any other way. The addresses of
+the program are in the section of the code, the .DATA arrays or the
+.RESERVE buffers, which the linker places apart. */
+struct Term {
+	long long n;
+	int relocation;
+	unsigned char section; // enum LabelKind of an address of the program
+};
+
+/* Returns the section of the address of $: that of the .DATA array or the
+.RESERVE buffer that holds it, or else the code. */
+unsigned char section(const struct Assembler *as, int addr)
+{
+	for (int i = 0; i < as->Out.labels; i++) {
+		const struct LabelElement *l = &as->Out.label[i];
+		if ((l->kind == DATA_LABEL || l->kind == RESERVED_LABEL)
+			&& addr >= l->val && addr < l->val + l->size) return l->kind;
+	}
+	return CODE_LABEL;
+}
+
+/* Binary operators by precedence, from the lowest; '<' and '>' are the
+shifts, which are written twice. */
+static const char *const precedence[] = {"|", "^", "&", "<>", "+-", "*/%"};
+
+#define LEVELS (int)(sizeof(precedence) / sizeof(*precedence))
+#define LIMIT 0x7FFFFFFFLL // magnitude of intermediate results
+
+char expression(const struct Token *t)
+{
+	return t->kind == NUMBER_TOKEN || t->kind == SYMBOL_TOKEN
+		|| (t->kind == PUNCTUATION_TOKEN && strchr("(-+~$", t->value));
+}
+
+/* Records the first error of an evaluation at the given token, and returns
+a zero term. */
+struct Term failure(struct Evaluation *e, enum ErrorCode code, int token)
+{
+	struct Term zero = {0, 0, 0};
+	if (!e->error) {
+		e->error = code;
+		e->token = token;
+	}
+	return zero;
+}
+
+/* Returns 1 and moves past the next token if it's the punctuation c. */
+char accept(struct Evaluation *e, char c)
+{
+	const struct Token *t = &e->as->In.tokens[e->next];
+	if (t->kind != PUNCTUATION_TOKEN || t->value != c) return 0;
+	e->next++;
+	return 1;
+}
+
+struct Term operation(struct Evaluation *e, int level);
+
+/* Evaluates the .LABEL expression of label i, unless it refers to itself.
+Returns its value, or -1 if it's invalid or depends on addresses. */
+int resolve_label(struct Assembler *as, int i)
+{
+	struct LabelElement *l = &as->Out.label[i];
+	if (l->state == UNRESOLVED) {
+		struct Evaluation e = {as, l->token + 1, as->Out.addr, NO_ERROR, 0,
+			NULL};
+		l->state = RESOLVING;
+		struct Term t = operation(&e, 0);
+		l->state = e.error || t.relocation || t.n < -128 || t.n > 255
+			|| as->In.tokens[e.next].kind != END_TOKEN
+			? UNRESOLVABLE : RESOLVED;
+		l->val = (unsigned char)t.n;
+	}
+	return l->state == RESOLVED ? l->val : -1;
+}
+
+/* Converts s to a number in the formats of number() that is too wide for 8
+bits, up to LIMIT, so that expressions can compute with it. Returns -1 if
+s is no such number. */
+long long wide_number(const char *s)
+{
+	long long n = 0;
+	int base = 10;
+	const char *start = s;
+	if (s[0] == '0' && (toupper((unsigned char)s[1]) == 'X'
+		|| toupper((unsigned char)s[1]) == 'B')) {
+		base = toupper((unsigned char)s[1]) == 'X' ? 16 : 2;
+		start = s += 2;
+	} else if (s[0] == '0' && s[1]) {
+		return -1; // leading zeroes
+	}
+	for (; *s && hexdigit(*s) >= 0 && hexdigit(*s) < base; s++) {
+		n = base * n + hexdigit(*s);
+		if (n > LIMIT) return -1;
+	}
+	return s == start || *s ? -1 : n;
+}
+
+/* <function> ::= ("lo" | "hi" | "sin" | "cos") "(" <expression> ")"
+	| "sizeof" "(" <label> ")"
+The name token is consumed; returns the term of the call. The angles of sin
+and cos are in 256ths of a turn, and their results are scaled to 127. */
+struct Term function(struct Evaluation *e, const char *name)
+{
+	struct Assembler *as = e->as;
+	struct Term r = {0, 0, 0};
+	e->next++; // "("
+	if (eq(name, "sizeof")) {
+		const struct Token *t = &as->In.tokens[e->next];
+		int i = t->kind == SYMBOL_TOKEN ? as->In.symbols.symbol[t->value].label
+			: -1;
+		// the size of a .TABLE or a .RESERVE is negative until it's evaluated
+		if (i < 0 || (as->Out.label[i].kind != DATA_LABEL
+			&& as->Out.label[i].kind != RESERVED_LABEL)
+			|| as->Out.label[i].size < 0) {
+			return failure(e, EXPRESSION, e->next);
+		}
+		e->next++;
+		r.n = as->Out.label[i].size;
+	} else {
+		r = operation(e, 0);
+		if (eq(name, "lo")) {
+			r.n &= 0xFF;
+		} else if (eq(name, "hi")) {
+			r.n = r.n >> 8 & 0xFF;
+		} else {
+			double turn = 2 * acos(-1.0) * (double)(r.n % 256) / 256;
+			r.n = (long long)floor(127 * (eq(name, "sin") ? sin(turn)
+				: cos(turn)) + 0.5);
+		}
+		if (r.relocation) r.relocation = -2;
+	}
+	if (!accept(e, ')')) return failure(e, PARENTHESIS, e->next);
+	return r;
+}
+
+/* <primary> ::= <number> | <label> | "$" | "(" <expression> ")" | <function> */
+struct Term primary(struct Evaluation *e)
+{
+	struct Assembler *as = e->as;
+	const struct Token *t = &as->In.tokens[e->next];
+	const char *name = as->In.text.s + t->text;
+	struct Term r = {0, 0, 0};
+	char negative = name[0] == '-';
+	if (t->kind == NUMBER_TOKEN) {
+		// negative numbers are lexed in 2's complement
+		r.n = negative && t->value ? t->value - 256 : t->value;
+	} else if (t->kind == SYMBOL_TOKEN
+		&& (r.n = wide_number(name + negative)) >= 0) {
+		if (negative) r.n = -r.n;
+	} else if (t->kind == SYMBOL_TOKEN && t[1].kind == PUNCTUATION_TOKEN
+		&& t[1].value == '('
+		&& (eq(name, "lo") || eq(name, "hi") || eq(name, "sizeof")
+		|| eq(name, "sin") || eq(name, "cos"))) {
+		e->next++;
+		return function(e, name);
+	} else if (t->kind == SYMBOL_TOKEN && e->index && !strcmp(name, "i")) {
+		r.n = *e->index; // the index shadows any label named i
+	} else if (t->kind == SYMBOL_TOKEN) {
+		int i = as->In.symbols.symbol[t->value].label;
+		if (i < 0 || (as->Out.label[i].state != RESOLVED
+			&& resolve_label(as, i) < 0)) return failure(e, VALUE, e->next);
+		const struct LabelElement *l = &as->Out.label[i];
+		r.n = l->val;
+		if (l->kind == CODE_LABEL || l->kind == DATA_LABEL
+			|| l->kind == RESERVED_LABEL) {
+			r.relocation = -1;
+			r.section = l->kind;
+		}
+		if (l->kind == EXTERN_LABEL) r.relocation = i + 1;
+	} else if (accept(e, '$')) {
+		r.n = e->address;
+		r.relocation = -1;
+		r.section = section(as, e->address);
+		return r;
+	} else if (accept(e, '(')) {
+		r = operation(e, 0);
+		if (!accept(e, ')')) return failure(e, PARENTHESIS, e->next);
+		return r;
+	} else {
+		return failure(e, EXPRESSION, e->next);
+	}
+	e->next++;
+	return r;
+}
+
+/* <unary> ::= ("-" | "+" | "~") <unary> | <primary> */
+struct Term unary(struct Evaluation *e)
+{
+	struct Term r;
+	if (accept(e, '+')) return unary(e);
+	if (accept(e, '-')) {
+		r = unary(e);
+		r.n = -r.n;
+	} else if (accept(e, '~')) {
+		r = unary(e);
+		r.n = ~r.n;
+	} else {
+		return primary(e);
+	}
+	if (r.relocation) r.relocation = -2;
+	return r;
+}
+
+/* Returns the term of a op b, where the operator is at the given token. */
+struct Term operate(struct Evaluation *e, struct Term a, char op,
+	struct Term b, int token)
+{
+	struct Term r = {0, a.relocation || b.relocation ? -2 : 0, 0};
+	switch (op) {
+	case '+':
+		r.n = a.n + b.n;
+		// an address plus a number is still an address
+		if (!a.relocation || !b.relocation) {
+			r.relocation = a.relocation + b.relocation;
+			r.section = a.relocation ? a.section : b.section;
+		}
+		break;
+	case '-':
+		r.n = a.n - b.n;
+		// the distance of two addresses that move together is a number
+		if (!b.relocation) {
+			r.relocation = a.relocation;
+			r.section = a.section;
+		}
+		if (b.relocation == a.relocation && a.relocation != -2
+			&& b.section == a.section) {
+			r.relocation = 0;
+		}
+		break;
+	case '*':
+		r.n = a.n * b.n;
+		break;
+	case '/':
+	case '%':
+		if (!b.n) return failure(e, DIVISION, token);
+		r.n = op == '/' ? a.n / b.n : a.n % b.n;
+		break;
+	case '<':
+	case '>':
+		if (b.n < 0 || b.n > 31) return failure(e, EXPRESSION_RANGE, token);
+		// shifts of negative numbers are arithmetic
+		r.n = op == '<' ? a.n * (1LL << b.n)
+			: a.n < 0 ? ~(~a.n >> b.n) : a.n >> b.n;
+		break;
+	case '&':
+		r.n = a.n & b.n;
+		break;
+	case '^':
+		r.n = a.n ^ b.n;
+		break;
+	default: // '|'
+		r.n = a.n | b.n;
+		break;
+	}
+	if (r.n < -LIMIT || r.n > LIMIT) return failure(e, EXPRESSION_RANGE, token);
+	return r;
+}
+
+/* Evaluates the operations of the given precedence level and higher:
+<expression> ::= <unary> | <expression> <operator> <unary> */
+struct Term operation(struct Evaluation *e, int level)
+{
+	if (level == LEVELS) return unary(e);
+	struct Term r = operation(e, level + 1);
+	for (;;) {
+		const struct Token *t = &e->as->In.tokens[e->next];
+		int token = e->next;
+		if (t->kind != PUNCTUATION_TOKEN
+			|| !strchr(precedence[level], t->value)) return r;
+		if (t->value == '<' || t->value == '>') {
+			// shifts are two adjacent characters
+			if (t[1].kind != PUNCTUATION_TOKEN || t[1].value != t->value
+				|| t[1].column != t->column + 1) return r;
+			e->next++;
+		}
+		e->next++;
+		r = operate(e, r, (char)t->value, operation(e, level + 1), token);
+	}
+}
+
+char evaluate(struct Assembler *as, const int *index, int min, int max,
+	int *n)
+{
+	as->In.label = 0;
+	as->In.relocation = ABSOLUTE_VALUE;
+	as->In.section = 0;
+	if (!expression(TOK)) return 0;
+	int first = (int)(TOK - as->In.tokens);
+	struct Evaluation e = {as, first, as->Out.addr, NO_ERROR, 0, index};
+	struct Term r = operation(&e, 0);
+	if (e.error) {
+		seektoken(as, e.token);
+		if (e.error == VALUE) return 0; // reported by the caller
+		error(as, e.error);
+	}
+	seektoken(as, e.next - 1); // the last token of the expression
+	if (r.n < min || r.n > max) {
+		// a number alone is reported by the caller, as an invalid number
+		if (e.next == first + 1) return 0;
+		error(as, EXPRESSION_RANGE);
 	}
+	if (r.relocation == -2 && as->object) error(as, RELOCATION);
+	if (r.relocation > 0) {
+		as->In.label = r.relocation;
+		as->In.relocation = EXTERN_VALUE;
+	} else {
+		if (e.next == first + 1) as->In.label = findlabel(as) + 1;
+		if (r.relocation) as->In.relocation = ADDRESS_VALUE;
+		as->In.section = r.section;
+	}
+	*n = (int)r.n;
 	return 1;
 }
 
-int regnum(const char *s)
+int value(struct Assembler *as)
 {
-	if (eq(s,"R0")) return 0;
-	if (eq(s,"R1")) return 1;
-	if (eq(s,"R2")) return 2;
-	if (eq(s,"R3")) return 3;
-	if (eq(s,"R4")) return 4;
-	if (eq(s,"R5")) return 5;
-	if (eq(s,"R6") || eq(s,"FLAGS")) return 6;
-	if (eq(s,"R7") || eq(s,"SP")) return 7;
-	return -1;
+	int n;
+	return evaluate(as, NULL, -128, 255, &n) ? n & 0xFF : -1;
 }
 
-int value(const char *s)
+void renumber(char *comment, int n, char bracketed)
 {
-	int n = number(s);
-	if (n >= 0) return n;
-	// if it's not a number, it must be a label
-	int i = findlabel(s);
-	if (i > -1) {
-		return Out.label[i].val;
+	char *p = strstr(comment, ", ");
+	if (!*comment) return; // disassembled from the word when it's rendered
+	if (!p) {
+		// <instr_n> <value>
+		sprintf(comment + strcspn(comment, " "), " %d", n);
+	} else if (bracketed) {
+		sprintf(p + 3, "%d]", n);
+	} else if (n < 128) {
+		sprintf(p + 2, "%d", n);
 	} else {
-		return -1;
+		sprintf(p + 2, "%d (-%d)", n, 256 - n);
 	}
 }
 
-void bitcopy(char *dest, int num, int high, int low)
+const char* listing_comment(const struct Assembler *as, int addr, char *dest)
 {
-	// convert VHDL [7 DOWNTO 0] to array order MSB=0, LSB=7
-	int MSB = 7 - high;
-	int LSB = 7 - low;
-	for (int i = LSB; i >= MSB; i--) { // from LSB to MSB
-		// num & 1 = num's LSB (bitwise AND)
-		dest[i] = (num & 1) ? '1' : '0';
-		num >>= 1;
+	const struct OutputHeader *Out = &as->Out;
+	const struct WordInfo *w = &Out->word[addr];
+	int first = w->type == OPERAND_WORD ? addr - 1 : addr;
+	if (Out->comment[addr][0] || (w->type != INSTRUCTION_WORD
+		&& w->type != OPERAND_WORD) || Out->word[addr + 1].type
+		== OPERAND_WORD) return Out->comment[addr];
+	if (!disassemble(dest, Out->mem[first], Out->mem[first + 1])) return dest;
+	const struct Keyword *k = decode(Out->mem[first]);
+	if (k->format == TYPE4_5 && !k->bracketed && !(Out->mem[first] & 0x08)
+		&& Out->mem[addr] >= 128) {
+		// signed equivalent for non-address
+		sprintf(dest + strlen(dest), " (-%d)", 256 - Out->mem[addr]);
+	}
+	if (w->mnemonic) {
+		const struct Token *t = &as->In.tokens[w->mnemonic - 1];
+		memcpy(dest, as->In.text.s + t->text, strlen(k->name));
 	}
-	if (LSB == 7) dest[8] = '\0';
+	return dest;
+}
+
+void binary(char *dest, int word)
+{
+	static const char *const nibbles[16] = {
+		"0000", "0001", "0010", "0011", "0100", "0101", "0110", "0111",
+		"1000", "1001", "1010", "1011", "1100", "1101", "1110", "1111"};
+	memcpy(dest, nibbles[(word >> 4) & 0xF], 4);
+	memcpy(dest + 4, nibbles[word & 0xF], 5); // including the terminator
+}
+
+int decimal(char *dest, int n)
+{
+	int len = 0;
+	if (n < 0) {
+		dest[len++] = '-';
+		n = -n;
+	}
+	len += n >= 100 ? 3 : n >= 10 ? 2 : 1;
+	dest[len] = '\0';
+	for (int i = len - 1; n || i == len - 1; i--, n /= 10) {
+		dest[i] = (char)('0' + n % 10);
+	}
+	return len;
+}
+
+void hexadecimal(char *dest, int word)
+{
+	static const char digits[] = "0123456789ABCDEF";
+	dest[0] = digits[(word >> 4) & 0xF];
+	dest[1] = digits[word & 0xF];
+	dest[2] = '\0';
 }
@@ -4,6 +4,14 @@
 #ifndef PARSE_FUNCTIONS_H
 #define PARSE_FUNCTIONS_H
 
+#include <stddef.h>
+
+struct Assembler;
+struct Token;
+
+/* Returns the value of the hex digit c, or -1 if it's no hex digit. */
+int hexdigit(char c);
+
 /* Converts s to a decimal number according to this rule:
 <number> ::= "0x" <hex+> | "0b" <bit+> | <dec+>
 Negative numbers are converted to their 2's complement, so when the conversion
@@ -11,50 +19,106 @@ is successful, it always returns beween 0-255. A negative return value signifies
 an error or a non-number (eg. -200 would return signed range error) */
 int number(const char *s);
 
-/* Trims leading and trailing whitespace and comments from s */
-void trim(char *s);
+/* Trims leading and trailing whitespace and comments from the n characters
+at s, without modifying them. Returns the start of the trimmed text, and sets
+n to its length. */
+const char* trim(const char *s, size_t *n);
 
 /* Compares two strings case-insensitevely, taking into account NULL pointers,
 and returns 1 if the strings are equal, 0 otherwise */
 char eq(const char *s1, const char *s2);
 
 /* Returns 1 if s is a <label> */
-char label(const char *s);
+char label(struct Assembler *as, const char *s);
+
+/* Returns 1 if the current token is an <array_element> */
+char array_element(struct Assembler *as);
 
-/* Returns 1 if s is an <array_element> */
-char array_element(const char *s);
+/* Returns the size of the current token's instruction, or 0 if it's no
+instruction */
+char instr_size(struct Assembler *as);
 
-/* Returns 1 if s is a single-word instruction */
-char instr_size1(const char *s);
+/* Returns 1 if s is an instruction or a register name */
+char reserved(const char *s);
 
-/* Returns 1 if the parameter is a two-word instruction */
-char instr_size2(const char *s);
+/* The following functions check the current token, and write its opcode to
+the current RAM address if it matches. They return the instruction size,
+or 0 if the token doesn't match. */
 
 /* "HLT" | "NOP" | "RETURN" */
-char instr_noarg(const char *s);
+char instr_noarg(struct Assembler *as);
 
 /* "RSHIFT" | "LSHIFT" | "PUSH" | "POP" */
-char instr_reg(const char *s);
+char instr_reg(struct Assembler *as);
 
 /* "JMP" | "JC" | "JNC" | "JZ" | "JNZ" | "JS" | "JNS" | "JV" | "JNV" | "CALL" */
-char instr_n(const char *s);
+char instr_n(struct Assembler *as);
 
 /* "MOV" | "ADD" | "ROR" | "SUB" | "CMP" | "AND" | "BIT" | "OR" | "XOR" |
 "LOAD" | "STORE" */
-char instr_reg_op2(const char *s);
+char instr_reg_op2(struct Assembler *as);
 
 /* "LOAD" | "STORE" */
-char load_store(const char *s);
-
-/* Returns the address of the register string parameter according to:
-<reg> ::= "R0"|"R1"|"R2"|"R3"|"R4"|"R5"|"R6"|"SP"|"R7"|"FLAGS" */
-int regnum(const char *s);
-
-/* Returns the value of s according to <value> ::= <number> | <label>
-if the parameter is an label, it gets its value from the labels table */
-int value(const char *s);
-
-/* Converts num to bits, in Little Endian order to match VHDL's DOWNTO */
-void bitcopy(char *dest, int num, int high, int low);
+char load_store(struct Assembler *as);
+
+/* Returns the pre-parsed value of the current token if it's a <number>,
+or -1 */
+int literal(struct Assembler *as);
+
+/* Returns the address of the current token if it's a register according to:
+<reg> ::= "R0"|"R1"|"R2"|"R3"|"R4"|"R5"|"R6"|"SP"|"R7"|"FLAGS"
+or -1 */
+int regnum(struct Assembler *as);
+
+/* Returns 1 if t can start an <expression>. */
+char expression(const struct Token *t);
+
+/* Evaluates the expression that starts at the current token according to
+<value> ::= <expression>
+<expression> ::= <unary> | <expression> <operator> <unary>
+<operator> ::= "|" | "^" | "&" | "<<" | ">>" | "+" | "-" | "*" | "/" | "%"
+<unary> ::= ("-" | "+" | "~") <unary> | <number> | <label> | "$"
+	| "(" <expression> ")" | <function> "(" <expression> ")"
+	| "sizeof" "(" <label> ")"
+<function> ::= "lo" | "hi" | "sin" | "cos"
+with the precedence of C, and moves to its last token. Labels are evaluated
+to their values, $ to the current address and sizeof to the words of a .DATA
+array; lo and hi are the low and high bytes of a value, and sin and cos take
+angles in 256ths of a turn and are scaled to 127. Intermediate results are
+32-bit, and the result must be 8-bit, from -128 to 255; negative results are
+converted to their 2's complement. Returns -1 if the current token starts no
+expression, or if a token of the expression is no number or label, which
+becomes the current token. The label and the
+relocation of the result are set in In.label and In.relocation. */
+int value(struct Assembler *as);
+
+/* Same as value(), where the label i stands for *index when index isn't
+NULL, for the elements of a .TABLE. The result must be in [min, max]; it's
+set in *n without conversion. Returns 0 where value() returns -1, or 1. */
+char evaluate(struct Assembler *as, const int *index, int min, int max,
+	int *n);
+
+/* Rewrites the value operand in the comment of a two-word instruction to
+n, keeping the comment's format. Derived comments, which are empty, are
+left as they are. */
+void renumber(char *comment, int n, char bracketed);
+
+/* Returns the comment of the word at addr for the listings: its text in
+Out.comment, or else, on the last word of an instruction, its disassembly
+with the signed equivalent of a value of 128 or more, which is formatted at
+dest with the mnemonic as it was written. dest must hold
+MAX_COMMENT_LENGTH characters. */
+const char* listing_comment(const struct Assembler *as, int addr, char *dest);
+
+/* Writes the 8 binary digits of word, MSB first to match VHDL's DOWNTO, and
+a terminator at dest */
+void binary(char *dest, int word);
+
+/* Writes the 2 uppercase hexadecimal digits of word and a terminator at dest */
+void hexadecimal(char *dest, int word);
+
+/* Writes the decimal digits of n (-999 to 999) and a terminator at dest, and
+returns the number of characters */
+int decimal(char *dest, int n);
 
 #endif
@@ -0,0 +1,186 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Execution profiler; counts the cycles of a simulated run by address,
+// branch outcome and call stack, and maps them back to the source lines
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profiler.h"
+#include "data_structures.h"
+#include "isa.h"
+
+/* Returns the frame of a call to entry from frame f, adding it if it's new,
+or -1 if MAX_FRAMES are recorded. */
+int enter(struct Profile *p, int f, int entry)
+{
+	int *link = &p->frame[f].child;
+	while (*link >= 0 && p->frame[*link].entry != entry) {
+		link = &p->frame[*link].sibling;
+	}
+	if (*link < 0) {
+		if (p->frames == MAX_FRAMES) return -1;
+		struct Frame frame = {f, -1, -1, (unsigned char)entry, 0, 0};
+		p->frame[p->frames] = frame;
+		*link = p->frames++;
+	}
+	p->frame[*link].calls++;
+	return *link;
+}
+
+void profile(struct Profile *p, struct Computer *c, unsigned long limit)
+{
+	struct Frame root = {-1, -1, -1, 0, 1, 0};
+	int f = 0; // current frame
+	unsigned long unrecorded = 0; // calls beyond MAX_FRAMES, open in f
+	memset(p->hits, 0, sizeof(p->hits));
+	memset(p->taken, 0, sizeof(p->taken));
+	p->frame[0] = root;
+	p->frames = 1;
+	p->cycles = 0;
+	while (!(c->r[FLAGS_REGISTER] & HALT)) {
+		if (c->cycles >= limit) break;
+		int pc = c->pc;
+		int instr1 = c->ram[pc];
+		int instr2 = c->ram[(pc + 1) & 0xFF];
+		step(c);
+		p->hits[pc]++;
+		p->frame[f].cycles++;
+		p->cycles++;
+		if (instr1 >= JC_OP && instr1 <= JNV_OP && c->pc == instr2) {
+			p->taken[pc]++;
+		} else if (instr1 == CALL_OP) {
+			int callee = enter(p, f, instr2);
+			if (callee < 0) {
+				unrecorded++;
+			} else {
+				f = callee;
+			}
+		} else if (instr1 == RETURN_OP) {
+			if (unrecorded) {
+				unrecorded--;
+			} else if (p->frame[f].parent >= 0) {
+				f = p->frame[f].parent;
+			}
+		}
+	}
+	p->halted = (c->r[FLAGS_REGISTER] & HALT) != 0;
+}
+
+/* Returns the name of the subroutine at entry: its label, "(start)" for
+address 0, or its address, which is written at buffer. */
+const char* subname(const struct Assembler *as, int entry, char *buffer)
+{
+	const char *label = codelabel(as, entry);
+	if (label) return label;
+	if (!entry) return "(start)";
+	sprintf(buffer, "@%d", entry);
+	return buffer;
+}
+
+/* Returns the percentage of the profile's cycles that n is. */
+double share(const struct Profile *p, unsigned long n)
+{
+	return p->cycles ? 100.0 * n / p->cycles : 0;
+}
+
+/* Appends the source lines with their cycles and taken branches, if there
+is a source. */
+int format_lines(const struct Profile *p, const struct Assembler *as,
+	struct Text *t)
+{
+	const struct InputHeader *In = &as->In;
+	const struct OutputHeader *Out = &as->Out;
+	if (!In->lines_count) return 1; // a linked image has no source
+	if (!append(t, "\n Cycles       %%  Line  Source\n")) return 0;
+	for (int i = 0; i < In->lines_count; i++) {
+		const struct Line *line = &In->lines[i];
+		unsigned long cycles = 0, taken = 0, tests = 0;
+		char code = 0;
+		for (int a = 0; a < RAM_SIZE; a++) {
+			if (Out->word[a].line != i + 1
+				|| Out->word[a].type != INSTRUCTION_WORD) continue;
+			code = 1;
+			cycles += p->hits[a];
+			if (Out->mem[a] >= JC_OP && Out->mem[a] <= JNV_OP) {
+				taken += p->taken[a];
+				tests += p->hits[a];
+			}
+		}
+		int ok = code ? append(t, "%7lu %7.2f  %4d", cycles, share(p, cycles),
+			i + 1) : append(t, "%7s %7s  %4d", "", "", i + 1);
+		if (ok && line->length) {
+			ok = appendn(t, "  ", 2)
+				&& appendn(t, In->source + line->offset, line->length);
+		}
+		if (ok && tests) ok = append(t, "  [taken %lu of %lu]", taken, tests);
+		if (!ok || !appendn(t, "\n", 1)) return 0;
+	}
+	return 1;
+}
+
+/* Appends the calls and cycles of each subroutine, by itself and with the
+subroutines it calls. */
+int format_subroutines(const struct Profile *p, const struct Assembler *as,
+	struct Text *t)
+{
+	unsigned long calls[256] = {0}, self[256] = {0}, total[256] = {0};
+	char called[256] = {0};
+	char address[8];
+	for (int f = 0; f < p->frames; f++) {
+		const struct Frame *frame = &p->frame[f];
+		char counted[256] = {0}; // recursive calls count once in totals
+		called[frame->entry] = 1;
+		calls[frame->entry] += frame->calls;
+		self[frame->entry] += frame->cycles;
+		for (int g = f; g >= 0; g = p->frame[g].parent) {
+			int entry = p->frame[g].entry;
+			if (!counted[entry]) total[entry] += frame->cycles;
+			counted[entry] = 1;
+		}
+	}
+	if (!append(t, "\nSubroutine        Address     Calls      Self       %%"
+		"     Total       %%\n")) return 0;
+	for (int entry = 0; entry < 256; entry++) {
+		if (!called[entry]) continue;
+		if (!append(t, "%-17s %7d %9lu %9lu %7.2f %9lu %7.2f\n",
+			subname(as, entry, address), entry,
+			calls[entry], self[entry], share(p, self[entry]), total[entry],
+			share(p, total[entry]))) return 0;
+	}
+	return 1;
+}
+
+int format_profile(const struct Profile *p, const struct Assembler *as,
+	struct Text *t)
+{
+	return append(t, p->halted ? "Halted after %lu cycles.\n"
+		: "Stopped after %lu cycles without halting.\n", p->cycles)
+		&& format_lines(p, as, t) && format_subroutines(p, as, t);
+}
+
+int format_stacks(const struct Profile *p, const struct Assembler *as,
+	struct Text *t)
+{
+	char address[8];
+	int *chain = malloc(sizeof(int) * MAX_FRAMES);
+	if (!chain) return 0;
+	for (int f = 0; f < p->frames; f++) {
+		int depth = 0;
+		if (!p->frame[f].cycles) continue;
+		for (int g = f; g >= 0; g = p->frame[g].parent) chain[depth++] = g;
+		while (depth--) {
+			if (!append(t, depth ? "%s;" : "%s",
+				subname(as, p->frame[chain[depth]].entry, address))) {
+				free(chain);
+				return 0;
+			}
+		}
+		if (!append(t, " %lu\n", p->frame[f].cycles)) {
+			free(chain);
+			return 0;
+		}
+	}
+	free(chain);
+	return 1;
+}
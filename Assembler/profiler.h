@@ -0,0 +1,52 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Execution profiler headers
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "data_structures.h"
+#include "simulator.h"
+
+#define MAX_FRAMES 4096 // distinct call stacks recorded by a profile
+
+/* A distinct call stack: the CALL targets from address 0 to its top. */
+struct Frame {
+	int parent; // frame of the caller, or -1 for address 0
+	int child; // first frame called from this one, or -1
+	int sibling; // next frame called from the parent, or -1
+	unsigned char entry; // address of the called subroutine
+	unsigned long calls; // times it was entered
+	unsigned long cycles; // cycles spent in it, outside of its calls
+};
+
+/* Execution counts of a run. Every instruction takes one cycle, so the
+executions of an address are also its cycles. */
+struct Profile {
+	unsigned long hits[256]; // executions of the instruction at each address
+	unsigned long taken[256]; // jumps taken by the J<flag> at each address
+	struct Frame frame[MAX_FRAMES]; // frame 0 is the code at address 0
+	int frames; // number of recorded frames
+	unsigned long cycles; // executed clock cycles
+	char halted; // the run ended at HLT, instead of the cycle limit
+};
+
+/* Executes clock cycles as simulate() does, and counts them in p by address,
+by branch outcome and by call stack. Calls deeper than MAX_FRAMES distinct
+stacks are counted in their callers. */
+void profile(struct Profile *p, struct Computer *c, unsigned long limit);
+
+/* Appends the profile of an assembled program to t: its source lines with
+their cycles, percentages and taken branches, followed by the cycles of each
+subroutine, by itself and with its calls. Returns 0 if memory can't be
+allocated. */
+int format_profile(const struct Profile *p, const struct Assembler *as,
+	struct Text *t);
+
+/* Appends the call stacks of the profile in the collapsed format of flame
+graph tools: one line per stack, with the names of its subroutines from
+address 0 separated by semicolons, followed by its cycles. Returns 0 if
+memory can't be allocated. */
+int format_stacks(const struct Profile *p, const struct Assembler *as,
+	struct Text *t);
+
+#endif
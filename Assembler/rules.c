@@ -0,0 +1,193 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Superoptimizer rule database; reads and writes the rewrites that
+// e80superopt finds, for the optimizer to apply
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "rules.h"
+#include "data_structures.h"
+#include "simulator.h"
+#include "isa.h"
+
+#define MAX_RULE_LINE 256 // characters of a database line
+
+/* Flags that a rule may leave different, in the order of their letters. */
+static const int flag_bits[4] = {CARRY, ZERO, SIGN, OVERFLOW};
+
+int pattern_size(const struct Pattern *p)
+{
+	return p->op == LSHIFT_OP || p->op == RSHIFT_OP ? 1 : 2;
+}
+
+int encode_pattern(const struct Pattern *p, const int *bound, int *instr2)
+{
+	int r = bound[p->reg];
+	*instr2 = 0;
+	if (pattern_size(p) == 1) return p->op | r;
+	if (p->reg2 < 0) {
+		*instr2 = p->n;
+		return p->op | r;
+	}
+	*instr2 = r << 4 | bound[(int)p->reg2];
+	return p->op | 0x08;
+}
+
+/* Appends the instructions of a window or replacement to t. */
+int format_patterns(const struct Pattern *p, int n, struct Text *t)
+{
+	for (int i = 0; i < n; i++) {
+		const char *name = decode(p[i].op)->name;
+		int ok = pattern_size(&p[i]) == 1 ? append(t, "%s %c", name,
+			'A' + p[i].reg) : p[i].reg2 < 0 ? append(t, "%s %c, %d", name,
+			'A' + p[i].reg, p[i].n) : append(t, "%s %c, %c", name,
+			'A' + p[i].reg, 'A' + p[i].reg2);
+		if (!ok || (i < n - 1 && !appendn(t, " ; ", 3))) return 0;
+	}
+	return 1;
+}
+
+int format_rule(const struct Rule *r, struct Text *t)
+{
+	if (!append(t, "RULE ")) return 0;
+	for (int f = 0; f < 4; f++) {
+		if (r->dead & flag_bits[f] && !appendn(t, &"CZSV"[f], 1)) return 0;
+	}
+	return (r->dead || appendn(t, "-", 1)) && append(t, " : ")
+		&& format_patterns(r->from, r->length, t) && append(t, " =>")
+		&& (!r->size || append(t, " "))
+		&& format_patterns(r->to, r->size, t) && append(t, "\n");
+}
+
+/* Reads a pattern register at *s, and returns it, or -1. */
+int read_pattern_register(const char **s)
+{
+	while (isspace((unsigned char)**s)) (*s)++;
+	char c = (char)toupper((unsigned char)**s);
+	if ((c != 'A' && c != 'B') || isalnum((unsigned char)(*s)[1])) return -1;
+	(*s)++;
+	return c - 'A';
+}
+
+/* Reads a pattern instruction at *s into p. Returns 0 if there's none. */
+int read_pattern(const char **s, struct Pattern *p)
+{
+	char name[ISA_MAX_LENGTH + 1];
+	int n = 0;
+	while (isspace((unsigned char)**s)) (*s)++;
+	while (isalpha((unsigned char)**s) && n < ISA_MAX_LENGTH) {
+		name[n++] = *(*s)++;
+	}
+	name[n] = '\0';
+	const struct Keyword *k = keyword(name);
+	if (!k || k->bracketed || (k->format != TYPE4_5
+		&& k->opcode != LSHIFT_OP && k->opcode != RSHIFT_OP)) return 0;
+	p->op = k->opcode;
+	p->reg2 = -1;
+	p->n = 0;
+	int r = read_pattern_register(s);
+	if (r < 0) return 0;
+	p->reg = (unsigned char)r;
+	if (k->format == TYPE2) return 1;
+	while (isspace((unsigned char)**s)) (*s)++;
+	if (*(*s)++ != ',') return 0;
+	const char *operand = *s;
+	if ((r = read_pattern_register(s)) >= 0) {
+		p->reg2 = (signed char)r;
+		return 1;
+	}
+	char *end;
+	long v = strtol(operand, &end, 10);
+	if (end == operand || v < 0 || v > 255) return 0;
+	p->n = (unsigned char)v;
+	*s = end;
+	return 1;
+}
+
+/* Reads the instructions of a window or replacement at *s, separated by
+';' and ended by 'stop' or the end of the line, into p. Returns their
+number, or -1 if they're invalid. */
+int read_patterns(const char **s, struct Pattern *p, const char *stop)
+{
+	int n = 0;
+	while (isspace((unsigned char)**s)) (*s)++;
+	if (!**s || (*stop && !strncmp(*s, stop, strlen(stop)))) return 0;
+	for (;;) {
+		if (n == RULE_LENGTH || !read_pattern(s, &p[n++])) return -1;
+		while (isspace((unsigned char)**s)) (*s)++;
+		if (**s != ';') return n;
+		(*s)++;
+	}
+}
+
+/* Reads a RULE line into r. Returns 0 if it's invalid. */
+int read_rule(const char *s, struct Rule *r)
+{
+	int n;
+	memset(r, 0, sizeof(*r));
+	if (strncmp(s, "RULE ", 5)) return 0;
+	for (s += 5; *s == ' '; s++);
+	if (*s == '-') {
+		s++;
+	} else {
+		for (; *s && *s != ' '; s++) {
+			const char *f = strchr("CZSV", *s);
+			if (!f) return 0;
+			r->dead |= flag_bits[f - "CZSV"];
+		}
+	}
+	while (*s == ' ') s++;
+	if (*s++ != ':') return 0;
+	if ((n = read_patterns(&s, r->from, "=>")) < 1) return 0;
+	r->length = (unsigned char)n;
+	if (strncmp(s, "=>", 2)) return 0;
+	s += 2;
+	if ((n = read_patterns(&s, r->to, "")) < 0) return 0;
+	r->size = (unsigned char)n;
+	while (isspace((unsigned char)*s)) s++;
+	if (*s) return 0;
+	// the pattern registers of the replacement must be named by the window
+	for (int i = 0; i < r->size; i++) {
+		int used = 0;
+		for (int j = 0; j < r->length; j++) {
+			used |= 1 << r->from[j].reg;
+			if (r->from[j].reg2 >= 0) used |= 1 << r->from[j].reg2;
+		}
+		if (!(used & 1 << r->to[i].reg)
+			|| (r->to[i].reg2 >= 0 && !(used & 1 << r->to[i].reg2))) return 0;
+	}
+	return 1;
+}
+
+int read_rules(struct Rules *r, const char *text)
+{
+	char line[MAX_RULE_LINE];
+	if (!sgets(line, sizeof(line), &text)
+		|| strcmp(line, RULES_SIGNATURE "\n")) return 0;
+	while (sgets(line, sizeof(line), &text)) {
+		size_t length = strcspn(line, "\r\n");
+		if (!line[length] && *text) return 0; // a line too long
+		line[length] = '\0';
+		if (!line[0]) continue;
+		struct Rule *rule = realloc(r->rule, (r->count + 1) * sizeof(*rule));
+		if (!rule) return 0;
+		r->rule = rule;
+		if (!read_rule(line, &r->rule[r->count])) return 0;
+		r->count++;
+	}
+	// group the rules by ALUop, keeping their order
+	struct Rule *sorted = malloc(r->count * sizeof(*sorted) + 1);
+	int at[17] = {0};
+	if (!sorted) return 0;
+	for (int i = 0; i < r->count; i++) at[(r->rule[i].from[0].op >> 4) + 1]++;
+	for (int op = 0; op < 16; op++) at[op + 1] += at[op];
+	memcpy(r->first, at, sizeof(at));
+	for (int i = 0; i < r->count; i++) {
+		sorted[at[r->rule[i].from[0].op >> 4]++] = r->rule[i];
+	}
+	free(r->rule);
+	r->rule = sorted;
+	return 1;
+}
@@ -0,0 +1,65 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Superoptimizer rule database headers
+
+#ifndef RULES_H
+#define RULES_H
+
+#include "data_structures.h"
+
+#define RULES_SIGNATURE "E80 RULES"
+#define RULE_LENGTH 4 // longest window of instructions that a rule rewrites
+#define PATTERN_REGISTERS 2 // registers a rule names, A and B
+
+/* An instruction of a rule: MOV, ADD, SUB, AND, OR, XOR, ROR, CMP or BIT
+with a register or a number, or LSHIFT or RSHIFT, on the pattern registers
+A (0) and B (1), which stand for two different registers of R0-R5. */
+struct Pattern {
+	unsigned char op; // enum Opcode
+	unsigned char reg; // pattern register of the first operand
+	signed char reg2; // pattern register of the second operand, or -1
+	unsigned char n; // number of the second operand
+};
+
+/* A rewrite found by the superoptimizer (e80superopt.c): the instructions
+of 'from' do the same to the pattern registers and to the flags other than
+'dead' as the fewer cycles, or the same cycles in fewer words, of 'to'. */
+struct Rule {
+	struct Pattern from[RULE_LENGTH];
+	struct Pattern to[RULE_LENGTH];
+	unsigned char length; // instructions of 'from'
+	unsigned char size; // instructions of 'to', which may be none
+	unsigned char dead; // flag bits (see simulator.h) that may differ
+};
+
+/* The rules of a database, in its order within the rules of each ALUop
+(Instr1[7:4]) of their first instruction, which are rule[first[op]] up to
+rule[first[op + 1]]. */
+struct Rules {
+	struct Rule *rule;
+	int count;
+	int first[17];
+};
+
+/* Returns the words of a pattern instruction. */
+int pattern_size(const struct Pattern *p);
+
+/* Returns the Instr1 of a pattern instruction, with its pattern registers
+bound to the registers in bound[], and writes its Instr2 at *instr2. */
+int encode_pattern(const struct Pattern *p, const int *bound, int *instr2);
+
+/* Appends a rule to t as a line of a database:
+  RULE dead : window => replacement
+where dead is '-', or the letters of the flags that may differ (CZSV), and
+the instructions of the window and its replacement are separated by ';'
+and name the pattern registers A and B, as in
+  RULE ZS : XOR A, A => MOV A, 0
+A database is the line RULES_SIGNATURE followed by such lines. Returns 0 if
+memory can't be allocated. */
+int format_rule(const struct Rule *r, struct Text *t);
+
+/* Reads the rules of a database into r, after the ones it holds, and groups
+them by ALUop. Returns 0 if it's no valid database or memory can't be
+allocated. */
+int read_rules(struct Rules *r, const char *text);
+
+#endif
@@ -0,0 +1,258 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// E80 instruction-set simulator; executes a RAM image natively, following
+// the signals of CPU.vhd and ALU.vhd cycle by cycle
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "simulator.h"
+#include "data_structures.h"
+#include "parse_functions.h"
+#include "isa.h"
+
+/* Clears the computer as on Reset: PC=0, SP=0xFF and the Halt flag is
+cleared, while the other registers and the RAM are undefined. */
+void reset_computer(struct Computer *c)
+{
+	memset(c, 0, sizeof(*c));
+	c->r[STACK_POINTER] = 0xFF;
+}
+
+void load_assembly(struct Computer *c, const struct Assembler *as)
+{
+	reset_computer(c);
+	// unused words are zeroes, as are the words handled by OTHERS in VHDL
+	memcpy(c->ram, as->Out.mem, RAM_SIZE);
+	c->dip = as->Out.simdip;
+	c->monitor = (unsigned char) as->Out.monitor;
+}
+
+/* Parses the 8-bit binary string literal at s ("bbbbbbbb"), and returns its
+value, or -1 if s is not such a literal. */
+int bitstring(const char *s)
+{
+	int n = 0;
+	if (*s++ != '"') return -1;
+	for (int i = 0; i < 8; i++, s++) {
+		if (*s != '0' && *s != '1' && *s != 'U') return -1;
+		n = 2 * n + (*s == '1');
+	}
+	return *s == '"' ? n : -1;
+}
+
+int load_program(struct Computer *c, const char *vhdl)
+{
+	int words = 0;
+	const char *s;
+	reset_computer(c);
+	if ((s = strstr(vhdl, "SIMDIP_directive")) && (s = strchr(s, '"'))) {
+		int n = bitstring(s);
+		if (n >= 0) c->dip = (unsigned char) n;
+	}
+	if ((s = strstr(vhdl, "MONITOR_directive")) && (s = strstr(s, ":="))) {
+		c->monitor = (unsigned char) strtoul(s + 2, NULL, 10);
+	}
+	if (!(s = strstr(vhdl, "WORDx256"))) return 0;
+	// scan the aggregate for <addr> => "<bits>" associations
+	while ((s = strstr(s, "=>"))) {
+		const char *addr = s;
+		while (addr > vhdl && isspace((unsigned char)addr[-1])) addr--;
+		while (addr > vhdl && isdigit((unsigned char)addr[-1])) addr--;
+		for (s += 2; isspace((unsigned char)*s); s++);
+		int n = bitstring(s);
+		if (n >= 0 && isdigit((unsigned char)*addr)) {
+			int i = atoi(addr);
+			if (i >= 0 && i < 256) {
+				c->ram[i] = (unsigned char) n;
+				words++;
+			}
+		}
+	}
+	return words;
+}
+
+void alu(int op, int a, int b, int flags_in, int *out, int *flags_out)
+{
+	// ALUop decoder
+	int isADD    = op == 0x2;
+	int isSUB    = (op & 0x7) == 0x3; // includes CMP
+	int isAND    = (op & 0x7) == 0x4; // includes BIT
+	int isOR     = op == 0x5;
+	int isXOR    = op == 0x6;
+	int isROR    = op == 0x7;
+	int isLSHIFT = op == 0xA;
+	int isCMP    = op == 0xB;
+	int isBIT    = op == 0xC;
+	int isRSHIFT = op == 0xD;
+	int isDCR    = op == 0xE; // PUSH, CALL
+	int isINR    = op == 0xF; // POP, RETURN
+	int FullFlags = isADD || isSUB || isRSHIFT || isLSHIFT;
+	int DiscardFlags = isINR || isDCR;
+	int DiscardResult = isCMP || isBIT;
+	// ripple-carry adder / subtractor (FA8.vhd)
+	if (isDCR || isINR) b = 1;
+	int sub = isSUB || isDCR;
+	int x = sub ? b ^ 0xFF : b;
+	int sum = a + x + sub;
+	int sum_c = (sum >> 8) & 1;
+	int c7 = (((a & 0x7F) + (x & 0x7F) + sub) >> 7) & 1; // carry into bit 7
+	int sum_v = sum_c ^ c7;
+	sum &= 0xFF;
+	// barrel shifter, rotating by the 3 LSBs of B
+	int n = b & 7;
+	int rotated = ((a >> n) | (a << (8 - n))) & 0xFF;
+	int result =
+		isROR    ? rotated :
+		isAND    ? a & b :
+		isOR     ? a | b :
+		isXOR    ? a ^ b :
+		isRSHIFT ? a >> 1 :
+		isLSHIFT ? (a << 1) & 0xFF :
+		sum;
+	int C = isRSHIFT ? a & 1 : isLSHIFT ? a >> 7 : sum_c;
+	int Z = result == 0;
+	int S = result >> 7;
+	int V = isRSHIFT || isLSHIFT ? (a >> 7) ^ S : sum_v;
+	if (DiscardFlags) {
+		*flags_out = flags_in;
+	} else if (FullFlags) {
+		*flags_out = C << 7 | Z << 6 | S << 5 | V << 4 | (flags_in & 0x0F);
+	} else {
+		*flags_out = (flags_in & 0x9F) | Z << 6 | S << 5;
+	}
+	*out = DiscardResult ? a : result;
+}
+
+int step(struct Computer *c)
+{
+	int Instr1 = c->ram[c->pc];
+	int Instr2 = c->ram[(c->pc + 1) & 0xFF];
+	int op2isReg = (Instr1 >> 3) & 1;
+	int Instr1Reg = Instr1 & 7;
+	int Instr2Reg1 = (Instr2 >> 4) & 7;
+	int Instr2Reg2 = Instr2 & 7;
+	// instruction decoder
+	int isHLT    = Instr1 == 0x00;
+	int isNOP    = Instr1 == 0x01;
+	int isJMP    = Instr1 == 0x02;
+	int isJC     = Instr1 == 0x04;
+	int isJNC    = Instr1 == 0x05;
+	int isJZ     = Instr1 == 0x06;
+	int isJNZ    = Instr1 == 0x07;
+	int isJS     = Instr1 == 0x08;
+	int isJNS    = Instr1 == 0x09;
+	int isJV     = Instr1 == 0x0A;
+	int isJNV    = Instr1 == 0x0B;
+	int isCALL   = Instr1 == 0xE8;
+	int isRETURN = Instr1 == 0xF8;
+	int isSTORE  = (Instr1 & 0xF0) == 0x80;
+	int isLOAD   = (Instr1 & 0xF0) == 0x90;
+	int isMOV    = (Instr1 & 0xF0) == 0x10;
+	int isSHIFT  = (Instr1 & 0xF8) == 0xA0 || (Instr1 & 0xF8) == 0xD0;
+	int isPUSH   = (Instr1 & 0xF8) == 0xE0;
+	int isPOP    = (Instr1 & 0xF8) == 0xF0;
+	int noALU    = (Instr1 & 0x60) == 0x00; // bypass ALU and flags
+	int isStack  = isPUSH || isCALL || isPOP || isRETURN;
+	// registers
+	int Flags = c->r[FLAGS_REGISTER];
+	int A_reg = isStack ? STACK_POINTER : op2isReg ? Instr2Reg1 : Instr1Reg;
+	int B_reg = isPUSH ? Instr1Reg : Instr2Reg2;
+	int W_reg = isPOP ? Instr1Reg : FLAGS_REGISTER;
+	int A_val = c->r[A_reg];
+	int B_val = c->r[B_reg];
+	int op2 = op2isReg ? B_val : Instr2;
+	int ALUout, FlagsOut;
+	alu(Instr1 >> 4, A_val, op2, Flags, &ALUout, &FlagsOut);
+	// memory access, with the DIP input mapped at 0xFF
+	int MemAddr =
+		isPOP || isRETURN ? A_val :
+		isPUSH || isCALL  ? ALUout :
+		op2;
+	int Data = MemAddr == DIP_ADDRESS ? c->dip : c->ram[MemAddr];
+	// program flow control
+	int Size = isHLT || isNOP || isRETURN || isSHIFT || isPUSH || isPOP ? 1 : 2;
+	int Adjacent = (c->pc + Size) & 0xFF;
+	int Jumping =
+		isJMP || isCALL || isRETURN ||
+		(isJC && (Flags & CARRY)) || (isJNC && !(Flags & CARRY)) ||
+		(isJZ && (Flags & ZERO)) || (isJNZ && !(Flags & ZERO)) ||
+		(isJS && (Flags & SIGN)) || (isJNS && !(Flags & SIGN)) ||
+		(isJV && (Flags & OVERFLOW)) || (isJNV && !(Flags & OVERFLOW));
+	int A_next =
+		isLOAD ? Data :
+		isMOV  ? op2 :
+		noALU  ? A_val :
+		ALUout;
+	int W_next =
+		isPOP ? Data :
+		isHLT ? Flags | HALT :
+		noALU ? Flags :
+		FlagsOut;
+	int PCnext =
+		isHLT || (Flags & HALT) ? c->pc :
+		!Jumping ? Adjacent :
+		isRETURN ? Data :
+		Instr2;
+	// rising clock edge; A_next has priority over W_next when A_reg = W_reg
+	if (isSTORE || isPUSH || isCALL) {
+		c->ram[MemAddr] = (unsigned char)(
+			isPUSH ? B_val :
+			isCALL ? Adjacent :
+			A_val);
+	}
+	if (W_reg != A_reg) c->r[W_reg] = (unsigned char) W_next;
+	c->r[A_reg] = (unsigned char) A_next;
+	c->pc = (unsigned char) PCnext;
+	c->cycles++;
+	return c->r[FLAGS_REGISTER] & HALT;
+}
+
+int simulate(struct Computer *c, unsigned long limit)
+{
+	// as in sim.vhd, the clock is gated once the Halt flag is set
+	while (!(c->r[FLAGS_REGISTER] & HALT)) {
+		if (c->cycles >= limit) return 0;
+		step(c);
+	}
+	return 1;
+}
+
+/* Appends a register or RAM word row to t, in binary, hex and decimal. */
+void dump_word(struct Text *t, const char *name, int word)
+{
+	char bits[9];
+	binary(bits, word);
+	append(t, "%-8s%s  %02X  %3d", name, bits, word, word);
+}
+
+void dump(const struct Computer *c, struct Text *t)
+{
+	char name[16];
+	char instruction[16];
+	if (c->r[FLAGS_REGISTER] & HALT) {
+		append(t, "Halted after %lu cycles.\n", c->cycles);
+	} else {
+		append(t, "Stopped after %lu cycles without halting.\n", c->cycles);
+	}
+	dump_word(t, "PC", c->pc);
+	disassemble(instruction, c->ram[c->pc], c->ram[(c->pc + 1) & 0xFF]);
+	append(t, "  %s\n", instruction);
+	for (int i = 0; i < 6; i++) {
+		sprintf(name, "R%d", i);
+		dump_word(t, name, c->r[i]);
+		append(t, "\n");
+	}
+	dump_word(t, "FLAGS", c->r[FLAGS_REGISTER]);
+	append(t, "  CZSV---H\n");
+	dump_word(t, "SP", c->r[STACK_POINTER]);
+	append(t, "\nMONITOR block at %d:\n", c->monitor);
+	for (int i = 0; i < 8; i++) {
+		int addr = (c->monitor + i) & 0xFF;
+		int word = c->ram[addr];
+		sprintf(name, "%d", addr);
+		dump_word(t, name, word);
+		append(t, isprint(word) ? "  '%c'\n" : "\n", word);
+	}
+}
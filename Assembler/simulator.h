@@ -0,0 +1,58 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// E80 instruction-set simulator headers
+
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include "data_structures.h"
+
+#define FLAGS_REGISTER 6
+#define STACK_POINTER 7
+#define DIP_ADDRESS 0xFF
+
+/* Flag bits in the flags register (see ALU.vhd) */
+#define CARRY 0x80
+#define ZERO 0x40
+#define SIGN 0x20
+#define OVERFLOW 0x10
+#define HALT 0x01
+
+/* State of the E80 computer, as in Computer.vhd. Undefined VHDL values
+('U') are simulated as zeroes, which is how match() in Support.vhd treats
+them and how Quartus and Gowin initialize the RAM. */
+struct Computer {
+	unsigned char ram[256];
+	unsigned char r[8]; // R0-R5, flags (R6), stack pointer (R7)
+	unsigned char pc;
+	unsigned char dip; // input at DIP_ADDRESS (.SIMDIP)
+	unsigned char monitor; // address of the .MONITOR block
+	unsigned long cycles; // executed clock cycles
+};
+
+/* Resets the computer and loads the RAM image, .SIMDIP and .MONITOR values
+of a successful assembly. */
+void load_assembly(struct Computer *c, const struct Assembler *as);
+
+/* Resets the computer and loads the RAM image, SIMDIP_directive and
+MONITOR_directive constants from the text of a generated Program.vhd.
+Returns the number of RAM words that were loaded. */
+int load_program(struct Computer *c, const char *vhdl);
+
+/* Arithmetic Logic Unit, as in ALU.vhd: applies the ALUop 'op' to a and b,
+and writes the result and the flags that follow flags_in at *out and
+*flags_out. */
+void alu(int op, int a, int b, int flags_in, int *out, int *flags_out);
+
+/* Executes a single clock cycle, as the CPU.vhd and ALU.vhd hardware does.
+Returns the Halt flag. */
+int step(struct Computer *c);
+
+/* Executes clock cycles until the Halt flag is set, or until 'limit' cycles
+have been executed. Returns 1 if the computer halted. */
+int simulate(struct Computer *c, unsigned long limit);
+
+/* Appends the cycle count, the registers with the instruction at PC, and the
+.MONITOR block to t. */
+void dump(const struct Computer *c, struct Text *t);
+
+#endif
@@ -0,0 +1,75 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Assembly statistics; phase timings and counters for --stats
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // clock_gettime in ISO C
+#endif
+
+#include <stdio.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "stats.h"
+
+double now(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER t, f;
+	QueryPerformanceCounter(&t);
+	QueryPerformanceFrequency(&f);
+	return (double)t.QuadPart / (double)f.QuadPart;
+#else
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+#endif
+}
+
+void measure(struct Assembler *as)
+{
+#if STATS
+	const struct InputHeader *In = &as->In;
+	if (!as->stats) return;
+	as->stats->buffered = In->lines_size * sizeof(*In->lines)
+		+ In->size * sizeof(*In->tokens) + In->text.size
+		+ In->symbols.size * sizeof(*In->symbols.symbol)
+		+ In->symbols.slots * sizeof(*In->symbols.slot)
+		+ as->Out.labels_size * sizeof(*as->Out.label) + as->Out.title.size
+		+ as->diagnostic.message.size + as->output.size + sizeof(*as);
+	as->stats->written = as->output.length;
+#else
+	(void)as;
+#endif
+}
+
+int format_stats(const struct Stats *s, struct Text *t, char json)
+{
+	static const char *const phases[PHASES] = {
+		"read", "symbols", "directives", "instructions", "optimize", "emit"};
+	double total = 0;
+	for (int i = 0; i < PHASES; i++) total += s->seconds[i];
+	if (json) {
+		if (!append(t, "{\"seconds\":{")) return 0;
+		for (int i = 0; i < PHASES; i++) {
+			if (!append(t, "\"%s\":%.9f,", phases[i], s->seconds[i])) return 0;
+		}
+		return append(t, "\"total\":%.9f},\"lines\":%lu,\"tokens\":%lu,"
+			"\"numbers\":%lu,\"lookups\":%lu,\"buffered\":%lu,\"written\":%lu}\n",
+			total, s->lines, s->tokens, s->numbers, s->lookups,
+			(unsigned long)s->buffered, (unsigned long)s->written);
+	}
+	if (!append(t, "\nPhase            Time (ms)\n")) return 0;
+	for (int i = 0; i < PHASES; i++) {
+		if (!append(t, "%-12s %12.3f\n", phases[i], s->seconds[i] * 1e3)) {
+			return 0;
+		}
+	}
+	return append(t, "%-12s %12.3f\n\n"
+		"Lines           %9lu\nTokens          %9lu\nNumbers         %9lu\n"
+		"Label lookups   %9lu\nBytes buffered  %9lu\nBytes written   %9lu\n",
+		"total", total * 1e3, s->lines, s->tokens, s->numbers, s->lookups,
+		(unsigned long)s->buffered, (unsigned long)s->written);
+}
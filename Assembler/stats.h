@@ -0,0 +1,59 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Assembly statistics headers
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "data_structures.h"
+
+/* Timed phases of an assembly. */
+enum Phase {
+	READ_PHASE, // splitting the source into lines, trimming and lexing them
+	SYMBOLS_PHASE, // symbol collection
+	DIRECTIVES_PHASE, // directive parsing
+	INSTRUCTIONS_PHASE, // instruction parsing
+	OPTIMIZE_PHASE, // optimization (-O, -O2)
+	EMIT_PHASE, // template emission, or rendering in another output format
+	PHASES
+};
+
+/* Wall times and counters of the assemblies of a context, collected while
+its 'stats' pointer is set. */
+struct Stats {
+	double seconds[PHASES]; // wall time of each phase
+	unsigned long lines; // lexed lines
+	unsigned long tokens; // lexed tokens
+	unsigned long numbers; // number() conversions of the lexer
+	unsigned long lookups; // label lookups
+	size_t buffered; // bytes of the buffers that the context holds
+	size_t written; // bytes of output
+};
+
+#if STATS
+/* Adds n to a counter of the context's statistics, if they're collected. */
+#define COUNT(as, counter, n) \
+	do { if ((as)->stats) (as)->stats->counter += (n); } while (0)
+/* Runs the statement, and adds its wall time to the phase. */
+#define TIMED(as, phase, statement) do { \
+	double start_ = (as)->stats ? now() : 0; \
+	statement; \
+	if ((as)->stats) (as)->stats->seconds[phase] += now() - start_; \
+} while (0)
+#else
+#define COUNT(as, counter, n) ((void)0)
+#define TIMED(as, phase, statement) do { statement; } while (0)
+#endif
+
+/* Returns the time in seconds from an arbitrary point, on a monotonic
+clock. */
+double now(void);
+
+/* Records the size of the buffers and the output size of the context in its
+statistics, after an assembly. */
+void measure(struct Assembler *as);
+
+/* Appends the statistics to t as a table, or as a JSON object if json is
+set. Returns 0 if memory can't be allocated. */
+int format_stats(const struct Stats *s, struct Text *t, char json);
+
+#endif
@@ -0,0 +1,430 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Bit-sliced execution of all 256 DIP inputs at once; each instruction is
+// decoded once per group of lanes and its data path runs on 256-bit planes
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "sweep.h"
+#include "simulator.h"
+#include "data_structures.h"
+#include "parse_functions.h"
+
+/* Lane mask operations, on all 4 words at once. */
+static inline Lanes lanes_and(Lanes a, Lanes b)
+{
+	for (int i = 0; i < LANES / 64; i++) a.w[i] &= b.w[i];
+	return a;
+}
+
+static inline Lanes lanes_or(Lanes a, Lanes b)
+{
+	for (int i = 0; i < LANES / 64; i++) a.w[i] |= b.w[i];
+	return a;
+}
+
+static inline Lanes lanes_xor(Lanes a, Lanes b)
+{
+	for (int i = 0; i < LANES / 64; i++) a.w[i] ^= b.w[i];
+	return a;
+}
+
+static inline Lanes lanes_not(Lanes a)
+{
+	for (int i = 0; i < LANES / 64; i++) a.w[i] = ~a.w[i];
+	return a;
+}
+
+/* Returns all lanes if bit is set, or no lanes. */
+static inline Lanes all(int bit)
+{
+	Lanes a;
+	for (int i = 0; i < LANES / 64; i++) a.w[i] = bit ? ~(uint64_t)0 : 0;
+	return a;
+}
+
+static inline int empty(Lanes a)
+{
+	return !(a.w[0] | a.w[1] | a.w[2] | a.w[3]);
+}
+
+/* Returns a with b's lanes cleared. */
+static inline Lanes but(Lanes a, Lanes b)
+{
+	return lanes_and(a, lanes_not(b));
+}
+
+/* Returns the index of the lowest lane of a non-empty mask. */
+int first_lane(Lanes a)
+{
+	// de Bruijn sequence lookup of the lowest set bit
+	static const int index[64] = {
+		0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6};
+	int i = 0;
+	while (!a.w[i]) i++;
+	uint64_t lowest = a.w[i] & (0 - a.w[i]);
+	return 64 * i + index[(lowest * 0x03F79D71B4CB0A89ULL) >> 58];
+}
+
+/* Returns the number of lanes of a mask. */
+int count_lanes(Lanes a)
+{
+	int n = 0;
+	for (int i = 0; i < LANES / 64; i++) {
+		for (uint64_t w = a.w[i]; w; w &= w - 1) n++;
+	}
+	return n;
+}
+
+/* Returns the word of a single lane of a slice. */
+int lane_word(const Slice *s, int lane)
+{
+	int word = 0;
+	for (int i = 7; i >= 0; i--) {
+		word = 2 * word + (int)((s->bit[i].w[lane / 64] >> (lane % 64)) & 1);
+	}
+	return word;
+}
+
+/* Returns the same word in all lanes. */
+static inline Slice broadcast(int word)
+{
+	Slice s;
+	for (int i = 0; i < 8; i++) s.bit[i] = all((word >> i) & 1);
+	return s;
+}
+
+/* Returns a in the lanes of mask m, and b in the rest. */
+static inline Slice choose(Lanes m, const Slice *a, const Slice *b)
+{
+	Slice s;
+	for (int i = 0; i < 8; i++) {
+		s.bit[i] = lanes_or(lanes_and(m, a->bit[i]), but(b->bit[i], m));
+	}
+	return s;
+}
+
+/* Returns the lanes of s that hold word. */
+Lanes equals(const Slice *s, int word)
+{
+	Lanes m = all(1);
+	for (int i = 0; i < 8; i++) {
+		m = lanes_and(m, (word >> i) & 1 ? s->bit[i] : lanes_not(s->bit[i]));
+	}
+	return m;
+}
+
+/* Returns the lanes of m with the lowest word in s, which is written at
+*word. */
+Lanes lowest(Lanes m, const Slice *s, int *word)
+{
+	*word = 0;
+	for (int i = 7; i >= 0; i--) {
+		Lanes zero = but(m, s->bit[i]);
+		if (empty(zero)) {
+			*word |= 1 << i;
+		} else {
+			m = zero;
+		}
+	}
+	return m;
+}
+
+/* Takes the lanes of *m that hold the same word in s as its first lane out
+of *m, and returns them; that word is written at *word. */
+Lanes split(Lanes *m, const Slice *s, int *word)
+{
+	*word = lane_word(s, first_lane(*m));
+	Lanes same = lanes_and(*m, equals(s, *word));
+	*m = but(*m, same);
+	return same;
+}
+
+/* Bit-sliced ALU.vhd for the lanes of a group; see alu() in simulator.c. */
+void alu_lanes(int op, const Slice *a, const Slice *b_in, const Slice *flags_in,
+	Slice *out, Slice *flags_out)
+{
+	// ALUop decoder
+	int isADD    = op == 0x2;
+	int isSUB    = (op & 0x7) == 0x3; // includes CMP
+	int isAND    = (op & 0x7) == 0x4; // includes BIT
+	int isOR     = op == 0x5;
+	int isXOR    = op == 0x6;
+	int isROR    = op == 0x7;
+	int isLSHIFT = op == 0xA;
+	int isCMP    = op == 0xB;
+	int isBIT    = op == 0xC;
+	int isRSHIFT = op == 0xD;
+	int isDCR    = op == 0xE; // PUSH, CALL
+	int isINR    = op == 0xF; // POP, RETURN
+	int FullFlags = isADD || isSUB || isRSHIFT || isLSHIFT;
+	int DiscardFlags = isINR || isDCR;
+	int DiscardResult = isCMP || isBIT;
+	Slice one = broadcast(1);
+	const Slice *b = isDCR || isINR ? &one : b_in;
+	Slice result;
+	Lanes C = all(0), V = all(0), Z = all(1);
+	if (isROR) {
+		// barrel shifter, rotating by 1, 2 and 4 bits for the 3 LSBs of B
+		result = *a;
+		for (int k = 0; k < 3; k++) {
+			Slice rotated;
+			for (int i = 0; i < 8; i++) {
+				rotated.bit[i] = result.bit[(i + (1 << k)) % 8];
+			}
+			result = choose(b->bit[k], &rotated, &result);
+		}
+	} else if (isAND || isOR || isXOR) {
+		for (int i = 0; i < 8; i++) {
+			result.bit[i] =
+				isAND ? lanes_and(a->bit[i], b->bit[i]) :
+				isOR  ? lanes_or(a->bit[i], b->bit[i]) :
+				lanes_xor(a->bit[i], b->bit[i]);
+		}
+	} else if (isRSHIFT || isLSHIFT) {
+		for (int i = 0; i < 8; i++) {
+			result.bit[i] =
+				isRSHIFT ? (i < 7 ? a->bit[i + 1] : all(0)) :
+				(i > 0 ? a->bit[i - 1] : all(0));
+		}
+		C = isRSHIFT ? a->bit[0] : a->bit[7];
+		V = lanes_xor(a->bit[7], result.bit[7]);
+	} else {
+		// ripple-carry adder / subtractor (FA8.vhd)
+		int sub = isSUB || isDCR;
+		Lanes carry = all(sub), c7 = carry;
+		for (int i = 0; i < 8; i++) {
+			Lanes x = sub ? lanes_not(b->bit[i]) : b->bit[i];
+			Lanes half = lanes_xor(a->bit[i], x);
+			result.bit[i] = lanes_xor(half, carry);
+			if (i == 7) c7 = carry;
+			carry = lanes_or(lanes_and(a->bit[i], x), lanes_and(half, carry));
+		}
+		C = carry;
+		V = lanes_xor(carry, c7);
+	}
+	for (int i = 0; i < 8; i++) Z = but(Z, result.bit[i]);
+	*flags_out = *flags_in;
+	if (!DiscardFlags) {
+		if (FullFlags) {
+			flags_out->bit[7] = C;
+			flags_out->bit[4] = V;
+		}
+		flags_out->bit[6] = Z;
+		flags_out->bit[5] = result.bit[7];
+	}
+	*out = DiscardResult ? *a : result;
+}
+
+/* Reads the RAM words at the per-lane addresses for the lanes of m, with
+each lane's DIP input mapped at DIP_ADDRESS. */
+Slice load_lanes(const struct Sweep *s, Lanes m, const Slice *addr)
+{
+	Slice data = broadcast(0);
+	while (!empty(m)) {
+		int a;
+		Lanes same = split(&m, addr, &a);
+		const Slice *word = a == DIP_ADDRESS ? &s->dip : &s->ram[a];
+		data = choose(same, word, &data);
+	}
+	return data;
+}
+
+/* Writes the words of the lanes of m to the RAM at their per-lane addresses. */
+void store_lanes(struct Sweep *s, Lanes m, const Slice *addr, const Slice *data)
+{
+	while (!empty(m)) {
+		int a;
+		Lanes same = split(&m, addr, &a);
+		s->ram[a] = choose(same, data, &s->ram[a]);
+	}
+}
+
+/* Executes a single clock cycle on the lanes of group m, which are at the
+same PC with the same instruction words; see step() in simulator.c. */
+void step_lanes(struct Sweep *s, Lanes m, int pc, int Instr1, int Instr2)
+{
+	int op2isReg = (Instr1 >> 3) & 1;
+	int Instr1Reg = Instr1 & 7;
+	int Instr2Reg1 = (Instr2 >> 4) & 7;
+	int Instr2Reg2 = Instr2 & 7;
+	// instruction decoder, common to the group
+	int isHLT    = Instr1 == 0x00;
+	int isNOP    = Instr1 == 0x01;
+	int isJMP    = Instr1 == 0x02;
+	int isJC     = Instr1 == 0x04;
+	int isJNC    = Instr1 == 0x05;
+	int isJZ     = Instr1 == 0x06;
+	int isJNZ    = Instr1 == 0x07;
+	int isJS     = Instr1 == 0x08;
+	int isJNS    = Instr1 == 0x09;
+	int isJV     = Instr1 == 0x0A;
+	int isJNV    = Instr1 == 0x0B;
+	int isCALL   = Instr1 == 0xE8;
+	int isRETURN = Instr1 == 0xF8;
+	int isSTORE  = (Instr1 & 0xF0) == 0x80;
+	int isLOAD   = (Instr1 & 0xF0) == 0x90;
+	int isMOV    = (Instr1 & 0xF0) == 0x10;
+	int isSHIFT  = (Instr1 & 0xF8) == 0xA0 || (Instr1 & 0xF8) == 0xD0;
+	int isPUSH   = (Instr1 & 0xF8) == 0xE0;
+	int isPOP    = (Instr1 & 0xF8) == 0xF0;
+	int noALU    = (Instr1 & 0x60) == 0x00; // bypass ALU and flags
+	int isStack  = isPUSH || isCALL || isPOP || isRETURN;
+	// registers
+	Slice Flags = s->r[FLAGS_REGISTER];
+	int A_reg = isStack ? STACK_POINTER : op2isReg ? Instr2Reg1 : Instr1Reg;
+	int B_reg = isPUSH ? Instr1Reg : Instr2Reg2;
+	int W_reg = isPOP ? Instr1Reg : FLAGS_REGISTER;
+	Slice A_val = s->r[A_reg];
+	Slice B_val = s->r[B_reg];
+	Slice op2 = op2isReg ? B_val : broadcast(Instr2);
+	Slice ALUout = A_val, FlagsOut = Flags;
+	if (!noALU) alu_lanes(Instr1 >> 4, &A_val, &op2, &Flags, &ALUout, &FlagsOut);
+	// memory access, with the DIP inputs mapped at 0xFF
+	const Slice *MemAddr =
+		isPOP || isRETURN ? &A_val :
+		isPUSH || isCALL  ? &ALUout :
+		&op2;
+	Slice Data = broadcast(0);
+	if (isLOAD || isPOP || isRETURN) Data = load_lanes(s, m, MemAddr);
+	// program flow control
+	int Size = isHLT || isNOP || isRETURN || isSHIFT || isPUSH || isPOP ? 1 : 2;
+	Slice Adjacent = broadcast((pc + Size) & 0xFF);
+	Lanes Jumping =
+		isJMP || isCALL || isRETURN ? all(1) :
+		isJC  ? Flags.bit[7] : isJNC ? lanes_not(Flags.bit[7]) :
+		isJZ  ? Flags.bit[6] : isJNZ ? lanes_not(Flags.bit[6]) :
+		isJS  ? Flags.bit[5] : isJNS ? lanes_not(Flags.bit[5]) :
+		isJV  ? Flags.bit[4] : isJNV ? lanes_not(Flags.bit[4]) :
+		all(0);
+	Slice A_next =
+		isLOAD ? Data :
+		isMOV  ? op2 :
+		noALU  ? A_val :
+		ALUout;
+	Slice W_next = isPOP ? Data : noALU ? Flags : FlagsOut;
+	if (isHLT) W_next.bit[0] = all(1);
+	Slice Target = isRETURN ? Data : broadcast(Instr2);
+	Slice PCnext =
+		isHLT ? broadcast(pc) :
+		choose(Jumping, &Target, &Adjacent);
+	// rising clock edge; A_next has priority over W_next when A_reg = W_reg
+	if (isSTORE || isPUSH || isCALL) {
+		store_lanes(s, m, MemAddr,
+			isPUSH ? &B_val :
+			isCALL ? &Adjacent :
+			&A_val);
+	}
+	if (W_reg != A_reg) s->r[W_reg] = choose(m, &W_next, &s->r[W_reg]);
+	s->r[A_reg] = choose(m, &A_next, &s->r[A_reg]);
+	s->pc = choose(m, &PCnext, &s->pc);
+	// count the cycle on the bit-sliced counters of the group
+	for (int i = 0; i < COUNTER_BITS && !empty(m); i++) {
+		Lanes carry = lanes_and(s->cycles[i], m);
+		s->cycles[i] = lanes_xor(s->cycles[i], m);
+		m = carry;
+	}
+	s->steps++;
+}
+
+/* Returns the lanes whose cycle counter equals n. */
+Lanes counted(const struct Sweep *s, unsigned long n)
+{
+	Lanes m = all(1);
+	for (int i = 0; i < COUNTER_BITS; i++) {
+		m = lanes_and(m, (n >> i) & 1 ? s->cycles[i] : lanes_not(s->cycles[i]));
+	}
+	return m;
+}
+
+void load_sweep(struct Sweep *s, const struct Computer *c)
+{
+	memset(s, 0, sizeof(*s));
+	for (int addr = 0; addr < 256; addr++) {
+		s->ram[addr] = broadcast(c->ram[addr]);
+	}
+	for (int i = 0; i < 8; i++) s->r[i] = broadcast(c->r[i]);
+	s->pc = broadcast(c->pc);
+	for (int lane = 0; lane < LANES; lane++) {
+		for (int i = 0; i < 8; i++) {
+			if ((lane >> i) & 1) {
+				s->dip.bit[i].w[lane / 64] |= (uint64_t)1 << (lane % 64);
+			}
+		}
+	}
+	s->live = but(all(1), s->r[FLAGS_REGISTER].bit[0]);
+	s->monitor = c->monitor;
+}
+
+int sweep(struct Sweep *s, unsigned long limit)
+{
+	unsigned long max = 0xFFFFFFFFUL; // COUNTER_BITS wide counters
+	if (limit > max) limit = max;
+	if (limit == 0) s->live = all(0);
+	while (!empty(s->live)) {
+		int pc, Instr1, Instr2;
+		Lanes group = lowest(s->live, &s->pc, &pc);
+		const Slice *word1 = &s->ram[pc];
+		const Slice *word2 = &s->ram[(pc + 1) & 0xFF];
+		// lanes that modified their code run their own instructions
+		while (!empty(group)) {
+			Lanes same1 = split(&group, word1, &Instr1);
+			while (!empty(same1)) {
+				Lanes same = split(&same1, word2, &Instr2);
+				step_lanes(s, same, pc, Instr1, Instr2);
+			}
+		}
+		// as in sim.vhd, the clock is gated once the Halt flag is set
+		s->live = but(s->live, s->r[FLAGS_REGISTER].bit[0]);
+		// no lane can reach the limit before that many groups have run
+		if (s->steps >= limit) s->live = but(s->live, counted(s, limit));
+	}
+	return count_lanes(s->r[FLAGS_REGISTER].bit[0]);
+}
+
+void extract_lane(const struct Sweep *s, int dip, struct Computer *c)
+{
+	memset(c, 0, sizeof(*c));
+	for (int addr = 0; addr < 256; addr++) {
+		c->ram[addr] = (unsigned char) lane_word(&s->ram[addr], dip);
+	}
+	for (int i = 0; i < 8; i++) c->r[i] = (unsigned char) lane_word(&s->r[i], dip);
+	c->pc = (unsigned char) lane_word(&s->pc, dip);
+	c->dip = (unsigned char) dip;
+	c->monitor = s->monitor;
+	for (int i = COUNTER_BITS - 1; i >= 0; i--) {
+		c->cycles = 2 * c->cycles + ((s->cycles[i].w[dip / 64] >> (dip % 64)) & 1);
+	}
+}
+
+void dump_sweep(const struct Sweep *s, struct Text *t)
+{
+	int halted = count_lanes(s->r[FLAGS_REGISTER].bit[0]);
+	append(t, "Swept %d DIP inputs: %d halted, %d stopped without halting.\n\n",
+		LANES, halted, LANES - halted);
+	append(t, "DIP          CYCLES  PC  R0 R1 R2 R3 R4 R5  FLAGS     SP  "
+		"MONITOR block at %d\n", s->monitor);
+	for (int dip = 0; dip < LANES; dip++) {
+		struct Computer c;
+		char bits[2][9];
+		extract_lane(s, dip, &c);
+		binary(bits[0], dip);
+		binary(bits[1], c.r[FLAGS_REGISTER]);
+		append(t, "%s  %10lu  %02X  %02X %02X %02X %02X %02X %02X  %s  %02X ",
+			bits[0], c.cycles, c.pc, c.r[0], c.r[1], c.r[2], c.r[3], c.r[4],
+			c.r[5], bits[1], c.r[STACK_POINTER]);
+		for (int i = 0; i < 8; i++) {
+			append(t, " %02X", c.ram[(c.monitor + i) & 0xFF]);
+		}
+		append(t, "  ");
+		for (int i = 0; i < 8; i++) {
+			int word = c.ram[(c.monitor + i) & 0xFF];
+			append(t, "%c", isprint(word) ? word : '.');
+		}
+		append(t, "\n");
+	}
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Bit-sliced execution of all 256 DIP inputs at once, headers
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+
+#include "data_structures.h"
+#include "simulator.h"
+
+#define LANES 256 // one lane per DIP input value
+#define COUNTER_BITS 32 // width of the per-lane cycle counters
+
+/* One bit of each of the 256 lanes; lane i is bit i%64 of w[i/64]. */
+typedef struct {
+	uint64_t w[LANES / 64];
+} Lanes;
+
+/* An 8-bit word of each lane, bit-sliced: bit[i] holds the i-th bit of the
+word in all lanes, so that a bitwise operation on it processes all lanes. */
+typedef struct {
+	Lanes bit[8];
+} Slice;
+
+/* State of 256 E80 computers that run the same program, each one with a
+different DIP input. Lanes that share a PC and instruction execute together,
+so that an instruction costs about the same for all lanes as for one. */
+struct Sweep {
+	Slice ram[256];
+	Slice r[8]; // R0-R5, flags (R6), stack pointer (R7)
+	Slice pc;
+	Slice dip; // lane i reads the value i at DIP_ADDRESS
+	Lanes live; // lanes that have neither halted nor reached the limit
+	Lanes cycles[COUNTER_BITS]; // bit-sliced executed cycles per lane
+	unsigned char monitor; // address of the .MONITOR block
+	unsigned long steps; // executed lane groups
+};
+
+/* Loads the state of a reset computer (see load_assembly and load_program)
+to all lanes, setting each lane's DIP input to its index. */
+void load_sweep(struct Sweep *s, const struct Computer *c);
+
+/* Executes all lanes until each one halts or executes 'limit' cycles.
+Lanes at the lowest PC run first, so that diverged lanes re-converge at the
+join points of the program. Returns the number of halted lanes. */
+int sweep(struct Sweep *s, unsigned long limit);
+
+/* Copies the state of lane 'dip' to the scalar computer c. */
+void extract_lane(const struct Sweep *s, int dip, struct Computer *c);
+
+/* Appends one row per DIP input with its cycles, PC, registers and
+.MONITOR block to t. */
+void dump_sweep(const struct Sweep *s, struct Text *t);
+
+#endif
@@ -0,0 +1,119 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Template compiler; parses the VHDL template once into segments
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "template.h"
+
+/* Returns 1 if the n characters at s contain word. */
+int contains(const char *s, size_t n, const char *word)
+{
+	size_t len = strlen(word);
+	for (size_t i = 0; i + len <= n; i++) {
+		if (!strncmp(s + i, word, len)) return 1;
+	}
+	return 0;
+}
+
+/* Returns the placeholder of the n characters of a template line. */
+enum SegmentKind placeholder(const char *line, size_t n)
+{
+	if (contains(line, n, "--")) return TITLE_SEGMENT;
+	if (contains(line, n, "SPEED_directive")) return SPEED_SEGMENT;
+	if (contains(line, n, "MONITOR_directive")) return MONITOR_SEGMENT;
+	if (contains(line, n, "SIMDIP_directive")) return SIMDIP_SEGMENT;
+	if (contains(line, n, "MACHINE_CODE_PLACEHOLDER")) {
+		return MACHINE_CODE_SEGMENT;
+	}
+	return LITERAL_SEGMENT;
+}
+
+/* Appends a segment of the given kind, with the n characters at s if it's a
+literal; consecutive literals are merged. Returns 0 if memory can't be
+allocated. */
+int addsegment(struct Template *t, enum SegmentKind kind, const char *s,
+	size_t n)
+{
+	size_t offset = t->text.length;
+	if (kind == LITERAL_SEGMENT) {
+		if (n == 0) return 1;
+		if (!appendn(&t->text, s, n)) return 0;
+		struct Segment *last = t->count ? &t->segment[t->count - 1] : NULL;
+		if (last && last->kind == LITERAL_SEGMENT) {
+			last->length += n; // the texts are back to back
+			return 1;
+		}
+	}
+	if (t->count == t->size) {
+		int size = t->size ? 2 * t->size : 16;
+		struct Segment *grown = realloc(t->segment, size * sizeof(*grown));
+		if (!grown) return 0;
+		t->segment = grown;
+		t->size = size;
+	}
+	struct Segment *segment = &t->segment[t->count++];
+	segment->kind = (unsigned char)kind;
+	segment->offset = offset;
+	segment->length = kind == LITERAL_SEGMENT ? n : 0;
+	return 1;
+}
+
+/* Compiles a template line of n characters, including its newline. */
+int compileline(struct Template *t, const char *line, size_t n)
+{
+	enum SegmentKind kind = placeholder(line, n);
+	if (kind == MACHINE_CODE_SEGMENT) return addsegment(t, kind, NULL, 0);
+	char filled = kind == LITERAL_SEGMENT; // only the first %s or %d is filled
+	size_t start = 0; // literal text since the last placeholder or %%
+	size_t i = 0;
+	while (i < n) {
+		size_t j = i + 1; // end of the conversion specification
+		if (line[i] != '%' || j == n) {
+			i++;
+		} else if (line[j] == '%') {
+			// %% is a single %
+			if (!addsegment(t, LITERAL_SEGMENT, line + start, j - start)) {
+				return 0;
+			}
+			start = i = j + 1;
+		} else {
+			j += strspn(line + j, "-0123456789"); // flags and width are ignored
+			if (!filled && j < n && (line[j] == 's' || line[j] == 'd')) {
+				if (!addsegment(t, LITERAL_SEGMENT, line + start, i - start)
+					|| !addsegment(t, kind, NULL, 0)) {
+					return 0;
+				}
+				filled = 1;
+				start = i = j + 1;
+			} else {
+				i++;
+			}
+		}
+	}
+	return addsegment(t, LITERAL_SEGMENT, line + start, n - start);
+}
+
+struct Template* compile_template(const char *text)
+{
+	struct Template *t = calloc(1, sizeof(*t));
+	if (!t) return NULL;
+	while (*text) {
+		size_t n = strcspn(text, "\n");
+		if (text[n]) n++; // including the newline
+		if (!compileline(t, text, n)) {
+			free_template(t);
+			return NULL;
+		}
+		text += n;
+	}
+	return t;
+}
+
+void free_template(struct Template *t)
+{
+	if (!t) return;
+	free(t->segment);
+	free(t->text.s);
+	free(t);
+}
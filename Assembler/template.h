@@ -0,0 +1,46 @@
+// Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+// Template compiler headers
+
+#ifndef TEMPLATE_H
+#define TEMPLATE_H
+
+#include "data_structures.h"
+
+/* Part of a compiled template; either literal text or a named placeholder
+that is filled from the assembly. */
+enum SegmentKind {
+	LITERAL_SEGMENT, // text of the template
+	TITLE_SEGMENT, // .TITLE string, or DEFAULT_TITLE
+	SIMDIP_SEGMENT, // .SIMDIP value as a VHDL bit string
+	SPEED_SEGMENT, // .SPEED value
+	MONITOR_SEGMENT, // .MONITOR value
+	MACHINE_CODE_SEGMENT // VHDL assignments of the RAM image
+};
+
+struct Segment {
+	unsigned char kind; // enum SegmentKind
+	size_t offset; // literal text in Template.text
+	size_t length;
+};
+
+/* Template that is parsed once, and shared read-only by any number of
+assemblies, even on separate threads. */
+struct Template {
+	struct Segment *segment;
+	int count; // number of segments
+	int size; // allocated segments
+	struct Text text; // literal texts, back to back
+};
+
+/* Compiles the null-terminated text of a template. Placeholders are found
+per line, as in Template.vhd: a line with a VHDL comment holds the title,
+the lines of SIMDIP_directive, SPEED_directive and MONITOR_directive hold
+their values, each in the place of the line's first %s or %d (whose flags
+and width are ignored), and the line with MACHINE_CODE_PLACEHOLDER is
+replaced by the machine code. %% is read as %, like it was by printf. Returns NULL if memory can't be allocated. */
+struct Template* compile_template(const char *text);
+
+/* Releases the compiled template. */
+void free_template(struct Template *t);
+
+#endif
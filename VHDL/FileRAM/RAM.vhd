@@ -0,0 +1,86 @@
+-----------------------------------------------------------------------
+-- E80 256x8bit multiport RAM, initialized from a memory file
+-- Copyright (C) 2026 Panos Stokas <panos.stokas@hotmail.com>
+-- Drop-in replacement of VHDL/RAM.vhd which loads the machine code on
+-- synchronous reset from the file named by ImageFile, instead of the
+-- Program constant of Program.vhd. The file holds one word per line in
+-- 2 hex digits, as written by "E80ASM --format readmemh", so a program
+-- can be swapped by replacing the file without editing VHDL sources.
+-- The .SIMDIP, .SPEED and .MONITOR values are still read from
+-- Program.vhd. Unlisted words are initialized to zero.
+-----------------------------------------------------------------------
+
+LIBRARY ieee;
+USE ieee.std_logic_1164.ALL, std.textio.ALL, work.support.ALL;
+ENTITY RAM IS GENERIC (
+	ImageFile  : STRING := "Program.memh" -- relative to the tool's directory
+); PORT (
+	CLK        : IN STD_LOGIC;
+	Reset      : IN STD_LOGIC;    -- resets the Program data
+	PC         : IN WORD;         -- program counter
+	MemAddr    : IN WORD;         -- address for Mem and MemNext
+	MemWriteEn : IN STD_LOGIC;    -- MemAddr write enable
+	MemNext    : IN WORD;         -- if MemWriteEn, MemNext → [MemAddr]
+	Instr1     : OUT WORD;        -- [PC]
+	Instr2     : OUT WORD;        -- [PC+1]
+	Mem        : OUT WORD;        -- [MemAddr]
+	RAM        : BUFFER WORDx256  -- RAM storage (+ LED display)
+); END;
+ARCHITECTURE a1 OF RAM IS
+	-- Converts a hex digit to 4 bits; other characters are read as 0.
+	FUNCTION nibble(c : CHARACTER) RETURN STD_LOGIC_VECTOR IS
+		VARIABLE n : NATURAL := 0;
+		VARIABLE result : STD_LOGIC_VECTOR(3 DOWNTO 0);
+	BEGIN
+		CASE c IS
+			WHEN '0' TO '9' => n := CHARACTER'POS(c) - CHARACTER'POS('0');
+			WHEN 'A' TO 'F' => n := CHARACTER'POS(c) - CHARACTER'POS('A') + 10;
+			WHEN 'a' TO 'f' => n := CHARACTER'POS(c) - CHARACTER'POS('a') + 10;
+			WHEN OTHERS => n := 0;
+		END CASE;
+		FOR I IN 0 TO 3 LOOP
+			IF n MOD 2 = 1 THEN
+				result(I) := '1';
+			ELSE
+				result(I) := '0';
+			END IF;
+			n := n / 2;
+		END LOOP;
+		RETURN result;
+	END;
+
+	-- Reads the RAM image from the file at path, one word per line.
+	IMPURE FUNCTION load(path : STRING) RETURN WORDx256 IS
+		FILE image_file : TEXT OPEN READ_MODE IS path;
+		VARIABLE l : LINE;
+		VARIABLE high, low : CHARACTER;
+		VARIABLE image : WORDx256 := (OTHERS => (OTHERS => '0'));
+	BEGIN
+		FOR I IN 0 TO 255 LOOP
+			EXIT WHEN ENDFILE(image_file);
+			READLINE(image_file, l);
+			READ(l, high);
+			READ(l, low);
+			image(I) := nibble(high) & nibble(low);
+		END LOOP;
+		RETURN image;
+	END;
+
+	CONSTANT Image : WORDx256 := load(ImageFile);
+	SIGNAL intPC, intMemAddr : NATURAL RANGE 0 TO 255;
+BEGIN
+	intPC <= int(PC);
+	intMemAddr <= int(MemAddr);
+	Instr1 <= RAM(intPC);
+	Instr2 <= RAM(intPC+1);
+	Mem <= RAM(intMemAddr);
+	PROCESS(CLK) BEGIN
+		IF RISING_EDGE(CLK) THEN
+			IF Reset = '1' THEN
+				RAM <= Image;
+			ELSIF MemWriteEn = '1' THEN
+				RAM(intMemAddr) <= MemNext;
+			END IF;
+		END IF;
+	END PROCESS;
+END;